@@ -25,4 +25,41 @@ function(add_exercise NAME TAG)
 
     target_compile_definitions(${EXECUTABLE_NAME} PRIVATE -DASSETS_DIRECTORY="${CMAKE_CURRENT_LIST_DIR}/assets"
                                                           -DSOURCE_DIRECTORY="${CMAKE_CURRENT_LIST_DIR}/src")
+
+    # The headless tools (offline renderer, benchmarks, regression test) share the rasterization stages, but neither the window (main.cpp)
+    # nor the GUI (helper.cpp), so they only link the parts of cgtub that do not need GLFW or OpenGL
+    set(EXERCISE_SHARED_SOURCE_FILES ${EXERCISE_SOURCE_FILES})
+    list(FILTER EXERCISE_SHARED_SOURCE_FILES EXCLUDE REGEX "/(main|helper)\\.[ch]pp$")
+
+    foreach(TOOL headless bench test)
+        file(GLOB EXERCISE_TOOL_SOURCE_FILES src/${TOOL}/*.*)
+        if (NOT EXERCISE_TOOL_SOURCE_FILES)
+            continue()
+        endif()
+
+        add_executable(${EXECUTABLE_NAME}-${TOOL} ${EXERCISE_TOOL_SOURCE_FILES} ${EXERCISE_SHARED_SOURCE_FILES})
+        target_link_libraries(${EXECUTABLE_NAME}-${TOOL} PRIVATE glm::glm cgtub_core)
+        target_include_directories(${EXECUTABLE_NAME}-${TOOL} PRIVATE src)
+
+        target_compile_definitions(${EXECUTABLE_NAME}-${TOOL} PRIVATE -DASSETS_DIRECTORY="${CMAKE_CURRENT_LIST_DIR}/assets"
+                                                                      -DSOURCE_DIRECTORY="${CMAKE_CURRENT_LIST_DIR}/src")
+    endforeach()
+
+    # Regression tests: the rendered images must match the references (stored in src/test/references, recreate them
+    # with `<test> --update`). Frame times are only comparable on the machine that recorded them, so the frame time
+    # test is only registered once a baseline of this machine is configured (create it with `<test> --times --update --baseline <path>`).
+    if (TARGET ${EXECUTABLE_NAME}-test)
+        set(EXERCISE_FRAME_TIME_THRESHOLD 1.5 CACHE STRING "Largest ratio of a frame time to its baseline before the frame time test fails")
+        set(EXERCISE_FRAME_TIME_BASELINE "" CACHE FILEPATH "Frame time baseline recorded on this machine (the frame time test is skipped without one)")
+
+        add_test(NAME ${EXECUTABLE_NAME}-golden-images
+                 COMMAND ${EXECUTABLE_NAME}-test --images --references ${CMAKE_CURRENT_LIST_DIR}/src/test/references
+                                                 --output-directory ${CMAKE_CURRENT_BINARY_DIR}/test-output)
+        if (EXERCISE_FRAME_TIME_BASELINE)
+            add_test(NAME ${EXECUTABLE_NAME}-frame-times
+                     COMMAND ${EXECUTABLE_NAME}-test --times --references ${CMAKE_CURRENT_LIST_DIR}/src/test/references
+                                                     --baseline ${EXERCISE_FRAME_TIME_BASELINE} --time-threshold ${EXERCISE_FRAME_TIME_THRESHOLD})
+            set_tests_properties(${EXECUTABLE_NAME}-frame-times PROPERTIES LABELS performance RUN_SERIAL TRUE)
+        endif()
+    endif()
 endfunction()
\ No newline at end of file
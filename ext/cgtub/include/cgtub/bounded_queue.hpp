@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace cgtub
+{
+
+/**
+ * \brief A first-in first-out queue between threads that holds at most a fixed number of values.
+ *
+ * A producer that gets ahead of its consumer waits once the queue is full, so the work in flight
+ * between two pipeline stages (and the latency it adds) stays bounded.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    BoundedQueue(BoundedQueue const&)            = delete;
+    BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+    /**
+     * \brief Appends a value, waiting while the queue is full.
+     *
+     * \return False if the queue was closed (the value is dropped).
+     */
+    bool push(T value)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_full.wait(lock, [&] { return m_closed || m_values.size() < m_capacity; });
+            if (m_closed)
+                return false;
+
+            m_values.push_back(std::move(value));
+        }
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * \brief Removes the oldest value, waiting while the queue is empty.
+     *
+     * \return False if the queue was closed (values still queued are dropped).
+     */
+    bool pop(T* value)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_empty.wait(lock, [&] { return m_closed || !m_values.empty(); });
+            if (m_closed)
+                return false;
+
+            *value = std::move(m_values.front());
+            m_values.pop_front();
+        }
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // Wakes all waiting threads, after which every push and pop fails (to stop the stages of a pipeline)
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+
+private:
+    std::mutex              m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::deque<T>           m_values;
+    size_t                  m_capacity;
+    bool                    m_closed{false};
+};
+
+} // namespace cgtub
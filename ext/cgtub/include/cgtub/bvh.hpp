@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/culling.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief A bounding volume hierarchy over the bounds of scene objects.
+ *
+ * The hierarchy is built with the surface area heuristic (SAH) and then collapsed into
+ * 8-wide nodes, stored in a flat array with the child bounds in structure-of-arrays layout,
+ * so a node's children are tested against a frustum plane with one SIMD operation.
+ */
+class SceneBvh
+{
+public:
+    static constexpr uint32_t node_width    = 8;
+    static constexpr uint32_t max_leaf_size = 4;
+
+    /**
+     * \brief Builds the hierarchy.
+     *
+     * \param[in] bounds The bounds of each object (objects are referred to by their index in this span).
+     */
+    void build(std::span<Aabb const> bounds);
+
+    /**
+     * \brief Collects all objects whose bounds are (potentially) visible.
+     *
+     * \param[in]  frustum The view frustum (in the space of the object bounds).
+     * \param[out] visible Filled with the indices of the visible objects.
+     */
+    void cull(Frustum const& frustum, std::vector<uint32_t>* visible) const;
+
+    size_t node_count() const;
+
+    size_t object_count() const;
+
+private:
+    struct alignas(32) Node
+    {
+        float min_x[node_width];
+        float min_y[node_width];
+        float min_z[node_width];
+        float max_x[node_width];
+        float max_y[node_width];
+        float max_z[node_width];
+
+        // For inner children: the child node index, for leaves: the first entry in the object list
+        uint32_t child[node_width];
+
+        // Number of objects of a leaf (0 for inner children and empty slots)
+        uint32_t leaf_size[node_width];
+
+        void set_bounds(uint32_t slot, Aabb const& box);
+        bool is_empty(uint32_t slot) const;
+        bool is_leaf(uint32_t slot) const;
+    };
+
+    static constexpr uint32_t invalid = ~0u;
+
+    std::vector<Node>     m_nodes;
+    std::vector<uint32_t> m_objects; // Object indices, grouped by leaf
+};
+
+} // namespace cgtub
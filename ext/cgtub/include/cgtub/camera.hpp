@@ -45,4 +45,13 @@ protected:
     mutable glm::mat4 m_projection;
 };
 
+/**
+ * \brief Builds the view matrix of a camera orbiting the origin (as placed by the \c TurntableCameraController).
+ *
+ * \param[in] azimuth   The rotation around the y-axis (in radians).
+ * \param[in] elevation The angle above the xz-plane (in radians).
+ * \param[in] distance  The distance to the origin.
+ */
+glm::mat4 build_turntable_view_matrix(float azimuth, float elevation, float distance);
+
 } // namespace cgtub
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <span>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+// The color and depth of an image rendered separately, to be merged into another image
+struct DepthLayer
+{
+    std::span<float const>     depth;
+    std::span<glm::vec3 const> color;
+};
+
+/**
+ * \brief Merges layers into an image by depth, like a z-buffer that had rendered the layers one after another.
+ *
+ * A pixel of a layer replaces the pixel of the image (color and depth) if it is closer. If several
+ * layers are equally close, the first one is kept, so layers that each rendered a consecutive part
+ * of a sequence of draws merge into the image the whole sequence renders.
+ *
+ * The depths are compared in batches of 16 (AVX-512), 8 (AVX2) or 1 (scalar fallback) pixels,
+ * depending on the instruction set the library was compiled for (see \c CGTUB_NATIVE_ARCH),
+ * and large images are split into jobs (see \c parallel_for).
+ *
+ * \param[in]     layers The layers, each with (at least) as many pixels as the image.
+ * \param[in,out] depth  The depth of the image.
+ * \param[in,out] color  The color of the image (same size as \c depth).
+ */
+void composite_depth(std::span<DepthLayer const> layers, std::span<float> depth, std::span<glm::vec3> color);
+
+} // namespace cgtub
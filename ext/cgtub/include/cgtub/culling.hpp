@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <span>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+struct BoundingSphere
+{
+    glm::vec3 center;
+    float     radius;
+};
+
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+/**
+ * \brief The six planes of a view frustum (left, right, bottom, top, near, far).
+ *
+ * Each plane is stored as (n, d) with a normalized normal n pointing into the frustum,
+ * so a point p is inside the frustum if dot(n, p) + d >= 0 holds for all planes.
+ */
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+};
+
+/**
+ * \brief Extracts the frustum planes from a (view-)projection matrix.
+ *
+ * The planes are in the space the matrix transforms from (e.g. world space for a view-projection matrix).
+ *
+ * \param[in] view_projection The matrix transforming to OpenGL clip space.
+ */
+Frustum extract_frustum(glm::mat4 const& view_projection);
+
+/**
+ * \brief Computes a bounding sphere of a point set (centered at the center of its axis-aligned bounding box).
+ *
+ * \param[in] positions The points to enclose.
+ */
+BoundingSphere compute_bounding_sphere(std::span<glm::vec3 const> positions);
+
+// Computes a bounding sphere of a point set given as separate coordinate arrays (see above).
+BoundingSphere compute_bounding_sphere(std::span<float const> xs, std::span<float const> ys, std::span<float const> zs);
+
+/**
+ * \brief Transforms a bounding sphere by an affine transformation.
+ *
+ * The radius is scaled by the largest axis scale of the transformation, so the
+ * resulting sphere is conservative for non-uniform scaling.
+ */
+BoundingSphere transform_bounding_sphere(glm::mat4 const& matrix, BoundingSphere const& sphere);
+
+// Test if a sphere is (at least partially) inside the frustum.
+bool is_sphere_visible(Frustum const& frustum, BoundingSphere const& sphere);
+
+// Test if a box is (at least partially) inside the frustum (conservatively, boxes near frustum corners may pass).
+bool is_aabb_visible(Frustum const& frustum, Aabb const& box);
+
+// The axis-aligned box enclosing a sphere.
+Aabb compute_aabb(BoundingSphere const& sphere);
+
+} // namespace cgtub
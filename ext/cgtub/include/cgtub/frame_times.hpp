@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace cgtub
+{
+
+// Statistics of the frame times in a window of frames (in milliseconds)
+struct FrameTimeSummary
+{
+    size_t frames = 0;
+    double mean   = 0.0;
+    double p50    = 0.0;
+    double p95    = 0.0;
+    double p99    = 0.0;
+    double max    = 0.0;
+};
+
+/**
+ * \brief Keeps the times of the last frames in a ring buffer, for percentiles and histograms over a sliding window.
+ *
+ * Averages hide stalls; the high percentiles and the maximum show them.
+ */
+class FrameTimeHistory
+{
+public:
+    // Keeps the last \c capacity frame times
+    explicit FrameTimeHistory(size_t capacity = 1024);
+
+    void add(double milliseconds);
+
+    // Number of frames added in total (older ones are overwritten)
+    uint64_t frame_count() const;
+
+    /**
+     * \brief Computes the mean, the percentiles (nearest rank) and the maximum of the last frames.
+     *
+     * \param[in] window The number of frames (at most the capacity); fewer if fewer were added.
+     */
+    FrameTimeSummary summarize(size_t window) const;
+
+    /**
+     * \brief Copies the times of the last frames, oldest first.
+     *
+     * \param[in]  window       The number of frames.
+     * \param[out] milliseconds The frame times (as float, as plotting takes them).
+     */
+    void recent(size_t window, std::vector<float>* milliseconds) const;
+
+    /**
+     * \brief Counts the last frames in equally wide bins from 0 to \c max_milliseconds (longer frames count into the last bin).
+     *
+     * \param[in]  window           The number of frames.
+     * \param[in]  max_milliseconds The upper end of the last bin.
+     * \param[out] bins             The counts, one per bin.
+     */
+    void histogram(size_t window, double max_milliseconds, std::span<float> bins) const;
+
+private:
+    // The last `window` frame times, oldest first
+    void collect(size_t window, std::vector<double>* milliseconds) const;
+
+    std::vector<double> m_milliseconds;
+    uint64_t            m_frame_count{0};
+};
+
+/**
+ * \brief Writes one JSON object per frame and line (NDJSON), e.g. to feed dashboards.
+ *
+ * Every line holds the frame index, the seconds since the stream was opened and the frame time in
+ * milliseconds, and, if given, the summary of the window the frame ends. Lines are flushed as they
+ * are written, so the file can be followed while frames are rendered. Frames may be written from
+ * several threads.
+ */
+class FrameTimeStream
+{
+public:
+    /**
+     * \brief Opens (and truncates) the stream file.
+     *
+     * \return False if the file could not be opened.
+     */
+    bool open(std::filesystem::path const& path);
+
+    bool is_open() const;
+
+    void write(uint64_t frame, double milliseconds, FrameTimeSummary const* window = nullptr);
+
+private:
+    std::ofstream                         m_file;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex                            m_mutex;
+};
+
+} // namespace cgtub
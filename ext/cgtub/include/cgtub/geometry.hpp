@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -73,4 +74,13 @@ void create_torus_geometry(unsigned int n, unsigned int m, glm::vec3 r, glm::vec
  */
 void create_torus_geometry(float r, float R, std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices);
 
+/**
+ * \brief Computes smooth vertex normals as the area-weighted average of the adjacent face normals.
+ *
+ * \param[in]  positions The vertex positions.
+ * \param[in]  indices   The triangle indices.
+ * \param[out] normals   The normalized vertex normals (zero for vertices without non-degenerate faces).
+ */
+void compute_vertex_normals(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::vector<glm::vec3>* normals);
+
 } // namespace cgtub
\ No newline at end of file
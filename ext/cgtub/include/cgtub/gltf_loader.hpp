@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/culling.hpp>
+#include <cgtub/mapped_file.hpp>
+
+namespace cgtub
+{
+
+// The triangles of a glTF mesh primitive
+struct GltfPrimitive
+{
+    std::span<glm::vec3 const>    positions;
+    std::span<glm::u32vec3 const> indices;
+    BoundingSphere                bounds; // From the bounds stored in the file (the positions are not touched)
+};
+
+struct GltfMesh
+{
+    std::vector<GltfPrimitive> primitives;
+};
+
+// A node of the scene hierarchy that references a mesh, with the node transforms of all its ancestors applied
+struct GltfInstance
+{
+    uint32_t  mesh;
+    glm::mat4 model_matrix;
+};
+
+/**
+ * \brief The triangle meshes of a glTF 2.0 file (.glb or .gltf) and their placement in its default scene.
+ *
+ * The binary buffers (the binary chunk of a .glb file, or the files referenced by the buffers) are
+ * memory-mapped. Vertex positions and triangle indices that are stored as tightly packed 32-bit
+ * values are used directly from the mapping; only other layouts (e.g. 16-bit indices) are converted
+ * into memory owned by the scene.
+ */
+class GltfScene
+{
+public:
+    /**
+     * \brief Loads a glTF file (replacing the previously loaded one).
+     *
+     * Primitives that are not indexed or non-indexed triangle lists (e.g. lines or strips) are skipped,
+     * as are sparse accessors and embedded (data URI) buffers.
+     *
+     * \return False if the file could not be read or is not a valid glTF file.
+     */
+    bool open(std::filesystem::path const& path);
+
+    std::span<GltfMesh const> meshes() const;
+
+    // One instance per node (of the default scene) that references a mesh
+    std::span<GltfInstance const> instances() const;
+
+private:
+    std::vector<MappedFile>                m_files;
+    std::vector<std::vector<glm::vec3>>    m_converted_positions;
+    std::vector<std::vector<glm::u32vec3>> m_converted_indices;
+    std::vector<GltfMesh>                  m_meshes;
+    std::vector<GltfInstance>              m_instances;
+};
+
+} // namespace cgtub
@@ -44,4 +44,34 @@ private:
     std::vector<glm::vec3> m_data;
 };
 
+/**
+ * \brief Writes an image with linear color values in [0, 1] to a file.
+ *
+ * The format is chosen by the extension: PNG and binary PPM files store 8 bits per channel
+ * (PNG without compression), PFM files store the unclamped floats.
+ *
+ * \param[in] path   The path of the image file (.png, .ppm or .pfm).
+ * \param[in] pixels The colors of the pixels, row by row starting with the bottom row (as rasterized).
+ * \param[in] width  The width of the image.
+ * \param[in] height The height of the image.
+ *
+ * \return False if the format is not supported or the file could not be written.
+ */
+bool write_image(std::filesystem::path const& path, std::span<glm::vec3 const> pixels, int width, int height);
+
+/**
+ * \brief Reads an image written by \c write_image.
+ *
+ * Unlike \c Image::read, 8-bit values are mapped linearly to [0, 1] (without gamma), so an image
+ * survives a round trip through \c write_image up to the 8-bit quantization.
+ *
+ * \param[in]  path   The path of the image file (.png, .ppm or .pfm).
+ * \param[out] pixels The colors of the pixels, row by row starting with the bottom row.
+ * \param[out] width  The width of the image.
+ * \param[out] height The height of the image.
+ *
+ * \return False if the file could not be read.
+ */
+bool read_image(std::filesystem::path const& path, std::vector<glm::vec3>* pixels, int* width, int* height);
+
 } // namespace cgtub
\ No newline at end of file
@@ -36,6 +36,16 @@ public:
      */
     void render(std::span<glm::vec3 const> image, int width, int height);
 
+    /**
+     * \brief Upload an image to the texture without rendering it (see \c render(image, width, height)).
+     *
+     * \return False if the image is empty or has no extent (the texture is not changed).
+     */
+    bool upload(std::span<glm::vec3 const> image, int width, int height);
+
+    // Render the image uploaded last to the canvas (nothing, if none was uploaded yet).
+    void render();
+
 private:
     void update_texture(std::span<glm::vec3 const> image, int width, int height);
 
@@ -43,6 +53,7 @@ private:
     GLuint  m_texture{0u};
     GLuint  m_program{0u};
     GLuint  m_vao{0u};
+    bool    m_has_image{false};
 };
 
 } // namespace cgtub
\ No newline at end of file
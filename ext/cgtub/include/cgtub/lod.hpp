@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/culling.hpp>
+#include <cgtub/meshlet.hpp>
+#include <cgtub/vertex_cache.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief A single level of detail of a \c LodMesh.
+ *
+ * The level uses the vertex range [first_vertex, first_vertex + vertex_count) of the
+ * shared vertex buffer; its indices are relative to \c first_vertex.
+ */
+struct LodLevel
+{
+    uint32_t                  first_vertex;
+    uint32_t                  vertex_count;
+    std::vector<glm::u32vec3> indices;
+
+    // Clusters over `indices` for coarse culling (empty unless built with `build_lod_meshlets`)
+    std::vector<Meshlet> meshlets;
+
+    // Post-transform vertex cache efficiency of `indices` before and after they were optimized
+    VertexCacheStats vertex_cache_stats;
+};
+
+/**
+ * \brief A mesh with a chain of levels of detail that share one vertex buffer.
+ *
+ * The levels are ordered from finest (level 0) to coarsest.
+ */
+struct LodMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<LodLevel>  levels;
+    BoundingSphere         bounds;
+};
+
+// A non-owning view of a `LodLevel`
+struct LodLevelView
+{
+    uint32_t                      first_vertex;
+    uint32_t                      vertex_count;
+    std::span<glm::u32vec3 const> indices;
+    std::span<Meshlet const>      meshlets;
+};
+
+/**
+ * \brief A non-owning view of a LOD mesh, e.g. of a \c LodMesh or of a memory-mapped mesh file.
+ *
+ * The positions are either interleaved (\c positions) or stored as separate
+ * coordinate arrays (\c xs, \c ys, \c zs); the other representation is empty.
+ */
+struct LodMeshView
+{
+    std::span<glm::vec3 const> positions;
+    std::span<float const>     xs;
+    std::span<float const>     ys;
+    std::span<float const>     zs;
+    std::vector<LodLevelView>  levels;
+    BoundingSphere             bounds;
+
+    // Whether a level may be drawn (empty if all levels may), e.g. checks the indices of levels read from a file
+    std::function<bool(uint32_t level)> is_level_valid;
+};
+
+LodMeshView make_lod_mesh_view(LodMesh const& mesh);
+
+/**
+ * \brief Transforms the vertices of a level of detail (see \c transform_points).
+ *
+ * \param[in]  mesh   The LOD mesh.
+ * \param[in]  level  The level (of \c mesh) to transform.
+ * \param[in]  matrix The transformation matrix.
+ * \param[out] output The transformed vertices (indexed like \c level.indices).
+ */
+void transform_lod_level(LodMeshView const& mesh, LodLevelView const& level, glm::mat4 const& matrix, std::vector<glm::vec4>* output);
+
+// Transforms the vertices of a level of detail into \c output, which must have (at least) \c level.vertex_count elements
+void transform_lod_level(LodMeshView const& mesh, LodLevelView const& level, glm::mat4 const& matrix, std::span<glm::vec4> output);
+
+/**
+ * \brief Generates a sphere LOD chain, halving the number of segments in both directions from level to level.
+ *
+ * \param[in]  n          The number of segments along the longitudinal direction of the finest level.
+ * \param[in]  m          The number of segments along the latitudinal direction of the finest level.
+ * \param[in]  scale      The sphere's scale along the x, y, and z axes.
+ * \param[in]  num_levels The maximum number of levels (fewer are generated if n or m would drop below 4).
+ * \param[out] mesh       The LOD mesh.
+ */
+void create_sphere_lod_mesh(unsigned int n, unsigned int m, glm::vec3 scale, unsigned int num_levels, LodMesh* mesh);
+
+/**
+ * \brief Generates a torus LOD chain, halving the number of segments in both directions from level to level.
+ *
+ * \param[in]  n          The number of segments along the longitudinal direction of the finest level.
+ * \param[in]  m          The number of segments along the latitudinal direction of the finest level.
+ * \param[in]  r          The torus' inner radius along the x, y, and z axes.
+ * \param[in]  R          The torus' outer radius along the x, y, and z axes.
+ * \param[in]  num_levels The maximum number of levels (fewer are generated if n or m would drop below 4).
+ * \param[out] mesh       The LOD mesh.
+ */
+void create_torus_lod_mesh(unsigned int n, unsigned int m, glm::vec3 r, glm::vec3 R, unsigned int num_levels, LodMesh* mesh);
+
+/**
+ * \brief Generates a LOD chain for an arbitrary mesh by successive quadric error simplification (see \c simplify_mesh_chain).
+ *
+ * The shared vertex buffer is reordered such that the vertices of each level form a prefix of it,
+ * so coarse levels only need to transform the few vertices they use. Vertices that are not referenced
+ * by any triangle are dropped.
+ *
+ * \param[in]  positions  The vertex positions.
+ * \param[in]  indices    The triangle indices (the finest level).
+ * \param[in]  num_levels The maximum number of levels (fewer are generated if the simplification stalls).
+ * \param[in]  reduction  The ratio between the triangle counts of successive levels (e.g. 0.5).
+ * \param[out] mesh       The LOD mesh.
+ */
+void create_simplified_lod_mesh(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, unsigned int num_levels, float reduction, LodMesh* mesh);
+
+/**
+ * \brief Splits each level of a LOD mesh into meshlets (see \c build_meshlets), reordering the level's indices.
+ *
+ * \param[in, out] mesh The LOD mesh.
+ */
+void build_lod_meshlets(LodMesh* mesh);
+
+/**
+ * \brief Computes the area (in pixels) covered by the projection of a bounding sphere.
+ *
+ * \param[in] sphere          The bounding sphere (in world space).
+ * \param[in] view            The view matrix.
+ * \param[in] projection      The projection matrix.
+ * \param[in] viewport_height The height of the render target in pixels.
+ *
+ * \return The approximate projected area, or infinity if the camera is inside the sphere.
+ */
+float compute_projected_area(BoundingSphere const& sphere, glm::mat4 const& view, glm::mat4 const& projection, int viewport_height);
+
+/**
+ * \brief Selects the level of detail of a mesh for a given projected area.
+ *
+ * The coarsest level with at least `projected_area * triangles_per_pixel` triangles is selected.
+ * Switching to a coarser level than \c current_level only happens once the coarser level has a
+ * margin of \c hysteresis (relative) triangles over the target, which avoids popping back and forth
+ * when the projected area is close to a threshold.
+ *
+ * \param[in] mesh                The LOD mesh.
+ * \param[in] projected_area      The projected area of the mesh in pixels (see \c compute_projected_area).
+ * \param[in] triangles_per_pixel The target triangle density.
+ * \param[in] current_level       The level selected in the previous frame.
+ * \param[in] hysteresis          The relative margin for switching to coarser levels.
+ */
+uint32_t select_lod_level(LodMesh const& mesh, float projected_area, float triangles_per_pixel, uint32_t current_level, float hysteresis = 0.25f);
+
+uint32_t select_lod_level(LodMeshView const& mesh, float projected_area, float triangles_per_pixel, uint32_t current_level, float hysteresis = 0.25f);
+
+} // namespace cgtub
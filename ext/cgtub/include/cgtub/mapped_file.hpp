@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace cgtub
+{
+
+/**
+ * \brief A read-only memory mapping of a whole file.
+ *
+ * The file contents are paged in on first access, so opening even large files is cheap
+ * and spans into the mapping can be used without copying.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    MappedFile(MappedFile const&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /**
+     * \brief Maps a file (closing the previously mapped one).
+     *
+     * \return False if the file could not be opened or mapped.
+     */
+    bool open(std::filesystem::path const& path);
+
+    void close();
+
+    bool is_open() const;
+
+    std::span<std::byte const> data() const;
+
+    // Hints that a byte range will be accessed soon, so the system can start reading it in the background
+    void prefetch(size_t offset, size_t size) const;
+
+    // Releases the memory of a byte range (it is read from the file again on the next access)
+    void discard(size_t offset, size_t size) const;
+
+private:
+    std::byte const* m_data{nullptr};
+    size_t           m_size{0u};
+    bool             m_open{false};
+#ifdef _WIN32
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#endif
+};
+
+} // namespace cgtub
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/lod.hpp>
+#include <cgtub/mapped_file.hpp>
+
+namespace cgtub
+{
+
+// Packs a unit vector into two 16-bit signed normalized octahedral coordinates
+uint32_t encode_normal(glm::vec3 const& normal);
+
+// Unpacks a unit vector packed by `encode_normal`
+glm::vec3 decode_normal(uint32_t packed);
+
+/**
+ * \brief Writes a LOD mesh to a binary mesh cache file.
+ *
+ * The file stores the bounds, the positions as separate 64-byte aligned coordinate arrays,
+ * the normals packed by \c encode_normal, and the indices and meshlets of all levels,
+ * laid out such that \c CachedMesh can use all of them directly from a memory mapping.
+ *
+ * \param[in] path       The path of the cache file.
+ * \param[in] mesh       The LOD mesh.
+ * \param[in] normals    The vertex normals (one per vertex of \c mesh).
+ * \param[in] num_levels The number of levels of detail \c mesh was generated with (see \c load_mesh_cached).
+ * \param[in] reduction  The triangle count ratio \c mesh was generated with.
+ *
+ * \return False if the file could not be written.
+ */
+bool write_mesh_cache(std::filesystem::path const& path, LodMesh const& mesh, std::span<glm::vec3 const> normals, unsigned int num_levels, float reduction);
+
+/**
+ * \brief A LOD mesh that is (usually) backed by a memory-mapped mesh cache file.
+ *
+ * Opening a cache file only validates its header and the ranges of its arrays, the data is paged in when it is accessed.
+ * The indices and meshlets of a level are checked before the level is first drawn (see \c LodMeshView::is_level_valid),
+ * so the mesh must not be moved while its view is used.
+ */
+class CachedMesh
+{
+public:
+    CachedMesh() = default;
+
+    CachedMesh(CachedMesh const&)            = delete;
+    CachedMesh& operator=(CachedMesh const&) = delete;
+
+    /**
+     * \brief Maps a mesh cache file written by \c write_mesh_cache.
+     *
+     * \param[in] path       The path of the cache file.
+     * \param[in] num_levels The number of levels of detail the mesh must have been generated with.
+     * \param[in] reduction  The triangle count ratio the mesh must have been generated with.
+     *
+     * \return False if the file could not be mapped, is not a valid mesh cache or was written with other settings.
+     */
+    bool open(std::filesystem::path const& path, unsigned int num_levels, float reduction);
+
+    /**
+     * \brief Uses an in-memory mesh instead of a cache file (e.g. if the cache could not be written).
+     */
+    void assign(LodMesh&& mesh, std::span<glm::vec3 const> normals);
+
+    // The mesh, pointing into the mapping (or the in-memory mesh)
+    LodMeshView const& view() const;
+
+    // The packed vertex normals (see `decode_normal`)
+    std::span<uint32_t const> normals() const;
+
+    // True if the indices and meshlets of a level are in range (checked on the first call for each level of a mapped file)
+    bool is_level_valid(uint32_t level) const;
+
+private:
+    enum class LevelState : uint8_t
+    {
+        Unchecked,
+        Valid,
+        Invalid
+    };
+
+    MappedFile                                 m_file;
+    LodMesh                                    m_mesh;         // In-memory mesh (if not mapped)
+    std::vector<uint32_t>                      m_mesh_normals; // In-memory normals (if not mapped)
+    LodMeshView                                m_view;
+    std::span<uint32_t const>                  m_normals;
+    std::filesystem::path                      m_path;
+    std::unique_ptr<std::atomic<LevelState>[]> m_level_states; // Per level of the mapped file (null if not mapped)
+};
+
+/**
+ * \brief Loads a mesh through its binary cache.
+ *
+ * The cache is the file `<path>.cgmesh`. If it is missing, older than the mesh file or was written with
+ * other import settings, the mesh is imported (OBJ files with \c load_obj), simplified into \c num_levels
+ * levels of detail (see \c create_simplified_lod_mesh), split into meshlets and written to the cache.
+ *
+ * \param[in]  path       The path of the mesh file.
+ * \param[out] mesh       The mesh.
+ * \param[in]  num_levels The number of levels of detail to generate on import.
+ * \param[in]  reduction  The triangle count ratio between successive levels.
+ *
+ * \return False if the mesh could be neither loaded from the cache nor imported.
+ */
+bool load_mesh_cached(std::filesystem::path const& path, CachedMesh* mesh, unsigned int num_levels = 4, float reduction = 0.25f);
+
+} // namespace cgtub
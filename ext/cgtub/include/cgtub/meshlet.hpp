@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/culling.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief A cluster of spatially close triangles that can be culled as a whole.
+ *
+ * The triangles of a meshlet are the range [first_triangle, first_triangle + triangle_count)
+ * of the (reordered) index buffer it was built for.
+ */
+struct Meshlet
+{
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    uint32_t vertex_count;
+
+    // Bounds of the meshlet's vertices
+    BoundingSphere bounds;
+
+    // All triangle normals lie within `cone_angle` (radians) around `cone_axis`.
+    // A cone angle of pi/2 or more means the normals are too diverse for cone culling.
+    glm::vec3 cone_axis;
+    float     cone_angle;
+};
+
+// Limits of the meshlets generated by `build_meshlets`
+constexpr uint32_t max_meshlet_vertices  = 64;
+constexpr uint32_t max_meshlet_triangles = 124;
+
+/**
+ * \brief Splits a mesh into meshlets of at most \c max_meshlet_vertices vertices and \c max_meshlet_triangles triangles.
+ *
+ * The meshlets are grown greedily from a seed triangle by adding the adjacent triangle
+ * that introduces the fewest new vertices.
+ *
+ * \param[in]  positions The vertex positions.
+ * \param[in]  indices   The triangle indices.
+ * \param[out] meshlets  The meshlets.
+ * \param[out] reordered The triangle indices, reordered such that the triangles of each meshlet are contiguous.
+ */
+void build_meshlets(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::vector<Meshlet>* meshlets, std::vector<glm::u32vec3>* reordered);
+
+enum class FaceCulling
+{
+    None,
+    BackFaces,
+    FrontFaces
+};
+
+/**
+ * \brief Tests if a meshlet is (potentially) visible.
+ *
+ * A meshlet is invisible if its bounding sphere is outside the frustum or if, judging by its normal cone,
+ * all of its triangles are culled by the face culling mode. Front faces are faces whose (counter-clockwise)
+ * normal points towards the camera.
+ *
+ * \param[in] meshlet         The meshlet.
+ * \param[in] frustum         The view frustum in the object space of the mesh (see \c extract_frustum with a model-view-projection matrix).
+ * \param[in] camera_position The camera position in the object space of the mesh.
+ * \param[in] face_culling    The face culling mode.
+ */
+bool is_meshlet_visible(Meshlet const& meshlet, Frustum const& frustum, glm::vec3 const& camera_position, FaceCulling face_culling);
+
+} // namespace cgtub
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief Loads the triangles of a Wavefront OBJ file.
+ *
+ * The file is split into chunks at line boundaries that are parsed in parallel (with tinyobj).
+ * Polygons are triangulated as fans. Vertices with identical positions are welded into one
+ * (triangles that become degenerate are dropped), and the mesh is optimized for the vertex cache
+ * (see \c optimize_mesh). Only positions are loaded; normals, texture coordinates and materials are ignored.
+ *
+ * \param[in]  path      The path of the OBJ file.
+ * \param[out] positions The welded vertex positions.
+ * \param[out] indices   The triangle indices.
+ *
+ * \return False if the file could not be read or refers to nonexistent vertices.
+ */
+bool load_obj(std::filesystem::path const& path, std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices);
+
+/**
+ * \brief Merges vertices with identical positions.
+ *
+ * \param[in, out] positions The vertex positions (duplicates are removed).
+ * \param[in, out] indices   The triangle indices (rewritten; triangles with repeated vertices are removed).
+ */
+void weld_vertices(std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices);
+
+} // namespace cgtub
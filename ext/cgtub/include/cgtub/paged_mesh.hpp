@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/bvh.hpp>
+#include <cgtub/culling.hpp>
+#include <cgtub/mapped_file.hpp>
+
+namespace cgtub
+{
+
+// Default number of triangles per page of a paged mesh
+constexpr uint32_t default_page_triangles = 1u << 16;
+
+// Default number of triangles that the conversion to a paged mesh sorts in memory at once
+constexpr size_t default_bucket_triangles = size_t(1) << 22;
+
+/**
+ * \brief Converts a binary PLY file into a paged mesh file for out-of-core rendering.
+ *
+ * The triangles are sorted along a Morton curve through their centroids and split into pages of
+ * \c triangles_per_page triangles, so every page covers a compact region. Each page stores its own
+ * vertices and indices (at an offset aligned to 64 KiB) and is listed with its bounds in a page table.
+ *
+ * The conversion works out of core, so the mesh does not have to fit into memory: the PLY file is
+ * streamed twice, the vertices and triangles are kept in temporary files next to \c path, and the
+ * triangles are sorted in buckets of about \c bucket_triangles triangles (more for meshes that would
+ * need more than a few hundred buckets).
+ *
+ * \param[in] ply_path           The path of the PLY file (see stream_ply).
+ * \param[in] path               The path of the paged mesh file.
+ * \param[in] triangles_per_page The maximum number of triangles per page.
+ * \param[in] bucket_triangles   The number of triangles sorted in memory at once.
+ *
+ * \return False if the PLY file could not be read or the paged mesh file could not be written.
+ */
+bool convert_ply_to_paged_mesh(std::filesystem::path const& ply_path, std::filesystem::path const& path, uint32_t triangles_per_page = default_page_triangles,
+                               size_t bucket_triangles = default_bucket_triangles);
+
+// An entry of the page table of a paged mesh file
+struct PagedMeshPage
+{
+    BoundingSphere bounds;
+    uint32_t       vertex_count;
+    uint32_t       triangle_count;
+    uint64_t       offset; // Of the vertex positions, followed by the triangle indices
+};
+
+struct PagedMeshStats
+{
+    size_t resident_pages = 0; // Pages held within the residency budget
+    size_t resident_bytes = 0;
+    size_t loaded_pages   = 0; // Pages that became resident in the last selection
+    size_t pending_pages  = 0; // Selected pages deferred by the load budget (prefetched for a later frame)
+};
+
+/**
+ * \brief A mesh that is rendered out of core from a memory-mapped paged mesh file (see \c convert_ply_to_paged_mesh).
+ *
+ * Only the page table stays in memory. Each frame, \c select_pages picks the pages that pass the frustum
+ * and size tests; only these are read from the file. Pages that have not been used for the longest time
+ * are released when the resident pages exceed the residency budget.
+ */
+class PagedMesh
+{
+public:
+    /**
+     * \brief Maps a paged mesh file.
+     *
+     * Only the header and the page table are checked here; the indices of a page are checked when it
+     * is first loaded by \c select_pages, and pages with indices out of range are never selected.
+     *
+     * \return False if the file could not be mapped or is not a valid paged mesh.
+     */
+    bool open(std::filesystem::path const& path);
+
+    // Bounds of the whole mesh
+    BoundingSphere const& bounds() const;
+
+    // Maximum size (in bytes) of the pages kept resident (pages selected in one frame are kept in any case)
+    void set_residency_budget(size_t bytes);
+
+    // Maximum size (in bytes) of the pages that become resident per selection, so paging cannot stall a frame
+    void set_load_budget(size_t bytes);
+
+    /**
+     * \brief Selects the pages to draw and updates the resident pages.
+     *
+     * Pages outside the view frustum or whose projected bounds are smaller than \c min_projected_area
+     * pixels are skipped. Selected pages that are not resident yet become resident within the load
+     * budget; the rest are prefetched and selected in a later frame.
+     *
+     * Selections for frames rendered in parallel may run on several threads; they are serialized.
+     * Pages released by a concurrent selection stay readable (they are read from the file again).
+     *
+     * \param[in]  model_matrix       The model matrix of the mesh.
+     * \param[in]  view_matrix        The view matrix.
+     * \param[in]  projection_matrix  The projection matrix.
+     * \param[in]  viewport_height    The height of the viewport in pixels.
+     * \param[in]  min_projected_area The smallest projected area (in pixels) of drawn pages.
+     * \param[out] pages              The pages to draw.
+     */
+    void select_pages(glm::mat4 const& model_matrix, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix,
+                      int viewport_height, float min_projected_area, std::vector<uint32_t>* pages);
+
+    std::span<glm::vec3 const> page_positions(uint32_t page) const;
+
+    std::span<glm::u32vec3 const> page_indices(uint32_t page) const;
+
+    // Index of the first triangle of a page within the whole mesh (the triangles of all pages in page order)
+    uint64_t page_first_triangle(uint32_t page) const;
+
+    PagedMeshStats const& stats() const;
+
+private:
+    enum class PageState : uint8_t
+    {
+        Unchecked,
+        Valid,
+        Corrupt
+    };
+
+    // Checks the indices of a page that has not been checked yet
+    bool check_page(uint32_t page);
+
+    // Releases the least recently used pages until the resident pages fit into the budget
+    void evict(size_t budget);
+
+    size_t page_size(uint32_t page) const;
+
+    MappedFile                                 m_file;
+    std::filesystem::path                      m_path;
+    std::span<PagedMeshPage const>             m_pages;
+    std::vector<uint64_t>                      m_first_triangles; // Per page (see `page_first_triangle`)
+    BoundingSphere                             m_bounds{};
+    SceneBvh                                   m_page_bvh;
+    size_t                                     m_residency_budget{size_t(1) << 30};
+    size_t                                     m_load_budget{size_t(64) << 20};
+    uint64_t                                   m_frame{0};
+    std::list<uint32_t>                        m_lru; // Resident pages, most recently used first
+    std::vector<std::list<uint32_t>::iterator> m_lru_positions;
+    std::vector<uint64_t>                      m_last_used; // Frame in which each resident page was last selected
+    std::vector<bool>                          m_is_resident;
+    std::vector<PageState>                     m_page_states;
+    PagedMeshStats                             m_stats;
+    std::mutex                                 m_mutex; // Guards the residency state in select_pages
+};
+
+} // namespace cgtub
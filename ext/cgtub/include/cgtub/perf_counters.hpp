@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace cgtub
+{
+
+// Hardware event counts (of user-space code)
+struct PerfCounters
+{
+    uint64_t cycles        = 0;
+    uint64_t instructions  = 0;
+    uint64_t l1d_misses    = 0; // L1 data cache read misses
+    uint64_t llc_misses    = 0; // Last level cache misses
+    uint64_t branch_misses = 0; // Mispredicted branches
+};
+
+PerfCounters operator+(PerfCounters const& a, PerfCounters const& b);
+
+PerfCounters operator-(PerfCounters const& a, PerfCounters const& b);
+
+/**
+ * \brief The hardware performance counters of one thread, read through Linux perf_event_open.
+ *
+ * The counters are opened as one group, so they count over the same intervals, and only count
+ * events of the thread that opened them. Not supported on other platforms, and on Linux only if
+ * the process may access the PMU (see /proc/sys/kernel/perf_event_paranoid; often not in VMs).
+ */
+class PerfCounterGroup
+{
+public:
+    PerfCounterGroup() = default;
+
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(PerfCounterGroup const&)            = delete;
+    PerfCounterGroup& operator=(PerfCounterGroup const&) = delete;
+
+    /**
+     * \brief Opens and starts the counters of the calling thread.
+     *
+     * Counters the CPU does not provide are left out (they read 0), only the cycle counter is required.
+     *
+     * \return False if the counters are not supported.
+     */
+    bool open();
+
+    bool is_open() const;
+
+    // Reads the counts since the group was opened (all 0 if it is not open)
+    PerfCounters read() const;
+
+private:
+    static constexpr size_t max_counters = 5;
+
+    std::array<int, max_counters>                      m_fds{-1, -1, -1, -1, -1}; // The first is the group leader (the cycle counter)
+    std::array<uint64_t PerfCounters::*, max_counters> m_fields{};                // The field each opened counter is read into
+    size_t                                             m_count{0};
+};
+
+} // namespace cgtub
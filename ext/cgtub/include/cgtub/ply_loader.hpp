@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief Receives the coordinates of the vertices [first_vertex, first_vertex + xs.size()) of the \c vertex_count vertices of a PLY file.
+ */
+using PlyVertexCallback = std::function<void(uint64_t vertex_count, uint64_t first_vertex, std::span<float const> xs, std::span<float const> ys, std::span<float const> zs)>;
+
+/**
+ * \brief Receives the next batch of triangles of a PLY file with \c face_count faces.
+ */
+using PlyTriangleCallback = std::function<void(uint64_t face_count, std::span<glm::u32vec3 const> triangles)>;
+
+/**
+ * \brief Reads the number of vertices and faces from the header of a binary PLY file.
+ *
+ * \return False if the file could not be read or is not a binary PLY file.
+ */
+bool read_ply_counts(std::filesystem::path const& path, uint64_t* vertex_count, uint64_t* face_count);
+
+/**
+ * \brief Streams the vertex positions and faces of a binary PLY file in batches without keeping them in memory.
+ *
+ * All vertices are passed on (in order) before the first triangle. Polygons are triangulated as fans and
+ * triangles with corners that are not among the vertices are dropped.
+ *
+ * \return False if the file could not be read, is not a binary PLY file or refers to nonexistent vertices.
+ */
+bool stream_ply(std::filesystem::path const& path, PlyVertexCallback const& vertices, PlyTriangleCallback const& triangles);
+
+/**
+ * \brief Loads the vertex positions and faces of a binary PLY file.
+ *
+ * The file is streamed in fixed-size chunks (see stream_ply) into the coordinate arrays, which are sized
+ * from the header up front, so the peak memory use stays close to the size of the loaded mesh. Both binary byte orders are supported, ASCII files are not. Polygons are triangulated
+ * as fans; vertex properties other than the position and elements other than vertices and faces are skipped.
+ * Point clouds (files without faces) load with empty \c indices.
+ *
+ * \param[in]  path    The path of the PLY file.
+ * \param[out] xs      The x coordinates of the vertices.
+ * \param[out] ys      The y coordinates of the vertices.
+ * \param[out] zs      The z coordinates of the vertices.
+ * \param[out] indices The triangle indices.
+ *
+ * \return False if the file could not be read, is not a binary PLY file or refers to nonexistent vertices.
+ */
+bool load_ply(std::filesystem::path const& path, std::vector<float>* xs, std::vector<float>* ys, std::vector<float>* zs, std::vector<glm::u32vec3>* indices);
+
+} // namespace cgtub
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <cgtub/perf_counters.hpp>
+
+// Timing zones are recorded if cgtub is configured with CGTUB_PROFILER (the default),
+// otherwise CGTUB_PROFILE_ZONE compiles to nothing and no events are recorded.
+#if CGTUB_PROFILER
+#define CGTUB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CGTUB_PROFILE_CONCAT(a, b)      CGTUB_PROFILE_CONCAT_IMPL(a, b)
+#define CGTUB_PROFILE_ZONE(name)        ::cgtub::ProfileZone CGTUB_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define CGTUB_PROFILE_ZONE(name) ((void)0)
+#endif
+
+namespace cgtub
+{
+
+// A recorded timing zone
+struct ProfileEvent
+{
+    char const*  name;     // A string literal (events only store the pointer)
+    uint64_t     begin;    // Nanoseconds since the profiler epoch (see `profiler_now`)
+    uint64_t     end;
+    uint32_t     thread;   // Index of the recording thread, in the order threads recorded their first event
+    PerfCounters counters; // Hardware events during the zone (0 unless counters are enabled)
+};
+
+// The time and hardware events spent in a zone, summed over all events of that name
+struct ProfileStage
+{
+    char const*  name;
+    double       milliseconds;
+    PerfCounters counters;
+};
+
+// Nanoseconds since the profiler epoch (the first call)
+uint64_t profiler_now();
+
+/**
+ * \brief Enables or disables hardware counters (see \c PerfCounterGroup) for the zones of all threads.
+ *
+ * Every thread opens its counters when it records its first zone after they were enabled.
+ * Reading them costs a system call at the start and end of every zone.
+ *
+ * \return False if the counters could not be opened on the calling thread (they stay disabled).
+ */
+bool enable_profile_counters(bool enable);
+
+// The hardware counters of the calling thread (all 0 unless they are enabled)
+PerfCounters read_profile_counters();
+
+/**
+ * \brief Records a timing zone of the calling thread.
+ *
+ * Every thread records into its own ring buffer without locks, so zones may be recorded on any
+ * number of threads. A buffer keeps the last 65536 events of its thread; older events are overwritten.
+ *
+ * \param[in] name     The name of the zone, must be a string literal (or outlive the profiler).
+ * \param[in] begin    The start time (see \c profiler_now).
+ * \param[in] end      The end time.
+ * \param[in] counters The hardware events during the zone (see \c read_profile_counters).
+ */
+void record_profile_zone(char const* name, uint64_t begin, uint64_t end, PerfCounters const& counters = {});
+
+// Names the calling thread in exported traces (e.g. "render 2")
+void set_profiler_thread_name(char const* name);
+
+/**
+ * \brief Collects the recorded events of all threads that began at or after a point in time.
+ *
+ * May run while other threads record; events overwritten while they are copied are skipped.
+ *
+ * \param[in]  since  The earliest start time of the collected events.
+ * \param[out] events The events, sorted by thread and start time.
+ */
+void collect_profile_events(uint64_t since, std::vector<ProfileEvent>* events);
+
+/**
+ * \brief Sums the time and hardware events per zone name, excluding those of zones nested in a zone on the same thread.
+ *
+ * \param[in]  events The events (as returned by \c collect_profile_events).
+ * \param[out] stages The summed times, in the order the names first occur.
+ */
+void summarize_profile_events(std::span<ProfileEvent const> events, std::vector<ProfileStage>* stages);
+
+/**
+ * \brief Writes events as a Chrome trace (JSON), which can be opened in Perfetto or chrome://tracing.
+ *
+ * \return False if the file could not be written.
+ */
+bool write_chrome_trace(std::filesystem::path const& path, std::span<ProfileEvent const> events);
+
+// Records the time between its construction and destruction as a zone (see `CGTUB_PROFILE_ZONE`)
+class ProfileZone
+{
+public:
+    explicit ProfileZone(char const* name)
+        : m_name(name)
+        , m_begin_counters(read_profile_counters())
+        , m_begin(profiler_now())
+    {
+    }
+
+    ~ProfileZone()
+    {
+        uint64_t end = profiler_now();
+        record_profile_zone(m_name, m_begin, end, read_profile_counters() - m_begin_counters);
+    }
+
+    ProfileZone(ProfileZone const&)            = delete;
+    ProfileZone& operator=(ProfileZone const&) = delete;
+
+private:
+    char const*  m_name;
+    PerfCounters m_begin_counters;
+    uint64_t     m_begin;
+};
+
+/**
+ * \brief Sums the time and hardware events of a stage that runs in many short intervals (e.g. once per batch of triangles).
+ *
+ * The sum is recorded as one zone, rather than one zone per interval.
+ */
+class ProfileAccumulator
+{
+public:
+    void begin()
+    {
+        m_begin_counters = read_profile_counters();
+        m_begin          = profiler_now();
+    }
+
+    void end()
+    {
+        m_nanoseconds += profiler_now() - m_begin;
+        m_counters = m_counters + (read_profile_counters() - m_begin_counters);
+    }
+
+    // Records the sum as a zone starting at \c begin and returns its end
+    uint64_t record(char const* name, uint64_t begin) const
+    {
+        record_profile_zone(name, begin, begin + m_nanoseconds, m_counters);
+        return begin + m_nanoseconds;
+    }
+
+private:
+    uint64_t     m_begin{0};
+    uint64_t     m_nanoseconds{0};
+    PerfCounters m_begin_counters;
+    PerfCounters m_counters;
+};
+
+} // namespace cgtub
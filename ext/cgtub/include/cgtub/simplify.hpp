@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief Simplifies a triangle mesh to a target triangle count using quadric error metric edge collapses.
+ *
+ * Vertices are collapsed onto one of their neighbors, so no new vertices are created and the simplified
+ * indices refer to the input vertex buffer. Vertices on open boundaries are never removed.
+ * The simplification stops early if no further collapse is possible without flipping triangles.
+ *
+ * \param[in]  positions             The vertex positions.
+ * \param[in]  indices               The triangle indices.
+ * \param[in]  target_triangle_count The number of triangles to reduce the mesh to.
+ * \param[out] simplified            The indices of the simplified mesh.
+ *
+ * \return The largest quadric error of all performed collapses.
+ */
+float simplify_mesh(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, size_t target_triangle_count, std::vector<glm::u32vec3>* simplified);
+
+/**
+ * \brief Simplifies a triangle mesh successively to several target triangle counts.
+ *
+ * Each level continues from the previous one (including its accumulated quadrics), so this is
+ * cheaper than simplifying the full mesh once per level and the vertices used by a level are a subset of
+ * the vertices used by the previous (finer) level.
+ *
+ * \param[in]  positions              The vertex positions.
+ * \param[in]  indices                The triangle indices.
+ * \param[in]  target_triangle_counts The target triangle count of each level (in decreasing order).
+ * \param[out] levels                 The indices of each level, all referring to \c positions.
+ */
+void simplify_mesh_chain(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::span<size_t const> target_triangle_counts, std::vector<std::vector<glm::u32vec3>>* levels);
+
+} // namespace cgtub
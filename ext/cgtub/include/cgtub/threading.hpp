@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace cgtub
+{
+
+/**
+ * \brief Keeps the parallel algorithms of cgtub (e.g. \c transform_points) on the calling thread while it exists.
+ *
+ * Meant for threads that already process independent work in parallel (such as whole frames),
+ * so the algorithms do not start further threads on top of them.
+ */
+class SerialScope
+{
+public:
+    SerialScope();
+
+    ~SerialScope();
+
+    SerialScope(SerialScope const&)            = delete;
+    SerialScope& operator=(SerialScope const&) = delete;
+
+private:
+    bool m_was_serial;
+};
+
+// True if a \c SerialScope exists on the calling thread
+bool is_serial_scope();
+
+class JobSystem;
+struct Job;
+
+/**
+ * \brief Counts the unfinished jobs it was passed to (see \c run_job), to wait for them or to start jobs that depend on them.
+ *
+ * Must outlive the jobs it counts.
+ */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    // Waits until the job that finished last has released the counter
+    ~JobCounter();
+
+    JobCounter(JobCounter const&)            = delete;
+    JobCounter& operator=(JobCounter const&) = delete;
+
+    // True if all counted jobs have finished
+    bool is_done() const
+    {
+        return m_count.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_count{0};
+    std::mutex            m_mutex;      // Guards the dependent jobs and the decrements of the count
+    std::vector<Job*>     m_dependents; // Started once the count drops to 0
+};
+
+/**
+ * \brief Starts the threads of the job system, which all parallel algorithms of cgtub share.
+ *
+ * Every thread has a work-stealing deque (Chase-Lev): it pushes and pops the jobs it creates at one
+ * end, idle threads steal the oldest jobs of other threads at the other end. Waiting threads run
+ * jobs until the jobs they wait for are done, so nested parallel algorithms do not block threads.
+ * Without a call, the job system starts on first use with one thread per hardware thread.
+ *
+ * \param[in] thread_count The number of threads that run jobs in parallel, including the thread waiting
+ *                         for them (0 for one per hardware thread). At least one worker thread is started,
+ *                         so jobs nobody waits for still run.
+ *
+ * \return False if the job system was already started (the thread count stays the same).
+ */
+bool start_job_system(size_t thread_count = 0);
+
+// The number of threads that run jobs in parallel (starts the job system if needed)
+size_t job_thread_count();
+
+/**
+ * \brief Queues a job on the calling thread's deque.
+ *
+ * \param[in] function   The job.
+ * \param[in] counter    Counts the job until it has finished (may be null).
+ * \param[in] dependency The job is only started once this counter is done (may be null).
+ */
+void run_job(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+// Runs queued jobs (of any thread) until the counter is done
+void wait_for_jobs(JobCounter const& counter);
+
+// The number of jobs the calling thread queued that were neither started nor stolen yet
+size_t queued_job_count();
+
+/**
+ * \brief Calls `kernel(begin, end)` for disjoint subranges of [0, count), possibly in parallel on the job system.
+ *
+ * Ranges are split lazily: the calling thread splits off half of its range as a job only while the
+ * jobs it split off before were taken by other threads, and otherwise processes its range in chunks.
+ * So the range is only split as finely as idle threads need it to be, but never into chunks smaller
+ * than \c min_chunk_size (so small inputs stay on the calling thread). Chunk boundaries are multiples
+ * of \c alignment. Within a \c SerialScope, the whole range runs on the calling thread.
+ */
+template<typename Kernel>
+void parallel_for(size_t count, size_t min_chunk_size, size_t alignment, Kernel const& kernel)
+{
+    size_t thread_count = is_serial_scope() ? 1 : job_thread_count();
+    if (thread_count <= 1 || count <= std::max<size_t>(min_chunk_size, 1))
+    {
+        kernel(size_t(0), count);
+        return;
+    }
+
+    // Chunks are small enough for every thread to take several, so uneven chunks balance out
+    alignment    = std::max<size_t>(alignment, 1);
+    size_t grain = std::max<size_t>(min_chunk_size, count / (8 * thread_count));
+    grain        = (grain + alignment - 1) / alignment * alignment;
+
+    JobCounter counter;
+
+    std::function<void(size_t, size_t)> process = [&](size_t begin, size_t end)
+    {
+        while (end - begin > grain)
+        {
+            if (queued_job_count() > 0)
+            {
+                // The previously split off half was not taken yet, no thread is idle
+                kernel(begin, begin + grain);
+                begin += grain;
+                continue;
+            }
+
+            size_t middle = begin + (end - begin) / 2;
+            middle        = std::max(begin + grain, middle / alignment * alignment);
+            run_job([&process, middle, end] { process(middle, end); }, &counter);
+            end = middle;
+        }
+        kernel(begin, end);
+    };
+
+    process(0, count);
+    wait_for_jobs(counter);
+}
+
+} // namespace cgtub
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+// Size of the FIFO post-transform vertex cache the optimizations target
+constexpr unsigned int default_vertex_cache_size = 16;
+
+// Average cache miss ratio (transformed vertices per triangle) of an index buffer, before and after optimization
+struct VertexCacheStats
+{
+    float acmr_before;
+    float acmr_after;
+};
+
+/**
+ * \brief Computes the average cache miss ratio (ACMR) of an index buffer.
+ *
+ * The ACMR is the number of vertices that have to be transformed per triangle with a FIFO
+ * post-transform cache. It ranges from 3 (no reuse) down to about 0.5 for large regular meshes.
+ *
+ * \param[in] indices      The triangle indices.
+ * \param[in] vertex_count The number of vertices the indices refer to.
+ * \param[in] cache_size   The number of entries of the simulated cache.
+ */
+float compute_acmr(std::span<glm::u32vec3 const> indices, size_t vertex_count, unsigned int cache_size = default_vertex_cache_size);
+
+/**
+ * \brief Reorders triangles to reduce the misses of a post-transform vertex cache (Tipsify).
+ *
+ * Triangles are emitted as fans around a current vertex. The next fan vertex is picked among the vertices
+ * of the last fan such that it is likely still in the cache, or from a stack of recent vertices at dead ends.
+ * Runs in linear time in the number of triangles.
+ *
+ * \param[in]  indices      The triangle indices.
+ * \param[in]  vertex_count The number of vertices the indices refer to.
+ * \param[out] optimized    The reordered triangle indices (must not alias \c indices).
+ * \param[in]  cache_size   The number of entries of the targeted cache.
+ */
+void optimize_vertex_cache(std::span<glm::u32vec3 const> indices, size_t vertex_count, std::vector<glm::u32vec3>* optimized, unsigned int cache_size = default_vertex_cache_size);
+
+// Marks vertices in the remap table of `optimize_vertex_fetch` that no triangle refers to
+constexpr uint32_t unused_vertex = ~0u;
+
+/**
+ * \brief Renumbers the vertices in the order of their first use by the triangles.
+ *
+ * After \c optimize_vertex_cache, this makes vertex fetches (mostly) sequential in memory.
+ *
+ * \param[in, out] indices      The triangle indices, rewritten to the new vertex numbering.
+ * \param[in]      vertex_count The number of vertices the indices refer to.
+ * \param[out]     remap        The new index of each old vertex (\c unused_vertex for vertices no triangle refers to).
+ *
+ * \return The number of vertices in the new numbering.
+ */
+size_t optimize_vertex_fetch(std::span<glm::u32vec3> indices, size_t vertex_count, std::vector<uint32_t>* remap);
+
+/**
+ * \brief Applies a vertex remap table (see \c optimize_vertex_fetch) to a vertex attribute.
+ *
+ * Unused vertices are dropped.
+ */
+template<typename T>
+void remap_vertices(std::span<uint32_t const> remap, size_t new_vertex_count, std::vector<T>* vertices)
+{
+    std::vector<T> remapped(new_vertex_count);
+    for (size_t v = 0; v < remap.size(); ++v)
+    {
+        if (remap[v] != unused_vertex)
+            remapped[remap[v]] = (*vertices)[v];
+    }
+    vertices->swap(remapped);
+}
+
+/**
+ * \brief Optimizes a mesh for the post-transform vertex cache and for vertex fetches.
+ *
+ * Reorders the triangles with \c optimize_vertex_cache and then the vertices (and the given attributes)
+ * with \c optimize_vertex_fetch.
+ *
+ * \param[in, out] positions The vertex positions.
+ * \param[in, out] indices   The triangle indices.
+ * \param[in, out] normals   The vertex normals (optional).
+ * \param[in, out] uvs       The vertex UV coordinates (optional).
+ *
+ * \return The ACMR before and after the optimization.
+ */
+VertexCacheStats optimize_mesh(std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices, std::vector<glm::vec3>* normals = nullptr, std::vector<glm::vec2>* uvs = nullptr);
+
+enum class CacheReplacement
+{
+    Fifo, // Replace the entry that was inserted first (like the caches the index reordering targets)
+    Lru   // Replace the entry that was used least recently
+};
+
+struct VertexCacheCounters
+{
+    uint64_t hits   = 0;
+    uint64_t misses = 0;
+};
+
+/**
+ * \brief A post-transform vertex cache between vertex processing and triangle assembly.
+ *
+ * Holds the results of the vertex stage for the most recently processed vertex indices,
+ * so vertices shared by nearby triangles of an indexed mesh are processed only once.
+ *
+ * \tparam Vertex The output of the vertex stage.
+ * \tparam Size   The number of cache entries.
+ */
+template<typename Vertex, unsigned int Size = default_vertex_cache_size>
+class PostTransformCache
+{
+public:
+    explicit PostTransformCache(CacheReplacement replacement = CacheReplacement::Fifo)
+        : m_replacement(replacement)
+    {
+        clear();
+    }
+
+    void set_replacement(CacheReplacement replacement)
+    {
+        m_replacement = replacement;
+        clear();
+    }
+
+    CacheReplacement replacement() const
+    {
+        return m_replacement;
+    }
+
+    // Invalidate all entries (required whenever the vertex data the indices refer to changes)
+    void clear()
+    {
+        m_indices.fill(invalid_index);
+        m_last_use.fill(0);
+        m_next = 0;
+        m_time = 0;
+    }
+
+    /**
+     * \brief Returns the processed vertex with the given index.
+     *
+     * \param[in] index          The vertex index.
+     * \param[in] process_vertex Callable with the signature `Vertex(uint32_t index)` that runs the vertex stage, called on misses.
+     */
+    template<typename ProcessVertex>
+    Vertex fetch(uint32_t index, ProcessVertex const& process_vertex)
+    {
+        ++m_time;
+        for (unsigned int i = 0; i < Size; ++i)
+        {
+            if (m_indices[i] == index)
+            {
+                ++m_counters.hits;
+                m_last_use[i] = m_time;
+                return m_vertices[i];
+            }
+        }
+
+        ++m_counters.misses;
+
+        unsigned int slot = m_next;
+        if (m_replacement == CacheReplacement::Fifo)
+            m_next = (m_next + 1) % Size;
+        else
+        {
+            for (unsigned int i = 0; i < Size; ++i)
+            {
+                if (m_last_use[i] < m_last_use[slot])
+                    slot = i;
+            }
+        }
+
+        m_indices[slot]  = index;
+        m_vertices[slot] = process_vertex(index);
+        m_last_use[slot] = m_time;
+
+        return m_vertices[slot];
+    }
+
+    VertexCacheCounters const& counters() const
+    {
+        return m_counters;
+    }
+
+    void reset_counters()
+    {
+        m_counters = VertexCacheCounters{};
+    }
+
+    // Adds the counters of another cache (e.g. one that processed another part of the same frame)
+    void add_counters(VertexCacheCounters const& counters)
+    {
+        m_counters.hits += counters.hits;
+        m_counters.misses += counters.misses;
+    }
+
+private:
+    static constexpr uint32_t invalid_index = ~0u;
+
+    CacheReplacement           m_replacement;
+    std::array<uint32_t, Size> m_indices;
+    std::array<Vertex, Size>   m_vertices;
+    std::array<uint64_t, Size> m_last_use; // Time stamp of the last access (LRU only)
+    unsigned int               m_next;     // Next entry to replace (FIFO only)
+    uint64_t                   m_time;
+    VertexCacheCounters        m_counters;
+};
+
+} // namespace cgtub
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+
+#include <glm/glm.hpp>
+
+namespace cgtub
+{
+
+/**
+ * \brief Transforms a batch of points (with implicit w = 1) by a 4x4 matrix, writing the homogeneous results.
+ *
+ * The points are processed in structure-of-arrays batches of 16 (AVX-512), 8 (AVX2) or 1 (scalar fallback),
+ * depending on the instruction set the library was compiled for (see \c CGTUB_NATIVE_ARCH).
+ * All paths (and `matrix * glm::vec4(point, 1)`) compute the same results to the bit.
+ * Large batches are split across all hardware threads.
+ *
+ * \param[in]  matrix      The transformation matrix (e.g. view-projection matrix).
+ * \param[in]  points      The points to transform.
+ * \param[out] transformed The transformed points. Must have (at least) as many elements as \c points.
+ */
+void transform_points(glm::mat4 const& matrix, std::span<glm::vec3 const> points, std::span<glm::vec4> transformed);
+
+/**
+ * \brief Transforms a batch of points given in structure-of-arrays layout (with implicit w = 1) by a 4x4 matrix.
+ *
+ * \param[in]  matrix      The transformation matrix (e.g. view-projection matrix).
+ * \param[in]  xs          The x coordinates of the points.
+ * \param[in]  ys          The y coordinates of the points (same size as \c xs).
+ * \param[in]  zs          The z coordinates of the points (same size as \c xs).
+ * \param[out] transformed The transformed points. Must have (at least) as many elements as \c xs.
+ */
+void transform_points(glm::mat4 const& matrix, std::span<float const> xs, std::span<float const> ys, std::span<float const> zs, std::span<glm::vec4> transformed);
+
+// Name of the instruction set used by the batch transform kernels ("AVX-512", "AVX2" or "Scalar")
+char const* get_transform_simd_name();
+
+} // namespace cgtub
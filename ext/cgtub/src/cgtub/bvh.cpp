@@ -0,0 +1,326 @@
+#include "cgtub/bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Bounds of empty node slots: finite (to avoid NaNs in the SIMD tests) but never visible or hit
+constexpr float empty_min = 1e30f;
+constexpr float empty_max = -1e30f;
+
+Aabb merge(Aabb const& a, Aabb const& b)
+{
+    return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+Aabb empty_aabb()
+{
+    return Aabb{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+}
+
+float surface_area(Aabb const& box)
+{
+    glm::vec3 extent = glm::max(box.max - box.min, glm::vec3(0.f));
+    return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+// Bit i is set if the point (xs[i], ys[i], zs[i]) is below the plane (i < 8)
+unsigned int below_plane(glm::vec4 const& plane, float const* xs, float const* ys, float const* zs)
+{
+#if defined(__AVX2__)
+    __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_load_ps(xs)),
+                                           _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_load_ps(ys))),
+                             _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_load_ps(zs)),
+                                           _mm256_set1_ps(plane.w)));
+    return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ)));
+#else
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < 8; ++i)
+        mask |= (plane.x * xs[i] + plane.y * ys[i] + plane.z * zs[i] + plane.w < 0.f) << i;
+    return mask;
+#endif
+}
+
+// Intermediate binary hierarchy produced by the SAH build
+struct BuildNode
+{
+    Aabb     bounds;
+    uint32_t left;
+    uint32_t right;
+    uint32_t first; // First object (leaves only)
+    uint32_t count; // Number of objects (0 for inner nodes)
+};
+
+class BinaryBuilder
+{
+public:
+    BinaryBuilder(std::span<Aabb const> bounds, std::vector<uint32_t>* objects, uint32_t max_leaf_size)
+        : m_bounds(bounds)
+        , m_objects(*objects)
+        , m_max_leaf_size(max_leaf_size)
+    {
+        m_centroids.reserve(bounds.size());
+        for (Aabb const& box : bounds)
+            m_centroids.push_back(0.5f * (box.min + box.max));
+    }
+
+    uint32_t build(uint32_t first, uint32_t count)
+    {
+        uint32_t index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(BuildNode{empty_aabb(), 0, 0, first, count});
+
+        Aabb bounds          = empty_aabb();
+        Aabb centroid_bounds = empty_aabb();
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            bounds          = merge(bounds, m_bounds[m_objects[i]]);
+            centroid_bounds = merge(centroid_bounds, Aabb{m_centroids[m_objects[i]], m_centroids[m_objects[i]]});
+        }
+        m_nodes[index].bounds = bounds;
+
+        if (count <= m_max_leaf_size)
+            return index;
+
+        uint32_t split = find_split(first, count, centroid_bounds);
+
+        uint32_t left  = build(first, split - first);
+        uint32_t right = build(split, first + count - split);
+
+        m_nodes[index].left  = left;
+        m_nodes[index].right = right;
+        m_nodes[index].count = 0;
+        return index;
+    }
+
+    std::vector<BuildNode> const& nodes() const
+    {
+        return m_nodes;
+    }
+
+private:
+    // Partitions the objects by the best binned SAH split and returns the first object of the right half
+    uint32_t find_split(uint32_t first, uint32_t count, Aabb const& centroid_bounds)
+    {
+        constexpr int num_bins = 16;
+
+        float best_cost = std::numeric_limits<float>::max();
+        int   best_axis = -1;
+        int   best_bin  = 0;
+
+        glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (extent[axis] <= 0.f)
+                continue;
+
+            Aabb     bin_bounds[num_bins];
+            uint32_t bin_counts[num_bins] = {};
+            std::fill(std::begin(bin_bounds), std::end(bin_bounds), empty_aabb());
+
+            float scale = num_bins / extent[axis];
+            for (uint32_t i = first; i < first + count; ++i)
+            {
+                int bin = std::min(num_bins - 1, static_cast<int>((m_centroids[m_objects[i]][axis] - centroid_bounds.min[axis]) * scale));
+                bin_bounds[bin] = merge(bin_bounds[bin], m_bounds[m_objects[i]]);
+                ++bin_counts[bin];
+            }
+
+            // Sweep from the right to get the cost of the right side of each split
+            float    right_cost[num_bins];
+            Aabb     right_bounds = empty_aabb();
+            uint32_t right_count  = 0;
+            for (int bin = num_bins - 1; bin > 0; --bin)
+            {
+                right_bounds    = merge(right_bounds, bin_bounds[bin]);
+                right_count    += bin_counts[bin];
+                right_cost[bin] = right_count > 0 ? right_count * surface_area(right_bounds) : 0.f;
+            }
+
+            Aabb     left_bounds = empty_aabb();
+            uint32_t left_count  = 0;
+            for (int bin = 1; bin < num_bins; ++bin)
+            {
+                left_bounds = merge(left_bounds, bin_bounds[bin - 1]);
+                left_count += bin_counts[bin - 1];
+                if (left_count == 0 || left_count == count)
+                    continue;
+
+                float cost = left_count * surface_area(left_bounds) + right_cost[bin];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin  = bin;
+                }
+            }
+        }
+
+        // Fall back to a median split if all centroids coincide
+        if (best_axis < 0)
+            return first + count / 2;
+
+        float scale = num_bins / extent[best_axis];
+        auto  it    = std::partition(m_objects.begin() + first, m_objects.begin() + first + count, [&](uint32_t object)
+                                     { return std::min(num_bins - 1, static_cast<int>((m_centroids[object][best_axis] - centroid_bounds.min[best_axis]) * scale)) < best_bin; });
+
+        return static_cast<uint32_t>(it - m_objects.begin());
+    }
+
+    std::span<Aabb const>  m_bounds;
+    std::vector<uint32_t>& m_objects;
+    uint32_t               m_max_leaf_size;
+    std::vector<glm::vec3> m_centroids;
+    std::vector<BuildNode> m_nodes;
+};
+
+} // namespace
+
+void SceneBvh::Node::set_bounds(uint32_t slot, Aabb const& box)
+{
+    min_x[slot] = box.min.x;
+    min_y[slot] = box.min.y;
+    min_z[slot] = box.min.z;
+    max_x[slot] = box.max.x;
+    max_y[slot] = box.max.y;
+    max_z[slot] = box.max.z;
+}
+
+bool SceneBvh::Node::is_empty(uint32_t slot) const
+{
+    return child[slot] == invalid;
+}
+
+bool SceneBvh::Node::is_leaf(uint32_t slot) const
+{
+    return leaf_size[slot] > 0;
+}
+
+void SceneBvh::build(std::span<Aabb const> bounds)
+{
+    m_nodes.clear();
+    m_objects.resize(bounds.size());
+    for (uint32_t i = 0; i < bounds.size(); ++i)
+        m_objects[i] = i;
+
+    if (bounds.empty())
+        return;
+
+    BinaryBuilder builder(bounds, &m_objects, max_leaf_size);
+    builder.build(0, static_cast<uint32_t>(bounds.size()));
+    std::vector<BuildNode> const& binary_nodes = builder.nodes();
+
+    // Collapse the binary hierarchy: each wide node takes the children of a binary node and
+    // repeatedly opens the inner child with the largest surface area until it has `node_width` children
+    auto emit = [&](auto const& emit, uint32_t binary_index) -> uint32_t
+    {
+        uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+
+        std::vector<uint32_t> children;
+        BuildNode const&      root = binary_nodes[binary_index];
+        if (root.count > 0)
+            children = {binary_index};
+        else
+            children = {root.left, root.right};
+
+        while (children.size() < node_width)
+        {
+            auto largest = children.end();
+            for (auto it = children.begin(); it != children.end(); ++it)
+            {
+                if (binary_nodes[*it].count == 0 && (largest == children.end() || surface_area(binary_nodes[*it].bounds) > surface_area(binary_nodes[*largest].bounds)))
+                    largest = it;
+            }
+            if (largest == children.end())
+                break;
+
+            BuildNode const& opened = binary_nodes[*largest];
+            *largest                = opened.left;
+            children.push_back(opened.right);
+        }
+
+        for (uint32_t slot = 0; slot < node_width; ++slot)
+        {
+            Node& node           = m_nodes[node_index];
+            node.child[slot]     = invalid;
+            node.leaf_size[slot] = 0;
+            node.set_bounds(slot, Aabb{glm::vec3(empty_min), glm::vec3(empty_max)});
+        }
+
+        for (uint32_t slot = 0; slot < children.size(); ++slot)
+        {
+            BuildNode const& child = binary_nodes[children[slot]];
+            m_nodes[node_index].set_bounds(slot, child.bounds);
+            if (child.count > 0)
+            {
+                m_nodes[node_index].child[slot]     = child.first;
+                m_nodes[node_index].leaf_size[slot] = child.count;
+            }
+            else
+            {
+                // Not a reference: `m_nodes` may grow during the recursion
+                uint32_t child_index            = emit(emit, children[slot]);
+                m_nodes[node_index].child[slot] = child_index;
+            }
+        }
+
+        return node_index;
+    };
+    emit(emit, 0);
+}
+
+void SceneBvh::cull(Frustum const& frustum, std::vector<uint32_t>* visible) const
+{
+    visible->clear();
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty())
+    {
+        Node const& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        // Test the box corners furthest along each plane normal (all children at once)
+        unsigned int outside = 0;
+        for (glm::vec4 const& plane : frustum.planes)
+        {
+            outside |= below_plane(plane,
+                                   plane.x > 0.f ? node.max_x : node.min_x,
+                                   plane.y > 0.f ? node.max_y : node.min_y,
+                                   plane.z > 0.f ? node.max_z : node.min_z);
+        }
+
+        for (uint32_t slot = 0; slot < node_width; ++slot)
+        {
+            if ((outside & (1u << slot)) || node.is_empty(slot))
+                continue;
+
+            if (node.is_leaf(slot))
+                visible->insert(visible->end(), m_objects.begin() + node.child[slot], m_objects.begin() + node.child[slot] + node.leaf_size[slot]);
+            else
+                stack.push_back(node.child[slot]);
+        }
+    }
+}
+
+size_t SceneBvh::node_count() const
+{
+    return m_nodes.size();
+}
+
+size_t SceneBvh::object_count() const
+{
+    return m_objects.size();
+}
+
+} // namespace cgtub
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "cgtub/camera.hpp"
@@ -9,7 +11,7 @@ Camera::Camera(float aspect, float z_near, float z_far)
     : m_aspect(aspect)
     , m_z_near(z_near)
     , m_z_far(z_far)
-    , m_dirty(DirtyFlags::None)
+    , m_dirty(DirtyFlags::Projection) // The projection is computed on first use
     , m_view(glm::mat4(1))
     , m_projection(glm::mat4(1))
 {
@@ -59,4 +61,15 @@ void Camera::set_view(glm::mat4 const& view)
     m_dirty |= DirtyFlags::View;
 }
 
+glm::mat4 build_turntable_view_matrix(float azimuth, float elevation, float distance)
+{
+    glm::vec3 z = glm::vec3(std::cos(elevation) * std::sin(azimuth), std::sin(elevation), std::cos(elevation) * std::cos(azimuth));
+    glm::vec3 x = glm::normalize(glm::vec3(std::cos(elevation) * std::cos(azimuth), 0.f, -std::cos(elevation) * std::sin(azimuth)));
+    glm::vec3 y = glm::cross(z, x);
+
+    glm::mat4 R = glm::transpose(glm::mat3(x, y, z));
+
+    return R * glm::translate(glm::mat4(1), -distance * z);
+}
+
 } // namespace cgtub
\ No newline at end of file
@@ -98,14 +98,7 @@ void TurntableCameraController::update(float dt, EventDispatcher* dispatcher)
 
 glm::mat4 TurntableCameraController::build_view_matrix() const
 {
-    // Build the view matrix
-    glm::vec3 z = glm::vec3(std::cos(m_elevation) * std::sin(m_azimuth), std::sin(m_elevation), std::cos(m_elevation) * std::cos(m_azimuth));
-    glm::vec3 x = glm::normalize(glm::vec3(std::cos(m_elevation) * std::cos(m_azimuth), 0.f, -std::cos(m_elevation) * std::sin(m_azimuth)));
-    glm::vec3 y = glm::cross(z, x);
-
-    glm::mat4 R = glm::transpose(glm::mat3(x, y, z));
-
-    return R * glm::translate(glm::mat4(1), -m_distance * z);
+    return build_turntable_view_matrix(m_azimuth, m_elevation, m_distance);
 }
 
 } // namespace cgtub
\ No newline at end of file
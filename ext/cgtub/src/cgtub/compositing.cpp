@@ -0,0 +1,61 @@
+#include "cgtub/compositing.hpp"
+
+#include <bit>
+
+#include "cgtub/threading.hpp"
+#include "simd.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Below this number of pixels per job, scheduling the job costs more than it saves
+constexpr size_t min_pixels_per_job = 1 << 14;
+
+} // namespace
+
+void composite_depth(std::span<DepthLayer const> layers, std::span<float> depth, std::span<glm::vec3> color)
+{
+    parallel_for(depth.size(), min_pixels_per_job, simd::width, [&](size_t begin, size_t end)
+    {
+        size_t i = begin;
+#if defined(__AVX2__) || defined(__AVX512F__)
+        for (; i + simd::width <= end; i += simd::width)
+        {
+            // The depth of the batch stays in a register while the layers are merged in order
+            simd::Float closest = simd::load(&depth[i]);
+            for (DepthLayer const& layer : layers)
+            {
+                simd::Float  layer_depth = simd::load(&layer.depth[i]);
+                unsigned int closer      = simd::less_mask(layer_depth, closest);
+                if (closer == 0)
+                    continue; // Most batches of a layer are empty or hidden
+
+                closest = simd::min(layer_depth, closest);
+                for (; closer != 0; closer &= closer - 1)
+                {
+                    size_t lane     = static_cast<size_t>(std::countr_zero(closer));
+                    color[i + lane] = layer.color[i + lane];
+                }
+            }
+            simd::store(&depth[i], closest);
+        }
+#endif
+        // Scalar fallback (and remainder)
+        for (; i < end; ++i)
+        {
+            for (DepthLayer const& layer : layers)
+            {
+                if (layer.depth[i] < depth[i])
+                {
+                    depth[i] = layer.depth[i];
+                    color[i] = layer.color[i];
+                }
+            }
+        }
+    });
+}
+
+} // namespace cgtub
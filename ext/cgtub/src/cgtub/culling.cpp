@@ -0,0 +1,109 @@
+#include "cgtub/culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cgtub
+{
+
+Frustum extract_frustum(glm::mat4 const& view_projection)
+{
+    // Gribb & Hartmann: the planes are sums/differences of the rows of the matrix
+    glm::mat4 const m = glm::transpose(view_projection);
+
+    Frustum frustum;
+    frustum.planes[0] = m[3] + m[0]; // Left
+    frustum.planes[1] = m[3] - m[0]; // Right
+    frustum.planes[2] = m[3] + m[1]; // Bottom
+    frustum.planes[3] = m[3] - m[1]; // Top
+    frustum.planes[4] = m[3] + m[2]; // Near
+    frustum.planes[5] = m[3] - m[2]; // Far
+
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    return frustum;
+}
+
+BoundingSphere compute_bounding_sphere(std::span<glm::vec3 const> positions)
+{
+    if (positions.empty())
+        return BoundingSphere{glm::vec3(0.f), 0.f};
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (glm::vec3 const& p : positions)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    BoundingSphere sphere{0.5f * (min + max), 0.f};
+    for (glm::vec3 const& p : positions)
+        sphere.radius = std::max(sphere.radius, glm::distance(sphere.center, p));
+
+    return sphere;
+}
+
+BoundingSphere compute_bounding_sphere(std::span<float const> xs, std::span<float const> ys, std::span<float const> zs)
+{
+    if (xs.empty())
+        return BoundingSphere{glm::vec3(0.f), 0.f};
+
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        min = glm::min(min, glm::vec3(xs[i], ys[i], zs[i]));
+        max = glm::max(max, glm::vec3(xs[i], ys[i], zs[i]));
+    }
+
+    BoundingSphere sphere{0.5f * (min + max), 0.f};
+    for (size_t i = 0; i < xs.size(); ++i)
+        sphere.radius = std::max(sphere.radius, glm::distance(sphere.center, glm::vec3(xs[i], ys[i], zs[i])));
+
+    return sphere;
+}
+
+BoundingSphere transform_bounding_sphere(glm::mat4 const& matrix, BoundingSphere const& sphere)
+{
+    float scale = std::sqrt(std::max({glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                                      glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                                      glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))}));
+
+    return BoundingSphere{glm::vec3(matrix * glm::vec4(sphere.center, 1.f)), scale * sphere.radius};
+}
+
+bool is_sphere_visible(Frustum const& frustum, BoundingSphere const& sphere)
+{
+    for (glm::vec4 const& plane : frustum.planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+
+    return true;
+}
+
+bool is_aabb_visible(Frustum const& frustum, Aabb const& box)
+{
+    for (glm::vec4 const& plane : frustum.planes)
+    {
+        // The box corner furthest along the plane normal
+        glm::vec3 corner(plane.x > 0.f ? box.max.x : box.min.x,
+                         plane.y > 0.f ? box.max.y : box.min.y,
+                         plane.z > 0.f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+            return false;
+    }
+
+    return true;
+}
+
+Aabb compute_aabb(BoundingSphere const& sphere)
+{
+    return Aabb{sphere.center - glm::vec3(sphere.radius), sphere.center + glm::vec3(sphere.radius)};
+}
+
+} // namespace cgtub
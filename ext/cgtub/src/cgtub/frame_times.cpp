@@ -0,0 +1,134 @@
+#include "cgtub/frame_times.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <json.hpp>
+
+#include "cgtub/log.hpp"
+
+using json = nlohmann::json;
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Nearest-rank percentile of sorted values
+double percentile(std::vector<double> const& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+FrameTimeHistory::FrameTimeHistory(size_t capacity)
+    : m_milliseconds(std::max<size_t>(capacity, 1))
+{
+}
+
+void FrameTimeHistory::add(double milliseconds)
+{
+    m_milliseconds[m_frame_count % m_milliseconds.size()] = milliseconds;
+    ++m_frame_count;
+}
+
+uint64_t FrameTimeHistory::frame_count() const
+{
+    return m_frame_count;
+}
+
+FrameTimeSummary FrameTimeHistory::summarize(size_t window) const
+{
+    std::vector<double> milliseconds;
+    collect(window, &milliseconds);
+    if (milliseconds.empty())
+        return FrameTimeSummary{};
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+
+    FrameTimeSummary summary;
+    summary.frames = milliseconds.size();
+    for (double ms : milliseconds)
+        summary.mean += ms;
+    summary.mean /= milliseconds.size();
+    summary.p50 = percentile(milliseconds, 0.50);
+    summary.p95 = percentile(milliseconds, 0.95);
+    summary.p99 = percentile(milliseconds, 0.99);
+    summary.max = milliseconds.back();
+    return summary;
+}
+
+void FrameTimeHistory::recent(size_t window, std::vector<float>* milliseconds) const
+{
+    std::vector<double> values;
+    collect(window, &values);
+    milliseconds->assign(values.begin(), values.end());
+}
+
+void FrameTimeHistory::histogram(size_t window, double max_milliseconds, std::span<float> bins) const
+{
+    std::fill(bins.begin(), bins.end(), 0.f);
+    if (bins.empty() || max_milliseconds <= 0.0)
+        return;
+
+    std::vector<double> milliseconds;
+    collect(window, &milliseconds);
+    for (double ms : milliseconds)
+    {
+        size_t bin = static_cast<size_t>(ms / max_milliseconds * bins.size());
+        bins[std::min(bin, bins.size() - 1)] += 1.f;
+    }
+}
+
+void FrameTimeHistory::collect(size_t window, std::vector<double>* milliseconds) const
+{
+    size_t capacity = m_milliseconds.size();
+    size_t count    = static_cast<size_t>(std::min<uint64_t>({window, capacity, m_frame_count}));
+
+    milliseconds->resize(count);
+    for (size_t i = 0; i < count; ++i)
+        (*milliseconds)[i] = m_milliseconds[(m_frame_count - count + i) % capacity];
+}
+
+bool FrameTimeStream::open(std::filesystem::path const& path)
+{
+    m_file.open(path, std::ios::out | std::ios::trunc);
+    if (!m_file)
+    {
+        log_message(LogLevel::Error, "FrameTimeStream::open(): could not open '%s'", path.string().c_str());
+        return false;
+    }
+
+    m_start = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool FrameTimeStream::is_open() const
+{
+    return m_file.is_open();
+}
+
+void FrameTimeStream::write(uint64_t frame, double milliseconds, FrameTimeSummary const* window)
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+    json line = {{"frame", frame}, {"time", seconds}, {"ms", milliseconds}};
+    if (window)
+    {
+        line["window"] = {{"frames", window->frames},
+                          {"mean", window->mean},
+                          {"p50", window->p50},
+                          {"p95", window->p95},
+                          {"p99", window->p99},
+                          {"max", window->max}};
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open())
+        m_file << line.dump() << std::endl;
+}
+
+} // namespace cgtub
@@ -232,4 +232,24 @@ void create_torus_geometry(float r, float R, std::vector<glm::vec3>* positions,
     return create_torus_geometry(16, 16, glm::vec3(r), glm::vec3(R), positions, indices);
 }
 
+void compute_vertex_normals(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::vector<glm::vec3>* normals)
+{
+    normals->assign(positions.size(), glm::vec3(0.f));
+
+    // The cross product's length is twice the triangle area, which weights the face normals
+    for (glm::u32vec3 const& tri : indices)
+    {
+        glm::vec3 face_normal = glm::cross(positions[tri.y] - positions[tri.x], positions[tri.z] - positions[tri.x]);
+        for (int k = 0; k < 3; ++k)
+            (*normals)[tri[k]] += face_normal;
+    }
+
+    for (glm::vec3& normal : *normals)
+    {
+        float length = glm::length(normal);
+        if (length > 0.f)
+            normal /= length;
+    }
+}
+
 } // namespace cgtub
\ No newline at end of file
@@ -0,0 +1,374 @@
+#include "cgtub/gltf_loader.hpp"
+
+#include <cstring>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <json.hpp>
+
+#include "cgtub/log.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+using json = nlohmann::json;
+
+// GLB container (all values are little-endian)
+constexpr uint32_t glb_magic      = 0x46546C67; // "glTF"
+constexpr uint32_t glb_version    = 2;
+constexpr uint32_t glb_chunk_json = 0x4E4F534A; // "JSON"
+constexpr uint32_t glb_chunk_bin  = 0x004E4942; // "BIN\0"
+
+constexpr int component_unsigned_byte  = 5121;
+constexpr int component_unsigned_short = 5123;
+constexpr int component_unsigned_int   = 5125;
+constexpr int component_float          = 5126;
+constexpr int mode_triangles           = 4;
+
+// The elements of an accessor within its buffer
+struct AccessorData
+{
+    std::byte const* data;
+    size_t           count;
+    size_t           stride;
+    int              component_type;
+    int              components;
+};
+
+uint32_t read_u32(std::span<std::byte const> data, size_t offset)
+{
+    uint32_t value;
+    std::memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+size_t component_size(int component_type)
+{
+    switch (component_type)
+    {
+    case component_unsigned_byte:
+        return 1;
+    case component_unsigned_short:
+        return 2;
+    case component_unsigned_int:
+    case component_float:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+int component_count(std::string const& type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+    return 0;
+}
+
+bool is_aligned(std::byte const* pointer, size_t alignment)
+{
+    return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+// Locates the data of an accessor, checking that all its elements lie within its buffer view and buffer
+bool resolve_accessor(json const& gltf, std::span<std::span<std::byte const> const> buffers, size_t accessor_index, AccessorData* accessor_data)
+{
+    json const& accessor = gltf.at("accessors").at(accessor_index);
+    if (accessor.contains("sparse") || !accessor.contains("bufferView"))
+        return false;
+
+    AccessorData data;
+    data.count          = accessor.at("count").get<size_t>();
+    data.component_type = accessor.at("componentType").get<int>();
+    data.components     = component_count(accessor.at("type").get<std::string>());
+
+    size_t element_size = component_size(data.component_type) * data.components;
+    if (element_size == 0)
+        return false;
+
+    json const& view        = gltf.at("bufferViews").at(accessor.at("bufferView").get<size_t>());
+    size_t      buffer      = view.at("buffer").get<size_t>();
+    size_t      view_offset = view.value("byteOffset", size_t(0));
+    size_t      view_length = view.at("byteLength").get<size_t>();
+    size_t      offset      = accessor.value("byteOffset", size_t(0));
+    data.stride             = view.value("byteStride", element_size);
+
+    if (buffer >= buffers.size() || view_offset > buffers[buffer].size() || view_length > buffers[buffer].size() - view_offset)
+        return false;
+    if (data.count > 0 && (data.stride < element_size || offset + (data.count - 1) * data.stride + element_size > view_length))
+        return false;
+
+    data.data      = buffers[buffer].data() + view_offset + offset;
+    *accessor_data = data;
+    return true;
+}
+
+glm::mat4 node_matrix(json const& node)
+{
+    if (node.contains("matrix"))
+    {
+        std::vector<float> matrix = node.at("matrix").get<std::vector<float>>();
+        return matrix.size() == 16 ? glm::make_mat4(matrix.data()) : glm::mat4(1.f);
+    }
+
+    std::vector<float> translation = node.value("translation", std::vector<float>{0.f, 0.f, 0.f});
+    std::vector<float> rotation    = node.value("rotation", std::vector<float>{0.f, 0.f, 0.f, 1.f});
+    std::vector<float> scale       = node.value("scale", std::vector<float>{1.f, 1.f, 1.f});
+    if (translation.size() != 3 || rotation.size() != 4 || scale.size() != 3)
+        return glm::mat4(1.f);
+
+    // glTF stores quaternions as (x, y, z, w)
+    return glm::translate(glm::mat4(1.f), glm::make_vec3(translation.data())) *
+           glm::mat4_cast(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2])) *
+           glm::scale(glm::mat4(1.f), glm::make_vec3(scale.data()));
+}
+
+void add_instances(json const& nodes, size_t node_index, glm::mat4 const& parent_matrix, size_t depth, size_t num_meshes, std::vector<GltfInstance>* instances)
+{
+    // A valid hierarchy cannot be deeper than the number of nodes (this stops at cycles)
+    if (node_index >= nodes.size() || depth > nodes.size())
+        return;
+
+    json const& node   = nodes[node_index];
+    glm::mat4   matrix = parent_matrix * node_matrix(node);
+
+    if (node.contains("mesh") && node.at("mesh").get<size_t>() < num_meshes)
+        instances->push_back(GltfInstance{node.at("mesh").get<uint32_t>(), matrix});
+
+    for (size_t child : node.value("children", std::vector<size_t>{}))
+        add_instances(nodes, child, matrix, depth + 1, num_meshes, instances);
+}
+
+} // namespace
+
+bool GltfScene::open(std::filesystem::path const& path)
+{
+    m_files.clear();
+    m_converted_positions.clear();
+    m_converted_indices.clear();
+    m_meshes.clear();
+    m_instances.clear();
+
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+
+    // A .glb file holds a JSON chunk and an optional binary chunk, anything else is treated as a .gltf JSON file
+    std::span<std::byte const> data      = file.data();
+    std::span<std::byte const> json_data = data;
+    std::span<std::byte const> binary_data;
+    if (data.size() >= 12 && read_u32(data, 0) == glb_magic)
+    {
+        size_t length = read_u32(data, 8);
+        if (read_u32(data, 4) != glb_version || length > data.size() || length < 20 ||
+            read_u32(data, 16) != glb_chunk_json || read_u32(data, 12) > length - 20)
+        {
+            log_message(LogLevel::Error, "GltfScene::open: '%s' is not a valid glTF 2.0 binary file", path.string().c_str());
+            return false;
+        }
+
+        size_t json_length = read_u32(data, 12);
+        json_data          = data.subspan(20, json_length);
+
+        size_t binary_chunk = 20 + json_length;
+        if (binary_chunk + 8 <= length && read_u32(data, binary_chunk + 4) == glb_chunk_bin &&
+            read_u32(data, binary_chunk) <= length - binary_chunk - 8)
+            binary_data = data.subspan(binary_chunk + 8, read_u32(data, binary_chunk));
+    }
+    m_files.push_back(std::move(file));
+
+    json gltf = json::parse(reinterpret_cast<char const*>(json_data.data()),
+                            reinterpret_cast<char const*>(json_data.data() + json_data.size()), nullptr, false);
+    if (gltf.is_discarded() || !gltf.is_object())
+    {
+        log_message(LogLevel::Error, "GltfScene::open: '%s' contains invalid JSON", path.string().c_str());
+        return false;
+    }
+
+    try
+    {
+        // Buffers without a URI refer to the binary chunk, the others to files next to the glTF file.
+        // All of them stay mapped for as long as the scene exists, the primitives point into them.
+        std::vector<std::span<std::byte const>> buffers;
+        for (json const& buffer : gltf.value("buffers", json::array()))
+        {
+            if (!buffer.contains("uri"))
+            {
+                buffers.push_back(binary_data);
+                continue;
+            }
+
+            // Buffers that cannot be mapped stay empty, so accessors into them are rejected
+            std::string uri = buffer.at("uri").get<std::string>();
+            MappedFile  buffer_file;
+            if (uri.starts_with("data:"))
+                log_message(LogLevel::Warn, "GltfScene::open: '%s' embeds a buffer as data URI, which is not supported", path.string().c_str());
+            else
+                buffer_file.open(path.parent_path() / uri);
+
+            buffers.push_back(buffer_file.data());
+            m_files.push_back(std::move(buffer_file));
+        }
+
+        for (json const& mesh : gltf.value("meshes", json::array()))
+        {
+            GltfMesh gltf_mesh;
+            for (json const& primitive : mesh.at("primitives"))
+            {
+                json const& attributes = primitive.at("attributes");
+                if (primitive.value("mode", mode_triangles) != mode_triangles || !attributes.contains("POSITION"))
+                    continue;
+
+                size_t       position_accessor = attributes.at("POSITION").get<size_t>();
+                AccessorData positions;
+                if (!resolve_accessor(gltf, buffers, position_accessor, &positions) ||
+                    positions.component_type != component_float || positions.components != 3)
+                {
+                    log_message(LogLevel::Warn, "GltfScene::open: Skipping a primitive with unsupported positions in '%s'", path.string().c_str());
+                    continue;
+                }
+
+                GltfPrimitive gltf_primitive;
+                if (positions.stride == sizeof(glm::vec3) && is_aligned(positions.data, alignof(glm::vec3)))
+                    gltf_primitive.positions = std::span<glm::vec3 const>(reinterpret_cast<glm::vec3 const*>(positions.data), positions.count);
+                else
+                {
+                    std::vector<glm::vec3>& converted = m_converted_positions.emplace_back(positions.count);
+                    for (size_t v = 0; v < positions.count; ++v)
+                        std::memcpy(&converted[v], positions.data + v * positions.stride, sizeof(glm::vec3));
+                    gltf_primitive.positions = converted;
+                }
+
+                // Position accessors store their bounds, which saves touching the positions
+                json const& accessor = gltf.at("accessors").at(position_accessor);
+                if (accessor.contains("min") && accessor.contains("max"))
+                {
+                    std::vector<float> min = accessor.at("min").get<std::vector<float>>();
+                    std::vector<float> max = accessor.at("max").get<std::vector<float>>();
+                    if (min.size() == 3 && max.size() == 3)
+                    {
+                        gltf_primitive.bounds.center = 0.5f * (glm::make_vec3(min.data()) + glm::make_vec3(max.data()));
+                        gltf_primitive.bounds.radius = 0.5f * glm::length(glm::make_vec3(max.data()) - glm::make_vec3(min.data()));
+                    }
+                    else
+                        gltf_primitive.bounds = compute_bounding_sphere(gltf_primitive.positions);
+                }
+                else
+                    gltf_primitive.bounds = compute_bounding_sphere(gltf_primitive.positions);
+
+                if (!primitive.contains("indices"))
+                {
+                    // Non-indexed triangle lists use consecutive vertices
+                    std::vector<glm::u32vec3>& converted = m_converted_indices.emplace_back(positions.count / 3);
+                    for (size_t t = 0; t < converted.size(); ++t)
+                        converted[t] = glm::u32vec3(3 * t, 3 * t + 1, 3 * t + 2);
+                    gltf_primitive.indices = converted;
+                    gltf_mesh.primitives.push_back(gltf_primitive);
+                    continue;
+                }
+
+                AccessorData indices;
+                if (!resolve_accessor(gltf, buffers, primitive.at("indices").get<size_t>(), &indices) ||
+                    indices.components != 1 || indices.count % 3 != 0 ||
+                    (indices.component_type != component_unsigned_byte && indices.component_type != component_unsigned_short &&
+                     indices.component_type != component_unsigned_int))
+                {
+                    log_message(LogLevel::Warn, "GltfScene::open: Skipping a primitive with unsupported indices in '%s'", path.string().c_str());
+                    continue;
+                }
+
+                if (indices.component_type == component_unsigned_int && indices.stride == sizeof(uint32_t) && is_aligned(indices.data, alignof(glm::u32vec3)))
+                    gltf_primitive.indices = std::span<glm::u32vec3 const>(reinterpret_cast<glm::u32vec3 const*>(indices.data), indices.count / 3);
+                else
+                {
+                    // Narrower or strided indices are widened
+                    std::vector<glm::u32vec3>& converted = m_converted_indices.emplace_back(indices.count / 3);
+                    for (size_t i = 0; i < indices.count; ++i)
+                    {
+                        std::byte const* index = indices.data + i * indices.stride;
+                        uint32_t         value = 0;
+                        if (indices.component_type == component_unsigned_byte)
+                            value = static_cast<uint8_t>(*index);
+                        else if (indices.component_type == component_unsigned_short)
+                        {
+                            uint16_t short_value;
+                            std::memcpy(&short_value, index, sizeof(short_value));
+                            value = short_value;
+                        }
+                        else
+                            std::memcpy(&value, index, sizeof(value));
+                        converted[i / 3][i % 3] = value;
+                    }
+                    gltf_primitive.indices = converted;
+                }
+
+                // The rasterizer does not check indices, so a primitive must not refer to nonexistent vertices
+                bool valid = true;
+                for (glm::u32vec3 const& tri : gltf_primitive.indices)
+                    valid &= tri.x < positions.count && tri.y < positions.count && tri.z < positions.count;
+                if (!valid)
+                {
+                    log_message(LogLevel::Warn, "GltfScene::open: Skipping a primitive with out-of-range indices in '%s'", path.string().c_str());
+                    continue;
+                }
+
+                gltf_mesh.primitives.push_back(gltf_primitive);
+            }
+            m_meshes.push_back(std::move(gltf_mesh));
+        }
+
+        // Instantiate the meshes of the default scene (or, without scenes, of all root nodes)
+        json const&         nodes = gltf.value("nodes", json::array());
+        std::vector<size_t> roots;
+        if (gltf.contains("scenes"))
+            roots = gltf.at("scenes").at(gltf.value("scene", size_t(0))).value("nodes", std::vector<size_t>{});
+        else
+        {
+            std::vector<bool> is_child(nodes.size(), false);
+            for (json const& node : nodes)
+                for (size_t child : node.value("children", std::vector<size_t>{}))
+                    if (child < nodes.size())
+                        is_child[child] = true;
+            for (size_t node = 0; node < nodes.size(); ++node)
+                if (!is_child[node])
+                    roots.push_back(node);
+        }
+
+        for (size_t root : roots)
+            add_instances(nodes, root, glm::mat4(1.f), 0, m_meshes.size(), &m_instances);
+    }
+    catch (json::exception const& e)
+    {
+        log_message(LogLevel::Error, "GltfScene::open: '%s' is not a valid glTF file (%s)", path.string().c_str(), e.what());
+        m_meshes.clear();
+        m_instances.clear();
+        return false;
+    }
+
+    log_message(LogLevel::Debug, "GltfScene::open: '%s' has %zu meshes and %zu mesh instances", path.string().c_str(), m_meshes.size(), m_instances.size());
+
+    return true;
+}
+
+std::span<GltfMesh const> GltfScene::meshes() const
+{
+    return m_meshes;
+}
+
+std::span<GltfInstance const> GltfScene::instances() const
+{
+    return m_instances;
+}
+
+} // namespace cgtub
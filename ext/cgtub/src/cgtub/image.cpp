@@ -1,13 +1,185 @@
 #include "cgtub/image.hpp"
+#include "cgtub/log.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
 
 #include <stb_image.h>
 
 namespace cgtub
 {
 
+namespace
+{
+
+uint8_t to_byte(float value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+uint32_t update_crc32(uint32_t crc, uint8_t const* data, size_t size)
+{
+    static std::array<uint32_t, 256> const table = []
+    {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void append_u32_be(uint32_t value, std::vector<uint8_t>* bytes)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        bytes->push_back(static_cast<uint8_t>(value >> shift));
+}
+
+void append_png_chunk(char const* type, std::vector<uint8_t> const& data, std::vector<uint8_t>* png)
+{
+    append_u32_be(static_cast<uint32_t>(data.size()), png);
+    size_t type_offset = png->size();
+    png->insert(png->end(), type, type + 4);
+    png->insert(png->end(), data.begin(), data.end());
+    append_u32_be(update_crc32(0, png->data() + type_offset, png->size() - type_offset), png);
+}
+
+// Encodes an 8-bit RGB PNG whose image data is a zlib stream of stored (uncompressed) deflate blocks
+std::vector<uint8_t> encode_png(std::span<glm::vec3 const> pixels, int width, int height)
+{
+    // Scanlines from top to bottom, each starting with filter type 0 (none)
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve(size_t(height) * (size_t(width) * 3 + 1));
+    for (int y = height - 1; y >= 0; --y)
+    {
+        scanlines.push_back(0);
+        for (int x = 0; x < width; ++x)
+        {
+            glm::vec3 const& color = pixels[size_t(y) * width + x];
+            scanlines.push_back(to_byte(color.r));
+            scanlines.push_back(to_byte(color.g));
+            scanlines.push_back(to_byte(color.b));
+        }
+    }
+
+    constexpr size_t     max_block_size = 65535;
+    std::vector<uint8_t> zlib           = {0x78, 0x01};
+    zlib.reserve(scanlines.size() + (scanlines.size() / max_block_size + 1) * 5 + 6);
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    size_t   offset  = 0;
+    do
+    {
+        size_t  block_size = std::min(max_block_size, scanlines.size() - offset);
+        bool    is_final   = offset + block_size == scanlines.size();
+        uint8_t header[]   = {static_cast<uint8_t>(is_final ? 1 : 0),
+                              static_cast<uint8_t>(block_size), static_cast<uint8_t>(block_size >> 8),
+                              static_cast<uint8_t>(~block_size), static_cast<uint8_t>(~block_size >> 8)};
+        zlib.insert(zlib.end(), std::begin(header), std::end(header));
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+
+        for (size_t i = offset; i < offset + block_size; ++i)
+        {
+            adler_a = (adler_a + scanlines[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+        offset += block_size;
+    } while (offset < scanlines.size());
+    append_u32_be((adler_b << 16) | adler_a, &zlib);
+
+    std::vector<uint8_t> header;
+    append_u32_be(static_cast<uint32_t>(width), &header);
+    append_u32_be(static_cast<uint32_t>(height), &header);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bits per channel, RGB, deflate, no interlacing
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    append_png_chunk("IHDR", header, &png);
+    append_png_chunk("IDAT", zlib, &png);
+    append_png_chunk("IEND", {}, &png);
+    return png;
+}
+
+std::vector<uint8_t> encode_ppm(std::span<glm::vec3 const> pixels, int width, int height)
+{
+    std::string          header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    std::vector<uint8_t> ppm(header.begin(), header.end());
+    ppm.reserve(ppm.size() + size_t(width) * height * 3);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            glm::vec3 const& color = pixels[size_t(y) * width + x];
+            ppm.push_back(to_byte(color.r));
+            ppm.push_back(to_byte(color.g));
+            ppm.push_back(to_byte(color.b));
+        }
+    }
+    return ppm;
+}
+
+// PFM files store the rows from bottom to top, so the pixels are written as they are
+std::vector<uint8_t> encode_pfm(std::span<glm::vec3 const> pixels, int width, int height)
+{
+    // The sign of the scale gives the byte order of the floats (negative for little endian)
+    char const*          scale  = std::endian::native == std::endian::little ? "-1.0" : "1.0";
+    std::string          header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n" + scale + "\n";
+    std::vector<uint8_t> pfm(header.begin(), header.end());
+    size_t               offset = pfm.size();
+    pfm.resize(offset + sizeof(glm::vec3) * size_t(width) * height);
+    std::memcpy(pfm.data() + offset, pixels.data(), sizeof(glm::vec3) * size_t(width) * height);
+    return pfm;
+}
+
+bool read_pfm(std::filesystem::path const& path, std::vector<glm::vec3>* pixels, int* width, int* height)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string   format;
+    float         scale = 0.f;
+    file >> format >> *width >> *height >> scale;
+    file.get(); // The single whitespace character before the pixels
+    if (!file || format != "PF" || *width <= 0 || *height <= 0)
+        return false;
+
+    pixels->resize(size_t(*width) * *height);
+    file.read(reinterpret_cast<char*>(pixels->data()), static_cast<std::streamsize>(sizeof(glm::vec3) * pixels->size()));
+    if (!file)
+        return false;
+
+    // A negative scale means little endian
+    if ((scale < 0.f) != (std::endian::native == std::endian::little))
+    {
+        for (glm::vec3& pixel : *pixels)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &pixel[c], sizeof(bits));
+                bits = (bits >> 24) | ((bits >> 8) & 0xFF00u) | ((bits << 8) & 0xFF0000u) | (bits << 24);
+                std::memcpy(&pixel[c], &bits, sizeof(bits));
+            }
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
 Image::Image()
     : m_width(0)
     , m_height(0)
@@ -111,4 +283,71 @@ glm::vec3& Image::operator()(unsigned int x, unsigned int y)
     return m_data[y * m_width + x];
 }
 
-} // namespace cgtub
\ No newline at end of file
+bool write_image(std::filesystem::path const& path, std::span<glm::vec3 const> pixels, int width, int height)
+{
+    if (width <= 0 || height <= 0 || pixels.size() < size_t(width) * height)
+    {
+        log_message(LogLevel::Error, "write_image(): Image with (width, height) = (%d, %d) has %zu pixels", width, height, pixels.size());
+        return false;
+    }
+
+    std::string          extension = path.extension().string();
+    std::vector<uint8_t> data;
+    if (extension == ".png")
+        data = encode_png(pixels, width, height);
+    else if (extension == ".ppm")
+        data = encode_ppm(pixels, width, height);
+    else if (extension == ".pfm")
+        data = encode_pfm(pixels, width, height);
+    else
+    {
+        log_message(LogLevel::Error, "write_image(): Unsupported image format '%s'", extension.c_str());
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file)
+    {
+        log_message(LogLevel::Error, "write_image(): Failed to write '%s'", path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool read_image(std::filesystem::path const& path, std::vector<glm::vec3>* pixels, int* width, int* height)
+{
+    if (path.extension() == ".pfm")
+    {
+        if (!read_pfm(path, pixels, width, height))
+        {
+            log_message(LogLevel::Error, "read_image(): Failed to read '%s'", path.string().c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int            n_channels;
+    unsigned char* data = stbi_load(path.string().c_str(), width, height, &n_channels, 3);
+    if (data == NULL)
+    {
+        log_message(LogLevel::Error, "read_image(): Failed to read '%s'", path.string().c_str());
+        return false;
+    }
+
+    // The files store the rows from top to bottom
+    pixels->resize(size_t(*width) * *height);
+    for (int y = 0; y < *height; ++y)
+    {
+        unsigned char const* row = data + size_t(*height - 1 - y) * *width * 3;
+        for (int x = 0; x < *width; ++x)
+            (*pixels)[size_t(y) * *width + x] = glm::vec3(row[3 * x], row[3 * x + 1], row[3 * x + 2]) / 255.f;
+    }
+
+    stbi_image_free(data);
+
+    return true;
+}
+
+} // namespace cgtub
@@ -82,25 +82,41 @@ void ImageRenderer::update_texture(std::span<glm::vec3 const> image, int width,
 }
 
 void ImageRenderer::render(std::span<glm::vec3 const> image, int width, int height)
+{
+    if (upload(image, width, height))
+        render();
+}
+
+bool ImageRenderer::upload(std::span<glm::vec3 const> image, int width, int height)
 {
     if (image.empty())
     {
-        log_message(LogLevel::Warn, "ImageRenderer::render(): No pixel colors provided for the image. Did you forget to populate an array?");
-        return;
+        log_message(LogLevel::Warn, "ImageRenderer::upload(): No pixel colors provided for the image. Did you forget to populate an array?");
+        return false;
     }
 
     if (width < 0 || height < 0)
     {
-        log_message(LogLevel::Error, "ImageRenderer::render(): Image has negative extent with (width, height) = (%d, %d), nothing is rendered.", width, height);
-        return;
+        log_message(LogLevel::Error, "ImageRenderer::upload(): Image has negative extent with (width, height) = (%d, %d), nothing is rendered.", width, height);
+        return false;
     }
 
     if (width == 0 || height == 0)
     {
-        log_message(LogLevel::Warn, "ImageRenderer::render(): Image has zero extent with (width, height) = (%d, %d), nothing is rendered.", width, height);
-        return;
+        log_message(LogLevel::Warn, "ImageRenderer::upload(): Image has zero extent with (width, height) = (%d, %d), nothing is rendered.", width, height);
+        return false;
     }
 
+    update_texture(image, width, height);
+    m_has_image = true;
+    return true;
+}
+
+void ImageRenderer::render()
+{
+    if (!m_has_image)
+        return;
+
     Rect viewport = m_canvas.viewport();
     if (viewport.width == 0 || viewport.height == 0)
     {
@@ -108,8 +124,6 @@ void ImageRenderer::render(std::span<glm::vec3 const> image, int width, int heig
         return;
     }
 
-    update_texture(image, width, height);
-
     set_viewport(m_canvas.window(), m_canvas.viewport());
 
     glUseProgram(m_program);
@@ -126,4 +140,4 @@ void ImageRenderer::render(std::span<glm::vec3 const> image, int width, int heig
     glUseProgram(0);
 }
 
-} // namespace cgtub
\ No newline at end of file
+} // namespace cgtub
@@ -0,0 +1,250 @@
+#include "cgtub/lod.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+#include "cgtub/geometry.hpp"
+#include "cgtub/simplify.hpp"
+#include "cgtub/vertex_transform.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Appends a level with the given geometry to the mesh (the vertices are appended to the shared buffer)
+void append_level(std::vector<glm::vec3>&& positions, std::vector<glm::u32vec3>&& indices, LodMesh* mesh)
+{
+    LodLevel level;
+    level.vertex_cache_stats = optimize_mesh(&positions, &indices);
+    level.first_vertex       = static_cast<uint32_t>(mesh->positions.size());
+    level.vertex_count       = static_cast<uint32_t>(positions.size());
+    level.indices            = std::move(indices);
+
+    mesh->positions.insert(mesh->positions.end(), positions.begin(), positions.end());
+    mesh->levels.push_back(std::move(level));
+}
+
+template<typename CreateGeometry>
+void create_procedural_lod_mesh(unsigned int n, unsigned int m, unsigned int num_levels, CreateGeometry const& create_geometry, LodMesh* mesh)
+{
+    mesh->positions.clear();
+    mesh->levels.clear();
+
+    std::vector<glm::vec3>    positions;
+    std::vector<glm::u32vec3> indices;
+    for (unsigned int level = 0; level < num_levels && n >= 4 && m >= 4; ++level, n /= 2, m /= 2)
+    {
+        create_geometry(n, m, &positions, &indices);
+        append_level(std::move(positions), std::move(indices), mesh);
+    }
+
+    mesh->bounds = compute_bounding_sphere(mesh->positions);
+}
+
+// Level selection for any mesh representation, given the number of levels and the triangle count of each level
+template<typename TriangleCount>
+uint32_t select_level(size_t num_levels, TriangleCount const& triangle_count, float projected_area, float triangles_per_pixel, uint32_t current_level, float hysteresis)
+{
+    if (num_levels == 0)
+        return 0;
+
+    float target_triangles = projected_area * triangles_per_pixel;
+    current_level          = std::min<uint32_t>(current_level, static_cast<uint32_t>(num_levels - 1));
+
+    // Refine immediately if the current level is too coarse
+    uint32_t level = current_level;
+    while (level > 0 && triangle_count(level) < target_triangles)
+        --level;
+    if (level != current_level)
+        return level;
+
+    // Coarsen only while the next coarser level stays clearly above the target
+    while (level + 1 < num_levels && triangle_count(level + 1) >= (1.f + hysteresis) * target_triangles)
+        ++level;
+
+    return level;
+}
+
+} // namespace
+
+void create_sphere_lod_mesh(unsigned int n, unsigned int m, glm::vec3 scale, unsigned int num_levels, LodMesh* mesh)
+{
+    create_procedural_lod_mesh(n, m, num_levels, [&](unsigned int level_n, unsigned int level_m, std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices)
+                               { create_sphere_geometry(level_n, level_m, scale, positions, indices); }, mesh);
+}
+
+void create_torus_lod_mesh(unsigned int n, unsigned int m, glm::vec3 r, glm::vec3 R, unsigned int num_levels, LodMesh* mesh)
+{
+    create_procedural_lod_mesh(n, m, num_levels, [&](unsigned int level_n, unsigned int level_m, std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices)
+                               { create_torus_geometry(level_n, level_m, r, R, positions, indices); }, mesh);
+}
+
+void create_simplified_lod_mesh(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, unsigned int num_levels, float reduction, LodMesh* mesh)
+{
+    mesh->positions.clear();
+    mesh->levels.clear();
+
+    std::vector<size_t> target_triangle_counts;
+    for (unsigned int level = 1; level < num_levels; ++level)
+        target_triangle_counts.push_back(static_cast<size_t>(indices.size() * std::pow(reduction, static_cast<float>(level))));
+
+    std::vector<std::vector<glm::u32vec3>> levels;
+    simplify_mesh_chain(positions, indices, target_triangle_counts, &levels);
+    levels.insert(levels.begin(), std::vector<glm::u32vec3>(indices.begin(), indices.end()));
+
+    // Drop levels at which the simplification stalled
+    auto stalled = std::unique(levels.begin(), levels.end(), [](auto const& finer, auto const& coarser)
+                               { return finer.size() == coarser.size(); });
+    levels.erase(stalled, levels.end());
+
+    // The coarsest level that uses a vertex determines its position in the reordered vertex buffer
+    constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> coarsest_level(positions.size(), unused);
+    for (uint32_t level = 0; level < levels.size(); ++level)
+        for (glm::u32vec3 const& tri : levels[level])
+            for (int k = 0; k < 3; ++k)
+                coarsest_level[tri[k]] = level;
+
+    std::vector<uint32_t> order;
+    for (uint32_t v = 0; v < positions.size(); ++v)
+        if (coarsest_level[v] != unused)
+            order.push_back(v);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                     { return coarsest_level[a] > coarsest_level[b]; });
+
+    std::vector<uint32_t> remap(positions.size(), unused);
+    mesh->positions.resize(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+        remap[order[i]]    = i;
+        mesh->positions[i] = positions[order[i]];
+    }
+
+    for (uint32_t level = 0; level < levels.size(); ++level)
+    {
+        LodLevel lod_level;
+        lod_level.first_vertex = 0;
+        lod_level.vertex_count = static_cast<uint32_t>(std::count_if(order.begin(), order.end(), [&](uint32_t v)
+                                                                     { return coarsest_level[v] >= level; }));
+        std::vector<glm::u32vec3> level_indices;
+        level_indices.reserve(levels[level].size());
+        for (glm::u32vec3 const& tri : levels[level])
+            level_indices.emplace_back(remap[tri.x], remap[tri.y], remap[tri.z]);
+
+        // The vertex order is fixed by the levels sharing prefixes of the vertex buffer, so only the triangles are reordered
+        lod_level.vertex_cache_stats.acmr_before = compute_acmr(level_indices, lod_level.vertex_count);
+        optimize_vertex_cache(level_indices, lod_level.vertex_count, &lod_level.indices);
+        lod_level.vertex_cache_stats.acmr_after = compute_acmr(lod_level.indices, lod_level.vertex_count);
+
+        mesh->levels.push_back(std::move(lod_level));
+    }
+
+    mesh->bounds = compute_bounding_sphere(mesh->positions);
+}
+
+void build_lod_meshlets(LodMesh* mesh)
+{
+    std::vector<glm::u32vec3> reordered;
+    for (LodLevel& level : mesh->levels)
+    {
+        std::span<glm::vec3 const> positions(mesh->positions.data() + level.first_vertex, level.vertex_count);
+        build_meshlets(positions, level.indices, &level.meshlets, &reordered);
+
+        // Restore a vertex cache friendly order within each meshlet. The meshlet vertices are
+        // numbered locally, so the optimization only costs time in the size of the meshlet.
+        std::vector<uint32_t> local_index(level.vertex_count, unused_vertex);
+        level.indices.clear();
+        for (Meshlet const& meshlet : level.meshlets)
+        {
+            std::span<glm::u32vec3 const> triangles(reordered.data() + meshlet.first_triangle, meshlet.triangle_count);
+
+            std::vector<uint32_t>     global_index;
+            std::vector<glm::u32vec3> local_triangles;
+            for (glm::u32vec3 const& tri : triangles)
+            {
+                glm::u32vec3 local_tri;
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (local_index[tri[k]] == unused_vertex)
+                    {
+                        local_index[tri[k]] = static_cast<uint32_t>(global_index.size());
+                        global_index.push_back(tri[k]);
+                    }
+                    local_tri[k] = local_index[tri[k]];
+                }
+                local_triangles.push_back(local_tri);
+            }
+
+            std::vector<glm::u32vec3> optimized;
+            optimize_vertex_cache(local_triangles, global_index.size(), &optimized);
+            for (glm::u32vec3 const& tri : optimized)
+                level.indices.emplace_back(global_index[tri.x], global_index[tri.y], global_index[tri.z]);
+
+            for (uint32_t v : global_index)
+                local_index[v] = unused_vertex;
+        }
+        level.vertex_cache_stats.acmr_after = compute_acmr(level.indices, level.vertex_count);
+    }
+}
+
+float compute_projected_area(BoundingSphere const& sphere, glm::mat4 const& view, glm::mat4 const& projection, int viewport_height)
+{
+    glm::vec4 center_view = view * glm::vec4(sphere.center, 1.f);
+
+    // Homogeneous w of the sphere center (the view space depth for perspective projections, 1 for orthographic ones)
+    float w = projection[2][3] * center_view.z + projection[3][3];
+    if (w <= sphere.radius * std::abs(projection[2][3]))
+        return std::numeric_limits<float>::infinity();
+
+    float radius_pixels = sphere.radius * projection[1][1] * 0.5f * viewport_height / w;
+
+    return std::numbers::pi_v<float> * radius_pixels * radius_pixels;
+}
+
+LodMeshView make_lod_mesh_view(LodMesh const& mesh)
+{
+    LodMeshView view;
+    view.positions = mesh.positions;
+    view.bounds    = mesh.bounds;
+    for (LodLevel const& level : mesh.levels)
+        view.levels.push_back(LodLevelView{level.first_vertex, level.vertex_count, level.indices, level.meshlets});
+
+    return view;
+}
+
+void transform_lod_level(LodMeshView const& mesh, LodLevelView const& level, glm::mat4 const& matrix, std::vector<glm::vec4>* output)
+{
+    output->resize(level.vertex_count);
+    transform_lod_level(mesh, level, matrix, std::span<glm::vec4>(*output));
+}
+
+void transform_lod_level(LodMeshView const& mesh, LodLevelView const& level, glm::mat4 const& matrix, std::span<glm::vec4> output)
+{
+    if (!mesh.positions.empty())
+        transform_points(matrix, mesh.positions.subspan(level.first_vertex, level.vertex_count), output);
+    else
+        transform_points(matrix,
+                         mesh.xs.subspan(level.first_vertex, level.vertex_count),
+                         mesh.ys.subspan(level.first_vertex, level.vertex_count),
+                         mesh.zs.subspan(level.first_vertex, level.vertex_count),
+                         output);
+}
+
+uint32_t select_lod_level(LodMesh const& mesh, float projected_area, float triangles_per_pixel, uint32_t current_level, float hysteresis)
+{
+    return select_level(mesh.levels.size(), [&](size_t level)
+                        { return mesh.levels[level].indices.size(); }, projected_area, triangles_per_pixel, current_level, hysteresis);
+}
+
+uint32_t select_lod_level(LodMeshView const& mesh, float projected_area, float triangles_per_pixel, uint32_t current_level, float hysteresis)
+{
+    return select_level(mesh.levels.size(), [&](size_t level)
+                        { return mesh.levels[level].indices.size(); }, projected_area, triangles_per_pixel, current_level, hysteresis);
+}
+
+} // namespace cgtub
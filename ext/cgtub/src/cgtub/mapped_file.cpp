@@ -0,0 +1,182 @@
+#include "cgtub/mapped_file.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cgtub/log.hpp"
+
+namespace cgtub
+{
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_open(std::exchange(other.m_open, false))
+#ifdef _WIN32
+    , m_file(std::exchange(other.m_file, nullptr))
+    , m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_open, other.m_open);
+#ifdef _WIN32
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#endif
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(std::filesystem::path const& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        log_message(LogLevel::Error, "MappedFile::open: Failed to open '%s'", path.string().c_str());
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    m_file = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files cannot be mapped (but are valid)
+    m_open = true;
+    if (m_size == 0)
+        return true;
+
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+        m_data = static_cast<std::byte const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        log_message(LogLevel::Error, "MappedFile::open: Failed to open '%s'", path.string().c_str());
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        ::close(file);
+        log_message(LogLevel::Error, "MappedFile::open: Failed to query the size of '%s'", path.string().c_str());
+        return false;
+    }
+    m_size = static_cast<size_t>(status.st_size);
+
+    // Empty files cannot be mapped (but are valid)
+    m_open = true;
+    if (m_size == 0)
+    {
+        ::close(file);
+        return true;
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data != MAP_FAILED)
+        m_data = static_cast<std::byte const*>(data);
+#endif
+
+    if (!m_data)
+    {
+        log_message(LogLevel::Error, "MappedFile::open: Failed to map '%s'", path.string().c_str());
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file    = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+bool MappedFile::is_open() const
+{
+    return m_open;
+}
+
+std::span<std::byte const> MappedFile::data() const
+{
+    return std::span<std::byte const>(m_data, m_size);
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+    size = std::min(size, m_size - offset);
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::byte*>(m_data + offset), size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // The range has to start at a page boundary
+    size_t page_offset = offset % static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    madvise(const_cast<std::byte*>(m_data + offset - page_offset), size + page_offset, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::discard(size_t offset, size_t size) const
+{
+    if (!m_data || offset >= m_size)
+        return;
+
+    size = std::min(size, m_size - offset);
+#ifdef _WIN32
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(const_cast<std::byte*>(m_data + offset), size);
+#else
+    // Only whole pages within the range can be released
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin     = (offset + page_size - 1) / page_size * page_size;
+    size_t end       = offset + size == m_size ? m_size : (offset + size) / page_size * page_size;
+    if (begin < end)
+        madvise(const_cast<std::byte*>(m_data + begin), end - begin, MADV_DONTNEED);
+#endif
+}
+
+} // namespace cgtub
@@ -0,0 +1,367 @@
+#include "cgtub/mesh_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "cgtub/geometry.hpp"
+#include "cgtub/log.hpp"
+#include "cgtub/obj_loader.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+constexpr char     cache_magic[8]    = {'C', 'G', 'M', 'E', 'S', 'H', '\0', '\0'};
+constexpr uint32_t cache_version     = 2;
+constexpr uint32_t cache_byte_order  = 0x01020304;
+constexpr uint64_t cache_alignment   = 64;
+constexpr char     cache_extension[] = ".cgmesh";
+
+struct CacheHeader
+{
+    char           magic[8];
+    uint32_t       version;
+    uint32_t       byte_order;
+    uint64_t       vertex_count;
+    uint64_t       level_count;
+    uint32_t       num_levels; // The import settings (see `load_mesh_cached`), a cache written with others is stale
+    float          reduction;
+    BoundingSphere bounds;
+    uint64_t       levels_offset;
+    uint64_t       xs_offset;
+    uint64_t       ys_offset;
+    uint64_t       zs_offset;
+    uint64_t       normals_offset;
+};
+
+struct CacheLevel
+{
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint64_t triangle_count;
+    uint64_t indices_offset;
+    uint64_t meshlet_count;
+    uint64_t meshlets_offset;
+};
+
+static_assert(std::is_trivially_copyable_v<CacheHeader> && std::is_trivially_copyable_v<CacheLevel> && std::is_trivially_copyable_v<Meshlet>);
+
+uint64_t align(uint64_t offset)
+{
+    return (offset + cache_alignment - 1) / cache_alignment * cache_alignment;
+}
+
+// Writes a range of trivially copyable values at the given (aligned) offset, padding the file up to it
+template<typename T>
+void write_at(std::ofstream& file, uint64_t offset, std::span<T const> values)
+{
+    static char const padding[cache_alignment] = {};
+    uint64_t          position                 = static_cast<uint64_t>(file.tellp());
+    file.write(padding, static_cast<std::streamsize>(offset - position));
+    file.write(reinterpret_cast<char const*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+}
+
+// Returns the typed range at `offset` if it lies within the file
+template<typename T>
+bool get_range(std::span<std::byte const> data, uint64_t offset, uint64_t count, std::span<T const>* range)
+{
+    if (offset % alignof(T) != 0 || offset > data.size() || count > (data.size() - offset) / sizeof(T))
+        return false;
+
+    *range = std::span<T const>(reinterpret_cast<T const*>(data.data() + offset), count);
+    return true;
+}
+
+// True if all indices refer to one of the first `vertex_count` vertices
+bool are_indices_valid(std::span<glm::u32vec3 const> indices, uint32_t vertex_count)
+{
+    for (glm::u32vec3 const& triangle : indices)
+    {
+        if (triangle.x >= vertex_count || triangle.y >= vertex_count || triangle.z >= vertex_count)
+            return false;
+    }
+    return true;
+}
+
+// True if all meshlets cover triangles of a level with `triangle_count` triangles
+bool are_meshlets_valid(std::span<Meshlet const> meshlets, uint64_t triangle_count)
+{
+    for (Meshlet const& meshlet : meshlets)
+    {
+        if (static_cast<uint64_t>(meshlet.first_triangle) + meshlet.triangle_count > triangle_count)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+uint32_t encode_normal(glm::vec3 const& normal)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+    glm::vec3 n = normal / std::max(std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z), 1e-20f);
+    glm::vec2 o(n.x, n.y);
+    if (n.z < 0.f)
+        o = (1.f - glm::abs(glm::vec2(o.y, o.x))) * glm::vec2(o.x >= 0.f ? 1.f : -1.f, o.y >= 0.f ? 1.f : -1.f);
+
+    auto quantize = [](float v)
+    { return static_cast<uint32_t>(static_cast<uint16_t>(static_cast<int16_t>(std::round(std::clamp(v, -1.f, 1.f) * 32767.f)))); };
+
+    return quantize(o.x) | (quantize(o.y) << 16);
+}
+
+glm::vec3 decode_normal(uint32_t packed)
+{
+    glm::vec2 o(static_cast<int16_t>(packed & 0xFFFF) / 32767.f, static_cast<int16_t>(packed >> 16) / 32767.f);
+
+    glm::vec3 n(o.x, o.y, 1.f - std::abs(o.x) - std::abs(o.y));
+    if (n.z < 0.f)
+    {
+        n.x = (1.f - std::abs(o.y)) * (o.x >= 0.f ? 1.f : -1.f);
+        n.y = (1.f - std::abs(o.x)) * (o.y >= 0.f ? 1.f : -1.f);
+    }
+
+    return glm::normalize(n);
+}
+
+bool write_mesh_cache(std::filesystem::path const& path, LodMesh const& mesh, std::span<glm::vec3 const> normals, unsigned int num_levels, float reduction)
+{
+    size_t vertex_count = mesh.positions.size();
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version        = cache_version;
+    header.byte_order     = cache_byte_order;
+    header.vertex_count   = vertex_count;
+    header.level_count    = mesh.levels.size();
+    header.num_levels     = num_levels;
+    header.reduction      = reduction;
+    header.bounds         = mesh.bounds;
+    header.levels_offset  = align(sizeof(CacheHeader));
+    header.xs_offset      = align(header.levels_offset + mesh.levels.size() * sizeof(CacheLevel));
+    header.ys_offset      = align(header.xs_offset + vertex_count * sizeof(float));
+    header.zs_offset      = align(header.ys_offset + vertex_count * sizeof(float));
+    header.normals_offset = align(header.zs_offset + vertex_count * sizeof(float));
+
+    std::vector<CacheLevel> levels;
+    uint64_t                offset = header.normals_offset + vertex_count * sizeof(uint32_t);
+    for (LodLevel const& level : mesh.levels)
+    {
+        CacheLevel cache_level;
+        cache_level.first_vertex    = level.first_vertex;
+        cache_level.vertex_count    = level.vertex_count;
+        cache_level.triangle_count  = level.indices.size();
+        cache_level.indices_offset  = align(offset);
+        cache_level.meshlet_count   = level.meshlets.size();
+        cache_level.meshlets_offset = align(cache_level.indices_offset + level.indices.size() * sizeof(glm::u32vec3));
+        offset                      = cache_level.meshlets_offset + level.meshlets.size() * sizeof(Meshlet);
+        levels.push_back(cache_level);
+    }
+
+    // Split the positions into coordinate arrays and pack the normals
+    std::vector<float>    coordinates(vertex_count);
+    std::vector<uint32_t> packed_normals(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v)
+        packed_normals[v] = encode_normal(normals[v]);
+
+    // Write to a temporary file first, so an interrupted write never leaves a truncated cache behind
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            log_message(LogLevel::Warn, "write_mesh_cache: Failed to create '%s'", temporary_path.string().c_str());
+            return false;
+        }
+
+        write_at(file, 0, std::span<CacheHeader const>(&header, 1));
+        write_at(file, header.levels_offset, std::span<CacheLevel const>(levels));
+
+        uint64_t coordinate_offsets[3] = {header.xs_offset, header.ys_offset, header.zs_offset};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (size_t v = 0; v < vertex_count; ++v)
+                coordinates[v] = mesh.positions[v][axis];
+            write_at(file, coordinate_offsets[axis], std::span<float const>(coordinates));
+        }
+
+        write_at(file, header.normals_offset, std::span<uint32_t const>(packed_normals));
+        for (size_t level = 0; level < mesh.levels.size(); ++level)
+        {
+            write_at(file, levels[level].indices_offset, std::span<glm::u32vec3 const>(mesh.levels[level].indices));
+            write_at(file, levels[level].meshlets_offset, std::span<Meshlet const>(mesh.levels[level].meshlets));
+        }
+
+        if (!file)
+        {
+            log_message(LogLevel::Warn, "write_mesh_cache: Failed to write '%s'", temporary_path.string().c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+    {
+        log_message(LogLevel::Warn, "write_mesh_cache: Failed to replace '%s'", path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool CachedMesh::open(std::filesystem::path const& path, unsigned int num_levels, float reduction)
+{
+    m_view = LodMeshView{};
+    m_mesh = LodMesh{};
+    m_mesh_normals.clear();
+    m_level_states.reset();
+
+    if (!m_file.open(path))
+        return false;
+
+    auto fail = [&](char const* reason)
+    {
+        log_message(LogLevel::Warn, "CachedMesh::open: '%s' %s", path.string().c_str(), reason);
+        m_file.close();
+        m_view = LodMeshView{};
+        return false;
+    };
+
+    m_path = path;
+
+    std::span<std::byte const> data = m_file.data();
+
+    std::span<CacheHeader const> header;
+    if (!get_range(data, 0, 1, &header) || std::memcmp(header[0].magic, cache_magic, sizeof(cache_magic)) != 0)
+        return fail("is not a mesh cache");
+    if (header[0].version != cache_version || header[0].byte_order != cache_byte_order)
+        return fail("has an incompatible version or byte order");
+    if (header[0].num_levels != num_levels || header[0].reduction != reduction)
+        return fail("was written with other import settings");
+
+    uint64_t                    vertex_count = header[0].vertex_count;
+    std::span<CacheLevel const> levels;
+    if (!get_range(data, header[0].levels_offset, header[0].level_count, &levels) ||
+        !get_range(data, header[0].xs_offset, vertex_count, &m_view.xs) ||
+        !get_range(data, header[0].ys_offset, vertex_count, &m_view.ys) ||
+        !get_range(data, header[0].zs_offset, vertex_count, &m_view.zs) ||
+        !get_range(data, header[0].normals_offset, vertex_count, &m_normals))
+        return fail("is truncated");
+
+    m_view.bounds = header[0].bounds;
+    for (CacheLevel const& cache_level : levels)
+    {
+        LodLevelView level;
+        level.first_vertex = cache_level.first_vertex;
+        level.vertex_count = cache_level.vertex_count;
+        if (static_cast<uint64_t>(level.first_vertex) + level.vertex_count > vertex_count ||
+            !get_range(data, cache_level.indices_offset, cache_level.triangle_count, &level.indices) ||
+            !get_range(data, cache_level.meshlets_offset, cache_level.meshlet_count, &level.meshlets))
+            return fail("is truncated");
+
+        m_view.levels.push_back(level);
+    }
+
+    // Reading all indices here would page in the whole file, so each level is checked before it is first drawn
+    m_level_states = std::make_unique<std::atomic<LevelState>[]>(m_view.levels.size());
+    m_view.is_level_valid = [this](uint32_t level)
+    { return is_level_valid(level); };
+
+    return true;
+}
+
+bool CachedMesh::is_level_valid(uint32_t level) const
+{
+    if (!m_level_states)
+        return true; // In-memory mesh
+
+    LevelState state = m_level_states[level].load(std::memory_order_acquire);
+    if (state == LevelState::Unchecked)
+    {
+        // Threads drawing the level at the same time may check it twice, with the same result
+        LodLevelView const& view = m_view.levels[level];
+        state                    = are_indices_valid(view.indices, view.vertex_count) && are_meshlets_valid(view.meshlets, view.indices.size()) ? LevelState::Valid : LevelState::Invalid;
+        if (m_level_states[level].exchange(state, std::memory_order_acq_rel) == LevelState::Unchecked && state == LevelState::Invalid)
+            log_message(LogLevel::Warn, "CachedMesh: Level %u of '%s' is corrupt and is not drawn (delete the file to rebuild it)", level, m_path.string().c_str());
+    }
+
+    return state == LevelState::Valid;
+}
+
+void CachedMesh::assign(LodMesh&& mesh, std::span<glm::vec3 const> normals)
+{
+    m_file.close();
+    m_level_states.reset();
+
+    m_mesh = std::move(mesh);
+    m_mesh_normals.resize(normals.size());
+    std::transform(normals.begin(), normals.end(), m_mesh_normals.begin(), encode_normal);
+
+    m_view    = make_lod_mesh_view(m_mesh);
+    m_normals = m_mesh_normals;
+}
+
+LodMeshView const& CachedMesh::view() const
+{
+    return m_view;
+}
+
+std::span<uint32_t const> CachedMesh::normals() const
+{
+    return m_normals;
+}
+
+bool load_mesh_cached(std::filesystem::path const& path, CachedMesh* mesh, unsigned int num_levels, float reduction)
+{
+    std::filesystem::path cache_path = path;
+    cache_path += cache_extension;
+
+    // Use the cache unless the mesh file was modified after it was written
+    std::error_code                 error;
+    std::filesystem::file_time_type mesh_time  = std::filesystem::last_write_time(path, error);
+    std::filesystem::file_time_type cache_time = std::filesystem::last_write_time(cache_path, error);
+    if (!error && cache_time >= mesh_time && mesh->open(cache_path, num_levels, reduction))
+        return true;
+
+    std::vector<glm::vec3>    positions;
+    std::vector<glm::u32vec3> indices;
+
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".obj")
+    {
+        if (!load_obj(path, &positions, &indices))
+            return false;
+    }
+    else
+    {
+        log_message(LogLevel::Error, "load_mesh_cached: Unsupported mesh format '%s'", extension.c_str());
+        return false;
+    }
+
+    LodMesh lod_mesh;
+    create_simplified_lod_mesh(positions, indices, num_levels, reduction, &lod_mesh);
+    build_lod_meshlets(&lod_mesh);
+
+    // The finest level uses all vertices
+    std::vector<glm::vec3> normals;
+    compute_vertex_normals(lod_mesh.positions, lod_mesh.levels.empty() ? std::span<glm::u32vec3 const>() : lod_mesh.levels[0].indices, &normals);
+
+    if (write_mesh_cache(cache_path, lod_mesh, normals, num_levels, reduction) && mesh->open(cache_path, num_levels, reduction))
+        return true;
+
+    // Without a cache, the mesh is used from memory
+    mesh->assign(std::move(lod_mesh), normals);
+    return true;
+}
+
+} // namespace cgtub
@@ -0,0 +1,172 @@
+#include "cgtub/meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+namespace cgtub
+{
+
+namespace
+{
+
+void compute_meshlet_bounds(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> triangles, Meshlet* meshlet)
+{
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(3 * triangles.size());
+
+    glm::vec3 normal_sum(0.f);
+    for (glm::u32vec3 const& tri : triangles)
+    {
+        glm::vec3 normal = glm::cross(positions[tri.y] - positions[tri.x], positions[tri.z] - positions[tri.x]);
+        float     length = glm::length(normal);
+        if (length > 0.f)
+            normal_sum += normal / length;
+
+        for (int k = 0; k < 3; ++k)
+            vertices.push_back(positions[tri[k]]);
+    }
+    meshlet->bounds = compute_bounding_sphere(vertices);
+
+    // The cone around the average normal that contains all normals
+    meshlet->cone_axis  = glm::vec3(0.f, 0.f, 1.f);
+    meshlet->cone_angle = std::numbers::pi_v<float>;
+    if (glm::length(normal_sum) == 0.f)
+        return;
+
+    meshlet->cone_axis = glm::normalize(normal_sum);
+    float min_dot      = 1.f;
+    for (glm::u32vec3 const& tri : triangles)
+    {
+        glm::vec3 normal = glm::cross(positions[tri.y] - positions[tri.x], positions[tri.z] - positions[tri.x]);
+        float     length = glm::length(normal);
+        if (length > 0.f)
+            min_dot = std::min(min_dot, glm::dot(normal / length, meshlet->cone_axis));
+    }
+    meshlet->cone_angle = std::acos(std::clamp(min_dot, -1.f, 1.f));
+}
+
+} // namespace
+
+void build_meshlets(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::vector<Meshlet>* meshlets, std::vector<glm::u32vec3>* reordered)
+{
+    meshlets->clear();
+    reordered->clear();
+    reordered->reserve(indices.size());
+
+    // Vertex-to-triangle adjacency in compressed row storage
+    std::vector<uint32_t> offsets(positions.size() + 1, 0);
+    for (glm::u32vec3 const& tri : indices)
+        for (int k = 0; k < 3; ++k)
+            ++offsets[tri[k] + 1];
+    for (size_t v = 0; v < positions.size(); ++v)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<uint32_t> adjacency(offsets.back());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t t = 0; t < indices.size(); ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t][k]]++] = t;
+
+    constexpr uint32_t invalid = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint8_t>  emitted(indices.size(), 0);
+    std::vector<uint32_t> vertex_meshlet(positions.size(), invalid); // Last meshlet that used the vertex
+    std::vector<uint32_t> candidates;
+
+    uint32_t seed = 0;
+    while (true)
+    {
+        while (seed < indices.size() && emitted[seed])
+            ++seed;
+        if (seed == indices.size())
+            break;
+
+        uint32_t meshlet_index = static_cast<uint32_t>(meshlets->size());
+        Meshlet  meshlet{};
+        meshlet.first_triangle = static_cast<uint32_t>(reordered->size());
+
+        auto new_vertices = [&](uint32_t t)
+        {
+            uint32_t count = 0;
+            for (int k = 0; k < 3; ++k)
+                count += vertex_meshlet[indices[t][k]] != meshlet_index;
+            return count;
+        };
+
+        auto add_triangle = [&](uint32_t t)
+        {
+            emitted[t] = 1;
+            reordered->push_back(indices[t]);
+            ++meshlet.triangle_count;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[t][k];
+                if (vertex_meshlet[v] == meshlet_index)
+                    continue;
+
+                vertex_meshlet[v] = meshlet_index;
+                ++meshlet.vertex_count;
+                for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i)
+                    if (!emitted[adjacency[i]])
+                        candidates.push_back(adjacency[i]);
+            }
+        };
+
+        candidates.clear();
+        add_triangle(seed);
+
+        // Grow the meshlet with the adjacent triangle that adds the fewest vertices
+        while (meshlet.triangle_count < max_meshlet_triangles)
+        {
+            std::erase_if(candidates, [&](uint32_t t)
+                          { return emitted[t] != 0; });
+
+            uint32_t best       = invalid;
+            uint32_t best_count = 4;
+            for (uint32_t t : candidates)
+            {
+                uint32_t count = new_vertices(t);
+                if (count < best_count && meshlet.vertex_count + count <= max_meshlet_vertices)
+                {
+                    best       = t;
+                    best_count = count;
+                }
+            }
+
+            if (best == invalid)
+                break;
+
+            add_triangle(best);
+        }
+
+        compute_meshlet_bounds(positions, std::span<glm::u32vec3 const>(reordered->data() + meshlet.first_triangle, meshlet.triangle_count), &meshlet);
+        meshlets->push_back(meshlet);
+    }
+}
+
+bool is_meshlet_visible(Meshlet const& meshlet, Frustum const& frustum, glm::vec3 const& camera_position, FaceCulling face_culling)
+{
+    if (!is_sphere_visible(frustum, meshlet.bounds))
+        return false;
+
+    if (face_culling == FaceCulling::None || meshlet.cone_angle >= 0.5f * std::numbers::pi_v<float>)
+        return true;
+
+    // All triangles face away from (or towards) the camera if every normal in the cone
+    // and every point in the bounding sphere keep the camera behind (or in front of) the triangle planes.
+    // With `v` the vector between the camera and the sphere center, this holds if the angle between
+    // `v` and the cone axis plus the cone angle is at most acos(radius / |v|).
+    glm::vec3 v        = face_culling == FaceCulling::BackFaces ? meshlet.bounds.center - camera_position : camera_position - meshlet.bounds.center;
+    float     distance = glm::length(v);
+    if (distance <= meshlet.bounds.radius)
+        return true;
+
+    float angle = std::acos(std::clamp(glm::dot(v, meshlet.cone_axis) / distance, -1.f, 1.f));
+
+    return angle + meshlet.cone_angle > std::acos(meshlet.bounds.radius / distance);
+}
+
+} // namespace cgtub
@@ -0,0 +1,238 @@
+#include "cgtub/obj_loader.hpp"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <string>
+
+#include <tiny_obj_loader.h>
+
+#include "cgtub/log.hpp"
+#include "cgtub/threading.hpp"
+#include "cgtub/vertex_cache.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Files are split into chunks of about this size (in bytes) that are parsed independently
+constexpr size_t obj_chunk_size = size_t(1) << 24;
+
+// Read-only stream buffer over a memory range, since tinyobj parses from a std::istream
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+    MemoryStreamBuffer(char* begin, char* end)
+    {
+        setg(begin, begin, end);
+    }
+};
+
+// The geometry of a chunk with its indices not yet resolved to the whole file
+struct ObjChunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<int64_t>   corners;          // Position index of each triangle corner (0-based)
+    std::vector<size_t>    relative_corners; // Corners whose index is relative to the first position of the chunk (negative OBJ indices)
+    bool                   valid = true;
+};
+
+void parse_chunk(char* begin, char* end, ObjChunk* chunk)
+{
+    tinyobj::callback_t callbacks;
+    callbacks.vertex_cb = [](void* user_data, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t)
+    {
+        static_cast<ObjChunk*>(user_data)->positions.emplace_back(x, y, z);
+    };
+    callbacks.index_cb = [](void* user_data, tinyobj::index_t* face, int num_indices)
+    {
+        ObjChunk* chunk = static_cast<ObjChunk*>(user_data);
+
+        auto add_corner = [&](int raw_index)
+        {
+            if (raw_index > 0)
+                chunk->corners.push_back(raw_index - 1);
+            else if (raw_index < 0)
+            {
+                chunk->relative_corners.push_back(chunk->corners.size());
+                chunk->corners.push_back(static_cast<int64_t>(chunk->positions.size()) + raw_index);
+            }
+            else
+                chunk->valid = false; // 0 is not a valid OBJ index
+        };
+
+        // Triangulate polygons as fans around their first corner
+        for (int i = 1; i + 1 < num_indices; ++i)
+        {
+            add_corner(face[0].vertex_index);
+            add_corner(face[i].vertex_index);
+            add_corner(face[i + 1].vertex_index);
+        }
+    };
+
+    MemoryStreamBuffer buffer(begin, end);
+    std::istream       stream(&buffer);
+    std::string        warning;
+    std::string        error;
+    if (!tinyobj::LoadObjWithCallback(stream, callbacks, chunk, nullptr, &warning, &error))
+        chunk->valid = false;
+}
+
+} // namespace
+
+bool load_obj(std::filesystem::path const& path, std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices)
+{
+    positions->clear();
+    indices->clear();
+
+    std::error_code error;
+    size_t          file_size = std::filesystem::file_size(path, error);
+    std::ifstream   file(path, std::ios::binary);
+    if (error || !file)
+    {
+        log_message(LogLevel::Error, "load_obj: Failed to open '%s'", path.string().c_str());
+        return false;
+    }
+
+    std::vector<char> data(file_size);
+    if (!file.read(data.data(), data.size()))
+    {
+        log_message(LogLevel::Error, "load_obj: Failed to read '%s'", path.string().c_str());
+        return false;
+    }
+
+    // Split the file into chunks that end at line breaks
+    std::vector<size_t> chunk_begins;
+    for (size_t begin = 0; begin < data.size();)
+    {
+        chunk_begins.push_back(begin);
+
+        size_t split = begin + obj_chunk_size;
+        if (split >= data.size())
+            break;
+
+        void const* line_end = std::memchr(data.data() + split, '\n', data.size() - split);
+        begin                = line_end ? static_cast<char const*>(line_end) - data.data() + 1 : data.size();
+    }
+    chunk_begins.push_back(data.size());
+
+    size_t                num_chunks = chunk_begins.size() - 1;
+    std::vector<ObjChunk> chunks(num_chunks);
+    parallel_for(num_chunks, 1, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+            parse_chunk(data.data() + chunk_begins[c], data.data() + chunk_begins[c + 1], &chunks[c]);
+    });
+
+    // Offsets of the chunks in the combined position and index buffers
+    std::vector<size_t> position_offsets(num_chunks + 1, 0);
+    std::vector<size_t> corner_offsets(num_chunks + 1, 0);
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        position_offsets[c + 1] = position_offsets[c] + chunks[c].positions.size();
+        corner_offsets[c + 1]   = corner_offsets[c] + chunks[c].corners.size();
+    }
+
+    std::vector<glm::vec3>    loaded_positions(position_offsets.back());
+    std::vector<glm::u32vec3> loaded_indices(corner_offsets.back() / 3);
+    int64_t                   num_positions = static_cast<int64_t>(loaded_positions.size());
+
+    parallel_for(num_chunks, 1, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            ObjChunk& chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), loaded_positions.begin() + position_offsets[c]);
+
+            for (size_t corner : chunk.relative_corners)
+                chunk.corners[corner] += position_offsets[c];
+
+            for (size_t corner = 0; corner < chunk.corners.size(); ++corner)
+            {
+                int64_t index = chunk.corners[corner];
+                if (index < 0 || index >= num_positions)
+                {
+                    chunk.valid = false;
+                    break;
+                }
+
+                size_t global_corner = corner_offsets[c] + corner;
+                loaded_indices[global_corner / 3][global_corner % 3] = static_cast<uint32_t>(index);
+            }
+
+            // Free the chunk memory early, large files have plenty of it
+            chunk.positions = {};
+            chunk.corners   = {};
+        }
+    });
+
+    for (ObjChunk const& chunk : chunks)
+    {
+        if (!chunk.valid)
+        {
+            log_message(LogLevel::Error, "load_obj: '%s' contains invalid faces", path.string().c_str());
+            return false;
+        }
+    }
+
+    size_t unwelded_vertex_count = loaded_positions.size();
+    weld_vertices(&loaded_positions, &loaded_indices);
+    optimize_mesh(&loaded_positions, &loaded_indices);
+
+    log_message(LogLevel::Debug, "load_obj: '%s' has %zu vertices (%zu before welding) and %zu triangles",
+                path.string().c_str(), loaded_positions.size(), unwelded_vertex_count, loaded_indices.size());
+
+    positions->swap(loaded_positions);
+    indices->swap(loaded_indices);
+
+    return true;
+}
+
+void weld_vertices(std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices)
+{
+    // Hash table with linear probing from position bits to welded vertex indices
+    size_t                capacity = std::bit_ceil(2 * positions->size() + 1);
+    std::vector<uint32_t> table(capacity, unused_vertex);
+
+    auto hash = [&](glm::vec3 const& p)
+    {
+        uint64_t h = std::bit_cast<uint32_t>(p.x) * 73856093ull ^ std::bit_cast<uint32_t>(p.y) * 19349663ull ^ std::bit_cast<uint32_t>(p.z) * 83492791ull;
+        return static_cast<size_t>((h * 0x9E3779B97F4A7C15ull) >> 16) & (capacity - 1);
+    };
+
+    std::vector<uint32_t>  remap(positions->size());
+    std::vector<glm::vec3> welded;
+    welded.reserve(positions->size());
+    for (size_t v = 0; v < positions->size(); ++v)
+    {
+        // Adding 0 turns -0 into +0, so both hash the same
+        glm::vec3 p = (*positions)[v] + glm::vec3(0.f);
+
+        size_t slot = hash(p);
+        while (table[slot] != unused_vertex && welded[table[slot]] != p)
+            slot = (slot + 1) & (capacity - 1);
+
+        if (table[slot] == unused_vertex)
+        {
+            table[slot] = static_cast<uint32_t>(welded.size());
+            welded.push_back(p);
+        }
+        remap[v] = table[slot];
+    }
+
+    size_t num_triangles = 0;
+    for (glm::u32vec3 const& tri : *indices)
+    {
+        glm::u32vec3 welded_tri(remap[tri.x], remap[tri.y], remap[tri.z]);
+        if (welded_tri.x != welded_tri.y && welded_tri.y != welded_tri.z && welded_tri.z != welded_tri.x)
+            (*indices)[num_triangles++] = welded_tri;
+    }
+    indices->resize(num_triangles);
+
+    positions->swap(welded);
+}
+
+} // namespace cgtub
@@ -0,0 +1,648 @@
+#include "cgtub/paged_mesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+#include "cgtub/lod.hpp"
+#include "cgtub/log.hpp"
+#include "cgtub/ply_loader.hpp"
+#include "cgtub/threading.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+constexpr char     paged_magic[8]     = {'C', 'G', 'P', 'A', 'G', 'E', 'S', '\0'};
+constexpr uint32_t paged_version      = 1;
+constexpr uint32_t paged_byte_order   = 0x01020304;
+constexpr uint64_t page_alignment     = 1 << 16; // Covers the page sizes and mapping granularities of all platforms
+
+struct PagedHeader
+{
+    char           magic[8];
+    uint32_t       version;
+    uint32_t       byte_order;
+    uint64_t       page_count;
+    uint64_t       table_offset;
+    BoundingSphere bounds;
+};
+
+static_assert(std::is_trivially_copyable_v<PagedHeader> && std::is_trivially_copyable_v<PagedMeshPage>);
+
+uint64_t align(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Interleaves the lower 10 bits of x with two zero bits each
+uint32_t spread_bits(uint32_t x)
+{
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8)) & 0x0300F00F;
+    x = (x | (x << 4)) & 0x030C30C3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// The triangles are distributed into buckets by the upper bits of their Morton codes (cells of a 64^3 grid),
+// so that each bucket can be sorted in memory on its own
+constexpr int    bucket_cell_shift  = 12;
+constexpr size_t bucket_cell_count  = size_t(1) << (30 - bucket_cell_shift);
+constexpr size_t max_bucket_count   = 256;  // Bounds the memory of the bucket buffers for huge meshes
+constexpr size_t bucket_buffer_size = 2048; // Triangles buffered per bucket before they are written
+
+// A triangle with its sort key: the Morton code of its centroid (upper half) and its index in the file (lower half)
+struct KeyedTriangle
+{
+    uint64_t     key;
+    glm::u32vec3 indices;
+};
+
+// Converts a PLY file with only one bucket of triangles in memory: the vertices are copied into a temporary file
+// (and mapped) while the triangle keys are counted per cell, the triangles are then distributed into buckets of
+// consecutive cells in a second temporary file, and each bucket is finally sorted and split into pages
+class PagedMeshConverter
+{
+public:
+    PagedMeshConverter(std::filesystem::path const& ply_path, std::filesystem::path const& path, uint32_t triangles_per_page, size_t bucket_triangles);
+    ~PagedMeshConverter();
+
+    PagedMeshConverter(PagedMeshConverter const&)            = delete;
+    PagedMeshConverter& operator=(PagedMeshConverter const&) = delete;
+
+    bool convert();
+
+private:
+    bool read_vertices();
+    bool map_vertices(std::ofstream* vertex_file);
+    bool distribute_triangles();
+    bool write_pages();
+
+    // Computes the keys of a batch of triangles into m_keys
+    void compute_keys(std::span<glm::u32vec3 const> triangles, uint64_t first_triangle);
+
+    std::filesystem::path m_ply_path;
+    std::filesystem::path m_path;
+    std::filesystem::path m_vertices_path;
+    std::filesystem::path m_triangles_path;
+    uint32_t              m_triangles_per_page;
+    size_t                m_bucket_triangles;
+
+    MappedFile             m_vertices;
+    uint64_t               m_vertex_count{0u};
+    std::span<float const> m_xs;
+    std::span<float const> m_ys;
+    std::span<float const> m_zs;
+
+    BoundingSphere m_bounds{};
+    glm::vec3      m_origin{0.f};
+    float          m_scale{0.f};
+
+    uint64_t              m_triangle_count{0u};
+    std::vector<uint64_t> m_cell_counts;
+    std::vector<uint32_t> m_cell_buckets;
+    std::vector<uint64_t> m_bucket_offsets; // First triangle of each bucket in the triangle file, followed by the total
+    std::vector<uint64_t> m_keys;
+};
+
+PagedMeshConverter::PagedMeshConverter(std::filesystem::path const& ply_path, std::filesystem::path const& path, uint32_t triangles_per_page,
+                                       size_t bucket_triangles)
+    : m_ply_path(ply_path), m_path(path), m_triangles_per_page(std::max(triangles_per_page, 1u)), m_bucket_triangles(std::max<size_t>(bucket_triangles, 1))
+{
+    m_vertices_path = path;
+    m_vertices_path += ".vertices.tmp";
+    m_triangles_path = path;
+    m_triangles_path += ".triangles.tmp";
+}
+
+PagedMeshConverter::~PagedMeshConverter()
+{
+    m_vertices.close();
+
+    std::error_code error;
+    std::filesystem::remove(m_vertices_path, error);
+    std::filesystem::remove(m_triangles_path, error);
+}
+
+bool PagedMeshConverter::convert()
+{
+    return read_vertices() && distribute_triangles() && write_pages();
+}
+
+bool PagedMeshConverter::read_vertices()
+{
+    std::ofstream vertex_file(m_vertices_path, std::ios::binary | std::ios::trunc);
+    if (!vertex_file)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to create '%s'", m_vertices_path.string().c_str());
+        return false;
+    }
+
+    auto store_vertices = [&](uint64_t vertex_count, uint64_t first_vertex, std::span<float const> xs, std::span<float const> ys, std::span<float const> zs)
+    {
+        // The coordinates are stored as separate arrays, like in memory
+        std::span<float const> coordinates[3] = {xs, ys, zs};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            vertex_file.seekp(static_cast<std::streamoff>((axis * vertex_count + first_vertex) * sizeof(float)));
+            vertex_file.write(reinterpret_cast<char const*>(coordinates[axis].data()), static_cast<std::streamsize>(coordinates[axis].size_bytes()));
+        }
+        m_vertex_count = vertex_count;
+    };
+
+    // All vertices have been stored when the first triangles arrive
+    bool is_mapped    = false;
+    bool has_failed   = false;
+    bool is_too_large = false;
+    m_cell_counts.assign(bucket_cell_count, 0);
+    auto count_triangles = [&](uint64_t, std::span<glm::u32vec3 const> triangles)
+    {
+        if (!is_mapped && !has_failed)
+        {
+            is_mapped  = map_vertices(&vertex_file);
+            has_failed = !is_mapped;
+        }
+
+        // The lower half of the keys holds the triangle index
+        is_too_large |= m_triangle_count + triangles.size() > std::numeric_limits<uint32_t>::max();
+        if (has_failed || is_too_large)
+            return;
+
+        compute_keys(triangles, m_triangle_count);
+        for (uint64_t key : m_keys)
+            ++m_cell_counts[key >> (32 + bucket_cell_shift)];
+        m_triangle_count += triangles.size();
+    };
+
+    bool is_read = stream_ply(m_ply_path, store_vertices, count_triangles);
+    if (is_too_large)
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Meshes with more than 2^32 triangles are not supported");
+    if (!is_read || has_failed || is_too_large)
+        return false;
+
+    // The bounds cover all vertices, also of meshes without triangles
+    return is_mapped || map_vertices(&vertex_file);
+}
+
+bool PagedMeshConverter::map_vertices(std::ofstream* vertex_file)
+{
+    vertex_file->close();
+    if (!*vertex_file)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to write '%s'", m_vertices_path.string().c_str());
+        return false;
+    }
+
+    if (m_vertex_count > 0)
+    {
+        if (!m_vertices.open(m_vertices_path) || m_vertices.data().size() < 3 * m_vertex_count * sizeof(float))
+            return false;
+
+        float const* coordinates = reinterpret_cast<float const*>(m_vertices.data().data());
+        m_xs                     = std::span<float const>(coordinates, m_vertex_count);
+        m_ys                     = std::span<float const>(coordinates + m_vertex_count, m_vertex_count);
+        m_zs                     = std::span<float const>(coordinates + 2 * m_vertex_count, m_vertex_count);
+    }
+
+    m_bounds = compute_bounding_sphere(m_xs, m_ys, m_zs);
+    m_origin = m_bounds.center - glm::vec3(m_bounds.radius);
+    m_scale  = 1023.f / std::max(2.f * m_bounds.radius, 1e-20f);
+
+    return true;
+}
+
+bool PagedMeshConverter::distribute_triangles()
+{
+    // Consecutive cells are merged into buckets of about m_bucket_triangles triangles (a single cell may hold more)
+    uint64_t bucket_triangles = std::max<uint64_t>(m_bucket_triangles, (m_triangle_count + max_bucket_count - 1) / max_bucket_count);
+    uint64_t offset           = 0;
+    m_cell_buckets.resize(bucket_cell_count);
+    m_bucket_offsets = {0};
+    for (size_t cell = 0; cell < bucket_cell_count; ++cell)
+    {
+        uint64_t bucket_size = offset - m_bucket_offsets.back();
+        if (bucket_size > 0 && bucket_size + m_cell_counts[cell] > bucket_triangles)
+            m_bucket_offsets.push_back(offset);
+        m_cell_buckets[cell] = static_cast<uint32_t>(m_bucket_offsets.size() - 1);
+        offset += m_cell_counts[cell];
+    }
+    m_bucket_offsets.push_back(offset);
+
+    size_t        bucket_count = m_bucket_offsets.size() - 1;
+    std::ofstream triangle_file(m_triangles_path, std::ios::binary | std::ios::trunc);
+    if (!triangle_file)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to create '%s'", m_triangles_path.string().c_str());
+        return false;
+    }
+
+    std::vector<uint64_t>                   write_positions(m_bucket_offsets.begin(), m_bucket_offsets.end() - 1);
+    std::vector<std::vector<KeyedTriangle>> buffers(bucket_count);
+    auto                                    flush = [&](size_t bucket)
+    {
+        std::vector<KeyedTriangle>& buffer = buffers[bucket];
+        triangle_file.seekp(static_cast<std::streamoff>(write_positions[bucket] * sizeof(KeyedTriangle)));
+        triangle_file.write(reinterpret_cast<char const*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(KeyedTriangle)));
+        write_positions[bucket] += buffer.size();
+        buffer.clear();
+    };
+
+    // The vertices are read again but not needed
+    uint64_t vertex_count   = 0;
+    uint64_t triangle_count = 0;
+    auto     count_vertices = [&](uint64_t count, uint64_t, std::span<float const>, std::span<float const>, std::span<float const>)
+    { vertex_count = count; };
+    auto distribute = [&](uint64_t, std::span<glm::u32vec3 const> triangles)
+    {
+        // Triangles beyond the counted ones (of a file that changed in the meantime) would not fit into the buckets
+        if (triangle_count + triangles.size() > m_triangle_count)
+        {
+            triangle_count += triangles.size();
+            return;
+        }
+
+        compute_keys(triangles, triangle_count);
+        for (size_t t = 0; t < triangles.size(); ++t)
+        {
+            size_t bucket = m_cell_buckets[m_keys[t] >> (32 + bucket_cell_shift)];
+            buffers[bucket].push_back({m_keys[t], triangles[t]});
+            if (buffers[bucket].size() == bucket_buffer_size)
+                flush(bucket);
+        }
+        triangle_count += triangles.size();
+    };
+
+    if (!stream_ply(m_ply_path, count_vertices, distribute))
+        return false;
+    if (vertex_count != m_vertex_count || triangle_count != m_triangle_count)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: '%s' changed during the conversion", m_ply_path.string().c_str());
+        return false;
+    }
+
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+        flush(bucket);
+
+    triangle_file.close();
+    if (!triangle_file)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to write '%s'", m_triangles_path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool PagedMeshConverter::write_pages()
+{
+    size_t                     page_count = (m_triangle_count + m_triangles_per_page - 1) / m_triangles_per_page;
+    std::vector<PagedMeshPage> pages;
+    pages.reserve(page_count);
+
+    PagedHeader header{};
+    std::memcpy(header.magic, paged_magic, sizeof(paged_magic));
+    header.version      = paged_version;
+    header.byte_order   = paged_byte_order;
+    header.page_count   = page_count;
+    header.table_offset = align(sizeof(PagedHeader), alignof(PagedMeshPage));
+    header.bounds       = m_bounds;
+
+    std::filesystem::path temporary_path = m_path;
+    temporary_path += ".tmp";
+
+    {
+        std::ifstream triangle_file(m_triangles_path, std::ios::binary);
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!triangle_file || !file)
+        {
+            log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to create '%s'", temporary_path.string().c_str());
+            return false;
+        }
+
+        // Local vertex index of the mesh vertices within the current page (in the order of their first use)
+        std::unordered_map<uint32_t, uint32_t> local_index;
+        std::vector<glm::vec3>                 page_positions;
+        std::vector<glm::u32vec3>              page_indices;
+        local_index.reserve(3 * static_cast<size_t>(m_triangles_per_page));
+
+        uint64_t offset     = align(header.table_offset + page_count * sizeof(PagedMeshPage), page_alignment);
+        auto     write_page = [&]()
+        {
+            PagedMeshPage& page = pages.emplace_back();
+            page.bounds         = compute_bounding_sphere(page_positions);
+            page.vertex_count   = static_cast<uint32_t>(page_positions.size());
+            page.triangle_count = static_cast<uint32_t>(page_indices.size());
+            page.offset         = offset;
+
+            // Pages start at aligned offsets, so they can be released independently
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<char const*>(page_positions.data()), static_cast<std::streamsize>(page_positions.size() * sizeof(glm::vec3)));
+            file.write(reinterpret_cast<char const*>(page_indices.data()), static_cast<std::streamsize>(page_indices.size() * sizeof(glm::u32vec3)));
+            offset = align(offset + page_positions.size() * sizeof(glm::vec3) + page_indices.size() * sizeof(glm::u32vec3), page_alignment);
+
+            local_index.clear();
+            page_positions.clear();
+            page_indices.clear();
+        };
+
+        // The buckets follow each other in the triangle file, and pages continue across them
+        std::vector<KeyedTriangle> bucket;
+        for (size_t b = 0; b + 1 < m_bucket_offsets.size(); ++b)
+        {
+            bucket.resize(m_bucket_offsets[b + 1] - m_bucket_offsets[b]);
+            triangle_file.read(reinterpret_cast<char*>(bucket.data()), static_cast<std::streamsize>(bucket.size() * sizeof(KeyedTriangle)));
+            if (!triangle_file)
+            {
+                log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to read '%s'", m_triangles_path.string().c_str());
+                return false;
+            }
+
+            std::sort(bucket.begin(), bucket.end(), [](KeyedTriangle const& a, KeyedTriangle const& b) { return a.key < b.key; });
+            for (KeyedTriangle const& triangle : bucket)
+            {
+                glm::u32vec3 local_tri;
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    uint32_t vertex         = triangle.indices[corner];
+                    auto [entry, is_new]    = local_index.try_emplace(vertex, static_cast<uint32_t>(page_positions.size()));
+                    if (is_new)
+                        page_positions.emplace_back(m_xs[vertex], m_ys[vertex], m_zs[vertex]);
+                    local_tri[corner] = entry->second;
+                }
+                page_indices.push_back(local_tri);
+
+                if (page_indices.size() == m_triangles_per_page)
+                    write_page();
+            }
+        }
+        if (!page_indices.empty())
+            write_page();
+
+        file.seekp(0);
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.seekp(static_cast<std::streamoff>(header.table_offset));
+        file.write(reinterpret_cast<char const*>(pages.data()), static_cast<std::streamsize>(pages.size() * sizeof(PagedMeshPage)));
+
+        if (!file)
+        {
+            log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to write '%s'", temporary_path.string().c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, m_path, error);
+    if (error)
+    {
+        log_message(LogLevel::Error, "convert_ply_to_paged_mesh: Failed to replace '%s'", m_path.string().c_str());
+        return false;
+    }
+
+    log_message(LogLevel::Debug, "convert_ply_to_paged_mesh: Wrote %zu triangles in %zu pages (sorted in %zu buckets) to '%s'",
+                static_cast<size_t>(m_triangle_count), page_count, m_bucket_offsets.size() - 1, m_path.string().c_str());
+
+    return true;
+}
+
+void PagedMeshConverter::compute_keys(std::span<glm::u32vec3 const> triangles, uint64_t first_triangle)
+{
+    // Sort keys along a Morton curve through the centroids (on a 1024^3 grid over the bounds)
+    m_keys.resize(triangles.size());
+    parallel_for(triangles.size(), 4096, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t t = begin; t < end; ++t)
+        {
+            glm::u32vec3 const& tri = triangles[t];
+            glm::vec3           centroid((m_xs[tri.x] + m_xs[tri.y] + m_xs[tri.z]) / 3.f, (m_ys[tri.x] + m_ys[tri.y] + m_ys[tri.z]) / 3.f,
+                                         (m_zs[tri.x] + m_zs[tri.y] + m_zs[tri.z]) / 3.f);
+            glm::u32vec3        cell = glm::u32vec3(glm::clamp((centroid - m_origin) * m_scale, 0.f, 1023.f));
+            uint64_t            code = spread_bits(cell.x) | (spread_bits(cell.y) << 1) | (spread_bits(cell.z) << 2);
+            m_keys[t]                = (code << 32) | (first_triangle + t);
+        }
+    });
+}
+
+} // namespace
+
+bool convert_ply_to_paged_mesh(std::filesystem::path const& ply_path, std::filesystem::path const& path, uint32_t triangles_per_page, size_t bucket_triangles)
+{
+    PagedMeshConverter converter(ply_path, path, triangles_per_page, bucket_triangles);
+    return converter.convert();
+}
+
+bool PagedMesh::open(std::filesystem::path const& path)
+{
+    m_pages = {};
+    m_lru.clear();
+    m_stats = PagedMeshStats{};
+
+    if (!m_file.open(path))
+        return false;
+
+    auto fail = [&](char const* reason)
+    {
+        log_message(LogLevel::Error, "PagedMesh::open: '%s' %s", path.string().c_str(), reason);
+        m_file.close();
+        return false;
+    };
+
+    std::span<std::byte const> data = m_file.data();
+    if (data.size() < sizeof(PagedHeader))
+        return fail("is not a paged mesh");
+
+    PagedHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, paged_magic, sizeof(paged_magic)) != 0)
+        return fail("is not a paged mesh");
+    if (header.version != paged_version || header.byte_order != paged_byte_order)
+        return fail("has an incompatible version or byte order");
+    if (header.table_offset % alignof(PagedMeshPage) != 0 || header.table_offset > data.size() ||
+        header.page_count > (data.size() - header.table_offset) / sizeof(PagedMeshPage))
+        return fail("is truncated");
+
+    std::span<PagedMeshPage const> pages(reinterpret_cast<PagedMeshPage const*>(data.data() + header.table_offset), header.page_count);
+    for (PagedMeshPage const& page : pages)
+    {
+        uint64_t size = uint64_t(page.vertex_count) * sizeof(glm::vec3) + uint64_t(page.triangle_count) * sizeof(glm::u32vec3);
+        if (page.offset % alignof(glm::vec3) != 0 || page.offset > data.size() || size > data.size() - page.offset)
+            return fail("is truncated");
+    }
+
+    m_pages  = pages;
+    m_path   = path;
+    m_bounds = header.bounds;
+
+    // Index of the first triangle of each page within the whole mesh
+    m_first_triangles.resize(m_pages.size());
+    uint64_t first_triangle = 0;
+    for (size_t page = 0; page < m_pages.size(); ++page)
+    {
+        m_first_triangles[page] = first_triangle;
+        first_triangle += m_pages[page].triangle_count;
+    }
+
+    // The pages are culled through a hierarchy over their bounds
+    std::vector<Aabb> page_bounds;
+    page_bounds.reserve(m_pages.size());
+    for (PagedMeshPage const& page : m_pages)
+        page_bounds.push_back(compute_aabb(page.bounds));
+    m_page_bvh.build(page_bounds);
+
+    m_lru_positions.assign(m_pages.size(), m_lru.end());
+    m_last_used.assign(m_pages.size(), 0);
+    m_is_resident.assign(m_pages.size(), false);
+    m_page_states.assign(m_pages.size(), PageState::Unchecked);
+
+    return true;
+}
+
+BoundingSphere const& PagedMesh::bounds() const
+{
+    return m_bounds;
+}
+
+void PagedMesh::set_residency_budget(size_t bytes)
+{
+    m_residency_budget = bytes;
+    evict(m_residency_budget);
+}
+
+void PagedMesh::set_load_budget(size_t bytes)
+{
+    m_load_budget = bytes;
+}
+
+void PagedMesh::select_pages(glm::mat4 const& model_matrix, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix,
+                             int viewport_height, float min_projected_area, std::vector<uint32_t>* pages)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ++m_frame;
+    m_stats.loaded_pages  = 0;
+    m_stats.pending_pages = 0;
+    pages->clear();
+
+    // The page bounds are in object space, so is the frustum
+    std::vector<uint32_t> visible_pages;
+    m_page_bvh.cull(extract_frustum(projection_matrix * view_matrix * model_matrix), &visible_pages);
+
+    // Resident pages are drawn right away, the others are collected by their size on screen
+    std::vector<std::pair<float, uint32_t>> missing_pages;
+    for (uint32_t page : visible_pages)
+    {
+        BoundingSphere bounds = transform_bounding_sphere(model_matrix, m_pages[page].bounds);
+        float          area   = compute_projected_area(bounds, view_matrix, projection_matrix, viewport_height);
+        if (area < min_projected_area || m_page_states[page] == PageState::Corrupt)
+            continue;
+
+        if (!m_is_resident[page])
+        {
+            missing_pages.emplace_back(area, page);
+            continue;
+        }
+
+        m_lru.splice(m_lru.begin(), m_lru, m_lru_positions[page]);
+        m_last_used[page] = m_frame;
+        pages->push_back(page);
+    }
+
+    // Load the largest pages on screen first, up to the load budget (but at least one, so loading never stalls)
+    std::sort(missing_pages.begin(), missing_pages.end(), std::greater<>());
+    size_t loaded_bytes = 0;
+    for (auto const& [area, page] : missing_pages)
+    {
+        size_t size = page_size(page);
+        if (loaded_bytes > 0 && loaded_bytes + size > m_load_budget)
+        {
+            m_file.prefetch(m_pages[page].offset, size);
+            ++m_stats.pending_pages;
+            continue;
+        }
+
+        // A page is checked when it is first loaded (its data is read for drawing right after anyway)
+        if (m_page_states[page] == PageState::Unchecked && !check_page(page))
+            continue;
+
+        m_file.prefetch(m_pages[page].offset, size);
+        m_lru.push_front(page);
+        m_lru_positions[page] = m_lru.begin();
+        m_last_used[page]     = m_frame;
+        m_is_resident[page]   = true;
+
+        loaded_bytes += size;
+        ++m_stats.loaded_pages;
+        ++m_stats.resident_pages;
+        m_stats.resident_bytes += size;
+        pages->push_back(page);
+    }
+
+    evict(m_residency_budget);
+}
+
+std::span<glm::vec3 const> PagedMesh::page_positions(uint32_t page) const
+{
+    std::byte const* data = m_file.data().data() + m_pages[page].offset;
+    return std::span<glm::vec3 const>(reinterpret_cast<glm::vec3 const*>(data), m_pages[page].vertex_count);
+}
+
+std::span<glm::u32vec3 const> PagedMesh::page_indices(uint32_t page) const
+{
+    std::byte const* data = m_file.data().data() + m_pages[page].offset + m_pages[page].vertex_count * sizeof(glm::vec3);
+    return std::span<glm::u32vec3 const>(reinterpret_cast<glm::u32vec3 const*>(data), m_pages[page].triangle_count);
+}
+
+uint64_t PagedMesh::page_first_triangle(uint32_t page) const
+{
+    return m_first_triangles[page];
+}
+
+PagedMeshStats const& PagedMesh::stats() const
+{
+    return m_stats;
+}
+
+bool PagedMesh::check_page(uint32_t page)
+{
+    std::span<glm::u32vec3 const> indices      = page_indices(page);
+    uint32_t                      vertex_count = m_pages[page].vertex_count;
+
+    bool is_valid       = std::all_of(indices.begin(), indices.end(), [&](glm::u32vec3 const& triangle)
+                                      { return triangle.x < vertex_count && triangle.y < vertex_count && triangle.z < vertex_count; });
+    m_page_states[page] = is_valid ? PageState::Valid : PageState::Corrupt;
+    if (!is_valid)
+    {
+        log_message(LogLevel::Warn, "PagedMesh: Page %u of '%s' is corrupt and is not drawn (delete the file to rebuild it)", page, m_path.string().c_str());
+        m_file.discard(m_pages[page].offset, page_size(page));
+    }
+
+    return is_valid;
+}
+
+void PagedMesh::evict(size_t budget)
+{
+    // Pages selected in the current frame are still in use
+    while (m_stats.resident_bytes > budget && !m_lru.empty() && m_last_used[m_lru.back()] != m_frame)
+    {
+        uint32_t page = m_lru.back();
+        m_lru.pop_back();
+        m_file.discard(m_pages[page].offset, page_size(page));
+        m_is_resident[page] = false;
+
+        --m_stats.resident_pages;
+        m_stats.resident_bytes -= page_size(page);
+    }
+}
+
+size_t PagedMesh::page_size(uint32_t page) const
+{
+    return m_pages[page].vertex_count * sizeof(glm::vec3) + m_pages[page].triangle_count * sizeof(glm::u32vec3);
+}
+
+} // namespace cgtub
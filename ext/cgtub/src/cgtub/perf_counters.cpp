@@ -0,0 +1,135 @@
+#include "cgtub/perf_counters.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cgtub/log.hpp"
+
+namespace cgtub
+{
+
+#ifdef __linux__
+namespace
+{
+
+struct CounterEvent
+{
+    uint32_t               type;
+    uint64_t               config;
+    uint64_t PerfCounters::*field;
+};
+
+// The cycle counter comes first, it leads the group
+constexpr CounterEvent counter_events[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, &PerfCounters::cycles},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, &PerfCounters::instructions},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), &PerfCounters::l1d_misses},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, &PerfCounters::llc_misses},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, &PerfCounters::branch_misses},
+};
+
+int open_counter(CounterEvent const& event, int group_fd)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size           = sizeof(attributes);
+    attributes.type           = event.type;
+    attributes.config         = event.config;
+    attributes.exclude_kernel = 1; // Allowed with perf_event_paranoid <= 2
+    attributes.exclude_hv     = 1;
+    attributes.read_format    = PERF_FORMAT_GROUP;
+    attributes.disabled       = group_fd == -1 ? 1 : 0; // The group starts when the leader is enabled
+
+    // This thread, on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group_fd, 0));
+}
+
+} // namespace
+#endif
+
+PerfCounters operator+(PerfCounters const& a, PerfCounters const& b)
+{
+    return PerfCounters{a.cycles + b.cycles, a.instructions + b.instructions, a.l1d_misses + b.l1d_misses, a.llc_misses + b.llc_misses,
+                        a.branch_misses + b.branch_misses};
+}
+
+PerfCounters operator-(PerfCounters const& a, PerfCounters const& b)
+{
+    return PerfCounters{a.cycles - b.cycles, a.instructions - b.instructions, a.l1d_misses - b.l1d_misses, a.llc_misses - b.llc_misses,
+                        a.branch_misses - b.branch_misses};
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+#ifdef __linux__
+    for (size_t i = 0; i < m_count; ++i)
+        close(m_fds[i]);
+#endif
+}
+
+bool PerfCounterGroup::open()
+{
+    if (is_open())
+        return true;
+
+#ifdef __linux__
+    for (CounterEvent const& event : counter_events)
+    {
+        int fd = open_counter(event, m_count == 0 ? -1 : m_fds[0]);
+        if (fd == -1)
+        {
+            if (m_count == 0)
+            {
+                log_message(LogLevel::Warn, "PerfCounterGroup::open: perf_event_open failed (%s), no hardware counters", std::strerror(errno));
+                return false;
+            }
+            continue; // Not provided by this CPU
+        }
+
+        m_fds[m_count]    = fd;
+        m_fields[m_count] = event.field;
+        ++m_count;
+    }
+
+    ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    log_message(LogLevel::Warn, "PerfCounterGroup::open: hardware counters are only supported on Linux");
+    return false;
+#endif
+}
+
+bool PerfCounterGroup::is_open() const
+{
+    return m_count > 0;
+}
+
+PerfCounters PerfCounterGroup::read() const
+{
+    PerfCounters counters;
+
+#ifdef __linux__
+    if (!is_open())
+        return counters;
+
+    // The group is read at once: the number of counters, followed by their values in the order they were opened
+    uint64_t values[1 + max_counters];
+    if (::read(m_fds[0], values, sizeof(values)) < static_cast<ssize_t>((1 + m_count) * sizeof(uint64_t)))
+        return counters;
+
+    for (size_t i = 0; i < m_count; ++i)
+        counters.*m_fields[i] = values[1 + i];
+#endif
+
+    return counters;
+}
+
+} // namespace cgtub
@@ -0,0 +1,579 @@
+#include "cgtub/ply_loader.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "cgtub/log.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+// The file is decoded in chunks of (at least) this size in bytes
+constexpr size_t ply_chunk_size = size_t(1) << 22;
+
+// Triangles are passed on in batches of this size
+constexpr size_t ply_triangle_batch_size = ply_chunk_size / sizeof(glm::u32vec3);
+
+// Longer lists are rejected (a corrupt count must not make the reader allocate huge buffers)
+constexpr int64_t max_list_length = int64_t(1) << 20;
+
+enum class PlyType
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+    Invalid
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType     type;
+    bool        is_list;
+    PlyType     count_type; // Type of the element count (of lists)
+};
+
+struct PlyElement
+{
+    std::string              name;
+    uint64_t                 count;
+    std::vector<PlyProperty> properties;
+};
+
+PlyType parse_type(std::string const& name)
+{
+    if (name == "char" || name == "int8")
+        return PlyType::Int8;
+    if (name == "uchar" || name == "uint8")
+        return PlyType::UInt8;
+    if (name == "short" || name == "int16")
+        return PlyType::Int16;
+    if (name == "ushort" || name == "uint16")
+        return PlyType::UInt16;
+    if (name == "int" || name == "int32")
+        return PlyType::Int32;
+    if (name == "uint" || name == "uint32")
+        return PlyType::UInt32;
+    if (name == "float" || name == "float32")
+        return PlyType::Float32;
+    if (name == "double" || name == "float64")
+        return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+size_t type_size(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Reverses the byte order of an unsigned integer
+template<typename Bits>
+Bits swap_byte_order(Bits bits)
+{
+    Bits swapped = 0;
+    for (size_t i = 0; i < sizeof(Bits); ++i)
+        swapped = static_cast<Bits>((swapped << 8) | ((bits >> (8 * i)) & 0xff));
+    return swapped;
+}
+
+// Reads a value stored as U (in the byte order of the file), converting it to T
+template<typename T, typename U>
+T read_as(char const* data, bool swap_bytes)
+{
+    // The bytes are swapped as an unsigned integer of the same size, so the copy has a fixed length
+    using Bits = std::conditional_t<sizeof(U) == 1, uint8_t, std::conditional_t<sizeof(U) == 2, uint16_t, std::conditional_t<sizeof(U) == 4, uint32_t, uint64_t>>>;
+    static_assert(sizeof(Bits) == sizeof(U));
+
+    Bits bits;
+    std::memcpy(&bits, data, sizeof(Bits));
+    if (swap_bytes)
+        bits = swap_byte_order(bits);
+    return static_cast<T>(std::bit_cast<U>(bits));
+}
+
+// Reads a value of the given type, converting it to T
+template<typename T>
+T read_value(char const* data, PlyType type, bool swap_bytes)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+        return read_as<T, int8_t>(data, swap_bytes);
+    case PlyType::UInt8:
+        return read_as<T, uint8_t>(data, swap_bytes);
+    case PlyType::Int16:
+        return read_as<T, int16_t>(data, swap_bytes);
+    case PlyType::UInt16:
+        return read_as<T, uint16_t>(data, swap_bytes);
+    case PlyType::Int32:
+        return read_as<T, int32_t>(data, swap_bytes);
+    case PlyType::UInt32:
+        return read_as<T, uint32_t>(data, swap_bytes);
+    case PlyType::Float32:
+        return read_as<T, float>(data, swap_bytes);
+    default:
+        return read_as<T, double>(data, swap_bytes);
+    }
+}
+
+// Buffered reader that keeps (at least) the requested number of bytes in memory
+class ChunkReader
+{
+public:
+    explicit ChunkReader(std::ifstream& file)
+        : m_file(file)
+        , m_buffer(ply_chunk_size)
+    {
+    }
+
+    // Makes `size` bytes available at `data()`, returns false if the file ends before
+    bool require(size_t size)
+    {
+        if (m_end - m_position >= size)
+            return true;
+
+        // Keep the unconsumed rest and refill the buffer behind it
+        std::copy(m_buffer.begin() + m_position, m_buffer.begin() + m_end, m_buffer.begin());
+        m_end     -= m_position;
+        m_position = 0;
+        if (m_buffer.size() < size)
+            m_buffer.resize(size);
+
+        m_file.read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_buffer.size() - m_end));
+        m_end += static_cast<size_t>(m_file.gcount());
+
+        return m_end >= size;
+    }
+
+    char const* data() const
+    {
+        return m_buffer.data() + m_position;
+    }
+
+    void advance(size_t size)
+    {
+        m_position += size;
+    }
+
+    size_t capacity() const
+    {
+        return m_buffer.size();
+    }
+
+private:
+    std::ifstream&    m_file;
+    std::vector<char> m_buffer;
+    size_t            m_position = 0;
+    size_t            m_end      = 0;
+};
+
+bool parse_header(std::ifstream& file, std::vector<PlyElement>* elements, bool* big_endian)
+{
+    std::string line;
+    if (!std::getline(file, line) || line.substr(0, 3) != "ply")
+        return false;
+
+    bool has_format = false;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::istringstream stream(line);
+        std::string        keyword;
+        stream >> keyword;
+        if (keyword == "format")
+        {
+            std::string format;
+            stream >> format;
+            if (format != "binary_little_endian" && format != "binary_big_endian")
+                return false;
+            *big_endian = format == "binary_big_endian";
+            has_format  = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            if (!(stream >> element.name >> element.count))
+                return false;
+            elements->push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (elements->empty())
+                return false;
+
+            PlyProperty property;
+            std::string type;
+            stream >> type;
+            property.is_list = type == "list";
+            if (property.is_list)
+            {
+                std::string count_type;
+                stream >> count_type >> type;
+                property.count_type = parse_type(count_type);
+                if (property.count_type == PlyType::Invalid)
+                    return false;
+            }
+            property.type = parse_type(type);
+            stream >> property.name;
+            if (property.type == PlyType::Invalid || property.name.empty())
+                return false;
+
+            elements->back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+            return has_format;
+    }
+
+    return false;
+}
+
+// Size of a record of an element without lists (0 if it has lists)
+size_t fixed_record_size(PlyElement const& element)
+{
+    size_t size = 0;
+    for (PlyProperty const& property : element.properties)
+    {
+        if (property.is_list)
+            return 0;
+        size += type_size(property.type);
+    }
+
+    return size;
+}
+
+// Reads the length of a list property
+bool read_list_count(ChunkReader& reader, PlyProperty const& property, bool big_endian, size_t* count)
+{
+    if (!reader.require(type_size(property.count_type)))
+        return false;
+
+    int64_t value = read_value<int64_t>(reader.data(), property.count_type, big_endian);
+    reader.advance(type_size(property.count_type));
+
+    *count = static_cast<size_t>(value);
+    return value >= 0 && value <= max_list_length;
+}
+
+// Skips the records of an element (whose data starts at the reader position)
+bool skip_element(ChunkReader& reader, PlyElement const& element, bool big_endian)
+{
+    for (uint64_t record = 0; record < element.count; ++record)
+    {
+        for (PlyProperty const& property : element.properties)
+        {
+            if (!property.is_list)
+            {
+                if (!reader.require(type_size(property.type)))
+                    return false;
+                reader.advance(type_size(property.type));
+                continue;
+            }
+
+            size_t count;
+            if (!read_list_count(reader, property, big_endian, &count) || !reader.require(count * type_size(property.type)))
+                return false;
+            reader.advance(count * type_size(property.type));
+        }
+    }
+
+    return true;
+}
+
+bool read_vertices(ChunkReader& reader, PlyElement const& element, bool big_endian, PlyVertexCallback const& callback)
+{
+    // Offsets of the coordinates within a vertex record
+    size_t  record_size = fixed_record_size(element);
+    size_t  offsets[3]  = {};
+    PlyType types[3]    = {PlyType::Invalid, PlyType::Invalid, PlyType::Invalid};
+    size_t  offset      = 0;
+    for (PlyProperty const& property : element.properties)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (property.name == std::string(1, static_cast<char>('x' + axis)))
+            {
+                offsets[axis] = offset;
+                types[axis]   = property.type;
+            }
+        }
+        offset += type_size(property.type);
+    }
+
+    if (record_size == 0 || types[0] == PlyType::Invalid || types[1] == PlyType::Invalid || types[2] == PlyType::Invalid)
+        return false;
+
+    // Decode as many whole records as fit into the buffer at once
+    size_t             batch_size = std::max<size_t>(reader.capacity() / record_size, 1);
+    std::vector<float> coordinates[3];
+    for (std::vector<float>& axis_coordinates : coordinates)
+        axis_coordinates.resize(static_cast<size_t>(std::min<uint64_t>(batch_size, element.count)));
+
+    for (uint64_t first = 0; first < element.count; first += batch_size)
+    {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(batch_size, element.count - first));
+        if (!reader.require(count * record_size))
+            return false;
+
+        char const* records = reader.data();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float* output = coordinates[axis].data();
+            if (types[axis] == PlyType::Float32 && !big_endian)
+            {
+                for (size_t v = 0; v < count; ++v)
+                    std::memcpy(&output[v], records + v * record_size + offsets[axis], sizeof(float));
+            }
+            else
+            {
+                for (size_t v = 0; v < count; ++v)
+                    output[v] = read_value<float>(records + v * record_size + offsets[axis], types[axis], big_endian);
+            }
+        }
+        reader.advance(count * record_size);
+
+        callback(element.count, first, std::span<float const>(coordinates[0].data(), count), std::span<float const>(coordinates[1].data(), count),
+                 std::span<float const>(coordinates[2].data(), count));
+    }
+
+    return true;
+}
+
+// Triangles with corners that are not among the vertices are dropped (and make the element invalid)
+bool read_faces(ChunkReader& reader, PlyElement const& element, bool big_endian, uint64_t vertex_count, PlyTriangleCallback const& callback)
+{
+    // Most files store nothing but triangles as lists with an 8-bit count and 32-bit indices
+    bool fast_layout = element.properties.size() == 1 && element.properties[0].is_list && !big_endian &&
+                       type_size(element.properties[0].count_type) == 1 && type_size(element.properties[0].type) == 4 &&
+                       element.properties[0].type != PlyType::Float32;
+
+    std::vector<glm::u32vec3> triangles;
+    triangles.reserve(ply_triangle_batch_size);
+    auto flush = [&]()
+    {
+        if (!triangles.empty())
+            callback(element.count, triangles);
+        triangles.clear();
+    };
+
+    bool valid = true;
+    for (uint64_t record = 0; record < element.count; ++record)
+    {
+        if (triangles.size() >= ply_triangle_batch_size)
+            flush();
+
+        if (fast_layout && reader.require(13) && reader.data()[0] == 3)
+        {
+            // Signed indices are negative if they are interpreted as large unsigned ones
+            glm::u32vec3 tri;
+            std::memcpy(&tri, reader.data() + 1, sizeof(tri));
+            if (tri.x < vertex_count && tri.y < vertex_count && tri.z < vertex_count)
+                triangles.push_back(tri);
+            else
+                valid = false;
+            reader.advance(13);
+            continue;
+        }
+
+        for (PlyProperty const& property : element.properties)
+        {
+            size_t size = type_size(property.type);
+            if (!property.is_list)
+            {
+                if (!reader.require(size))
+                    return false;
+                reader.advance(size);
+                continue;
+            }
+
+            size_t count;
+            if (!read_list_count(reader, property, big_endian, &count) || !reader.require(count * size))
+                return false;
+
+            if (property.name == "vertex_indices" || property.name == "vertex_index")
+            {
+                // Triangulate polygons as fans around their first corner
+                char const* corners = reader.data();
+                auto        corner  = [&](size_t i)
+                { return read_value<int64_t>(corners + i * size, property.type, big_endian); };
+                auto is_vertex = [&](int64_t index)
+                { return index >= 0 && static_cast<uint64_t>(index) < vertex_count; };
+                for (size_t i = 1; i + 1 < count; ++i)
+                {
+                    int64_t a = corner(0), b = corner(i), c = corner(i + 1);
+                    if (is_vertex(a) && is_vertex(b) && is_vertex(c))
+                        triangles.emplace_back(static_cast<uint32_t>(a), static_cast<uint32_t>(b), static_cast<uint32_t>(c));
+                    else
+                        valid = false;
+                }
+            }
+            reader.advance(count * size);
+        }
+    }
+    flush();
+
+    return valid;
+}
+
+// Opens a PLY file and parses its header (logging failures on behalf of `caller`)
+bool open_ply(std::filesystem::path const& path, char const* caller, std::ifstream* file, uint64_t* file_size, std::vector<PlyElement>* elements, bool* big_endian)
+{
+    std::error_code error;
+    *file_size = std::filesystem::file_size(path, error);
+    file->open(path, std::ios::binary);
+    if (error || !*file)
+    {
+        log_message(LogLevel::Error, "%s: Failed to open '%s'", caller, path.string().c_str());
+        return false;
+    }
+
+    if (!parse_header(*file, elements, big_endian))
+    {
+        log_message(LogLevel::Error, "%s: '%s' is not a binary PLY file", caller, path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool read_ply(std::filesystem::path const& path, char const* caller, PlyVertexCallback const& vertices, PlyTriangleCallback const& triangles)
+{
+    std::ifstream           file;
+    uint64_t                file_size;
+    std::vector<PlyElement> elements;
+    bool                    big_endian = false;
+    if (!open_ply(path, caller, &file, &file_size, &elements, &big_endian))
+        return false;
+
+    ChunkReader reader(file);
+    bool        has_vertices = false;
+    uint64_t    vertex_count = 0;
+    for (PlyElement const& element : elements)
+    {
+        // Every record takes at least one byte, so corrupt counts are caught before anything is allocated for them
+        bool success = element.count <= file_size / std::max<size_t>(fixed_record_size(element), 1);
+        if (success && element.name == "vertex" && !has_vertices)
+        {
+            success      = read_vertices(reader, element, big_endian, vertices);
+            vertex_count = element.count;
+            has_vertices = true;
+        }
+        else if (success && element.name == "face" && has_vertices)
+            success = read_faces(reader, element, big_endian, vertex_count, triangles);
+        else if (success)
+            success = skip_element(reader, element, big_endian);
+
+        if (!success)
+        {
+            log_message(LogLevel::Error, "%s: '%s' has invalid or truncated '%s' elements", caller, path.string().c_str(), element.name.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool read_ply_counts(std::filesystem::path const& path, uint64_t* vertex_count, uint64_t* face_count)
+{
+    std::ifstream           file;
+    uint64_t                file_size;
+    std::vector<PlyElement> elements;
+    bool                    big_endian = false;
+    if (!open_ply(path, "read_ply_counts", &file, &file_size, &elements, &big_endian))
+        return false;
+
+    *vertex_count = 0;
+    *face_count   = 0;
+    for (PlyElement const& element : elements)
+    {
+        if (element.name == "vertex")
+            *vertex_count = element.count;
+        else if (element.name == "face")
+            *face_count = element.count;
+    }
+
+    return true;
+}
+
+bool stream_ply(std::filesystem::path const& path, PlyVertexCallback const& vertices, PlyTriangleCallback const& triangles)
+{
+    return read_ply(path, "stream_ply", vertices, triangles);
+}
+
+bool load_ply(std::filesystem::path const& path, std::vector<float>* xs, std::vector<float>* ys, std::vector<float>* zs, std::vector<glm::u32vec3>* indices)
+{
+    xs->clear();
+    ys->clear();
+    zs->clear();
+    indices->clear();
+
+    auto store_vertices = [&](uint64_t vertex_count, uint64_t first_vertex, std::span<float const> chunk_xs, std::span<float const> chunk_ys, std::span<float const> chunk_zs)
+    {
+        // The coordinate arrays are allocated once at their final size
+        if (first_vertex == 0)
+        {
+            xs->resize(vertex_count);
+            ys->resize(vertex_count);
+            zs->resize(vertex_count);
+        }
+        std::copy(chunk_xs.begin(), chunk_xs.end(), xs->begin() + first_vertex);
+        std::copy(chunk_ys.begin(), chunk_ys.end(), ys->begin() + first_vertex);
+        std::copy(chunk_zs.begin(), chunk_zs.end(), zs->begin() + first_vertex);
+    };
+
+    auto store_triangles = [&](uint64_t face_count, std::span<glm::u32vec3 const> triangles)
+    {
+        // Most scanned meshes consist of triangles only
+        if (indices->empty())
+            indices->reserve(face_count);
+        indices->insert(indices->end(), triangles.begin(), triangles.end());
+    };
+
+    if (!read_ply(path, "load_ply", store_vertices, store_triangles))
+    {
+        xs->clear();
+        ys->clear();
+        zs->clear();
+        indices->clear();
+        return false;
+    }
+
+    log_message(LogLevel::Debug, "load_ply: '%s' has %zu vertices and %zu triangles", path.string().c_str(), xs->size(), indices->size());
+
+    return true;
+}
+
+} // namespace cgtub
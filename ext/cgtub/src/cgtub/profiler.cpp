@@ -0,0 +1,260 @@
+#include "cgtub/profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <json.hpp>
+
+#include "cgtub/log.hpp"
+
+using json = nlohmann::json;
+
+namespace cgtub
+{
+
+namespace
+{
+
+constexpr uint64_t thread_buffer_capacity = 1u << 16;
+
+struct ThreadEvent
+{
+    char const*  name;
+    uint64_t     begin;
+    uint64_t     end;
+    PerfCounters counters;
+};
+
+// The events of one thread; written only by that thread, read by `collect_profile_events`
+struct ThreadBuffer
+{
+    uint32_t                       thread;
+    std::string                    name; // Guarded by the registry mutex
+    std::unique_ptr<ThreadEvent[]> events{new ThreadEvent[thread_buffer_capacity]};
+    std::atomic<uint64_t>          count{0}; // Number of events ever recorded, the last ones are in the buffer
+    PerfCounterGroup               counters;
+    bool                           counters_failed = false; // Opening the counters failed, they are not tried again
+};
+
+std::atomic<bool> g_counters_enabled{false};
+
+// All thread buffers; they outlive their threads, so events of finished threads can still be collected
+struct Registry
+{
+    std::mutex                                 mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& registry()
+{
+    // Never destroyed, threads may still record while static objects are destroyed
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+ThreadBuffer& thread_buffer()
+{
+    // Registering takes the lock once per thread, recording itself does not
+    thread_local std::shared_ptr<ThreadBuffer> buffer = []
+    {
+        Registry&                     registry = cgtub::registry();
+        std::lock_guard               lock(registry.mutex);
+        std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+        buffer->thread                       = static_cast<uint32_t>(registry.buffers.size());
+        buffer->name                         = "thread " + std::to_string(buffer->thread);
+        registry.buffers.push_back(buffer);
+        return buffer;
+    }();
+    return *buffer;
+}
+
+} // namespace
+
+uint64_t profiler_now()
+{
+    using Clock = std::chrono::steady_clock;
+
+    static Clock::time_point const epoch = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+bool enable_profile_counters(bool enable)
+{
+    if (enable)
+    {
+        ThreadBuffer& buffer = thread_buffer();
+        if (!buffer.counters.open())
+        {
+            buffer.counters_failed = true;
+            return false;
+        }
+    }
+
+    g_counters_enabled.store(enable, std::memory_order_relaxed);
+    return true;
+}
+
+PerfCounters read_profile_counters()
+{
+    if (!g_counters_enabled.load(std::memory_order_relaxed))
+        return PerfCounters{};
+
+    ThreadBuffer& buffer = thread_buffer();
+    if (!buffer.counters.is_open() && !buffer.counters_failed)
+        buffer.counters_failed = !buffer.counters.open();
+    return buffer.counters.read();
+}
+
+void record_profile_zone(char const* name, uint64_t begin, uint64_t end, PerfCounters const& counters)
+{
+    ThreadBuffer& buffer = thread_buffer();
+    uint64_t      count  = buffer.count.load(std::memory_order_relaxed);
+
+    // A collector that sees (part of) the new event also sees the count of the previous one (see collect_profile_events)
+    std::atomic_thread_fence(std::memory_order_release);
+    buffer.events[count % thread_buffer_capacity] = ThreadEvent{name, begin, end, counters};
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void set_profiler_thread_name(char const* name)
+{
+    ThreadBuffer&   buffer = thread_buffer();
+    std::lock_guard lock(registry().mutex);
+    buffer.name = name;
+}
+
+void collect_profile_events(uint64_t since, std::vector<ProfileEvent>* events)
+{
+    events->clear();
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard lock(registry().mutex);
+        buffers = registry().buffers;
+    }
+
+    std::vector<ThreadEvent> thread_events;
+    for (std::shared_ptr<ThreadBuffer> const& buffer : buffers)
+    {
+        uint64_t end   = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = end > thread_buffer_capacity ? end - thread_buffer_capacity : 0;
+
+        thread_events.clear();
+        for (uint64_t i = begin; i < end; ++i)
+            thread_events.push_back(buffer->events[i % thread_buffer_capacity]);
+
+        // Skip the events the thread may have overwritten while they were copied, including the slot of the
+        // event it may be writing right now (event overwritten_end, in the slot of event overwritten_end - capacity)
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t overwritten_end = buffer->count.load(std::memory_order_relaxed);
+        uint64_t first = std::min(std::max(overwritten_end + 1, begin + thread_buffer_capacity) - begin - thread_buffer_capacity, end - begin);
+        for (uint64_t i = first; i < thread_events.size(); ++i)
+            if (thread_events[i].begin >= since)
+                events->push_back(ProfileEvent{thread_events[i].name, thread_events[i].begin, thread_events[i].end, buffer->thread, thread_events[i].counters});
+    }
+
+    // Enclosing zones before the zones they contain (earlier start, or the same start and a later end)
+    std::sort(events->begin(), events->end(), [](ProfileEvent const& a, ProfileEvent const& b)
+    {
+        if (a.thread != b.thread)
+            return a.thread < b.thread;
+        if (a.begin != b.begin)
+            return a.begin < b.begin;
+        return a.end > b.end;
+    });
+}
+
+void summarize_profile_events(std::span<ProfileEvent const> events, std::vector<ProfileStage>* stages)
+{
+    stages->clear();
+
+    // Time and counters of each event without those of its nested events
+    std::vector<double>       exclusive(events.size());
+    std::vector<PerfCounters> exclusive_counters(events.size());
+    std::vector<size_t>       open; // Enclosing events of the current event
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        ProfileEvent const& event = events[i];
+        while (!open.empty() && (events[open.back()].thread != event.thread || events[open.back()].end <= event.begin))
+            open.pop_back();
+
+        double milliseconds   = (event.end - event.begin) * 1e-6;
+        exclusive[i]          = milliseconds;
+        exclusive_counters[i] = event.counters;
+        if (!open.empty() && event.end <= events[open.back()].end)
+        {
+            exclusive[open.back()] -= milliseconds;
+            exclusive_counters[open.back()] = exclusive_counters[open.back()] - event.counters;
+        }
+        open.push_back(i);
+    }
+
+    // Equal names may be different string literals, so names are compared by their characters
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        auto stage = std::find_if(stages->begin(), stages->end(), [&](ProfileStage const& stage)
+        {
+            return std::strcmp(stage.name, events[i].name) == 0;
+        });
+        if (stage == stages->end())
+        {
+            stages->push_back(ProfileStage{events[i].name, exclusive[i], exclusive_counters[i]});
+        }
+        else
+        {
+            stage->milliseconds += exclusive[i];
+            stage->counters = stage->counters + exclusive_counters[i];
+        }
+    }
+}
+
+bool write_chrome_trace(std::filesystem::path const& path, std::span<ProfileEvent const> events)
+{
+    json trace_events = json::array();
+
+    // Thread names are metadata events
+    {
+        std::lock_guard lock(registry().mutex);
+        for (std::shared_ptr<ThreadBuffer> const& buffer : registry().buffers)
+            trace_events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->thread}, {"args", {{"name", buffer->name}}}});
+    }
+
+    // Complete events, with times in microseconds and the hardware events (if counted) as arguments
+    for (ProfileEvent const& event : events)
+    {
+        json trace_event = {{"name", event.name},
+                            {"cat", "cgtub"},
+                            {"ph", "X"},
+                            {"ts", event.begin * 1e-3},
+                            {"dur", (event.end - event.begin) * 1e-3},
+                            {"pid", 1},
+                            {"tid", event.thread}};
+        if (event.counters.cycles > 0)
+        {
+            trace_event["args"] = {{"cycles", event.counters.cycles},
+                                   {"instructions", event.counters.instructions},
+                                   {"l1d_misses", event.counters.l1d_misses},
+                                   {"llc_misses", event.counters.llc_misses},
+                                   {"branch_misses", event.counters.branch_misses}};
+        }
+        trace_events.push_back(std::move(trace_event));
+    }
+
+    std::ofstream file(path);
+    file << json{{"traceEvents", std::move(trace_events)}, {"displayTimeUnit", "ms"}}.dump();
+    if (!file)
+    {
+        log_message(LogLevel::Error, "write_chrome_trace(): could not write '%s'", path.string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace cgtub
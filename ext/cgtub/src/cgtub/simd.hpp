@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Thin wrappers around the widest SIMD instruction set cgtub is compiled for (see CGTUB_NATIVE_ARCH).
+// Without AVX2, `Float` is a plain float, so kernels written against these wrappers
+// double as their own scalar fallback.
+namespace cgtub::simd
+{
+
+#if defined(__AVX512F__)
+
+constexpr size_t width = 16;
+
+using Float = __m512;
+
+// Selects all lanes. The plain forms of some AVX-512 intrinsics pass an undefined register that GCC 12
+// reports as uninitialized (-Wmaybe-uninitialized), so kernels use the zero-masked forms with this mask.
+constexpr __mmask16 all_lanes = 0xFFFF;
+
+inline Float broadcast(float value) { return _mm512_set1_ps(value); }
+inline Float load(float const* data) { return _mm512_loadu_ps(data); }
+inline void  store(float* data, Float value) { _mm512_storeu_ps(data, value); }
+inline Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+inline Float min(Float a, Float b) { return _mm512_maskz_min_ps(all_lanes, a, b); }
+inline Float max(Float a, Float b) { return _mm512_maskz_max_ps(all_lanes, a, b); }
+
+// Bit i is set if a[i] < b[i]
+inline unsigned int less_mask(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+
+#elif defined(__AVX2__)
+
+constexpr size_t width = 8;
+
+using Float = __m256;
+
+inline Float broadcast(float value) { return _mm256_set1_ps(value); }
+inline Float load(float const* data) { return _mm256_loadu_ps(data); }
+inline void  store(float* data, Float value) { _mm256_storeu_ps(data, value); }
+inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+// Bit i is set if a[i] < b[i]
+inline unsigned int less_mask(Float a, Float b) { return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ))); }
+
+#else
+
+constexpr size_t width = 1;
+
+using Float = float;
+
+inline Float broadcast(float value) { return value; }
+inline Float load(float const* data) { return *data; }
+inline void  store(float* data, Float value) { *data = value; }
+inline Float add(Float a, Float b) { return a + b; }
+inline Float sub(Float a, Float b) { return a - b; }
+inline Float mul(Float a, Float b) { return a * b; }
+inline Float min(Float a, Float b) { return a < b ? a : b; }
+inline Float max(Float a, Float b) { return a < b ? b : a; }
+
+// Bit 0 is set if a < b
+inline unsigned int less_mask(Float a, Float b) { return a < b ? 1u : 0u; }
+
+#endif
+
+// Mask with the lowest `width` bits set
+constexpr unsigned int full_mask = static_cast<unsigned int>((1ull << width) - 1);
+
+// Name of the instruction set ("AVX-512", "AVX2" or "Scalar")
+constexpr char const* name()
+{
+    return width == 16 ? "AVX-512" : width == 8 ? "AVX2" : "Scalar";
+}
+
+} // namespace cgtub::simd
@@ -0,0 +1,333 @@
+#include "cgtub/simplify.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+#include "cgtub/threading.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+constexpr size_t min_elements_per_job = 1 << 14;
+
+// Symmetric 4x4 error quadric (A, b, c), evaluated as p^T A p + 2 b^T p + c
+struct Quadric
+{
+    float a00, a01, a02, a11, a12, a22;
+    float b0, b1, b2;
+    float c;
+
+    static Quadric from_plane(glm::vec3 const& n, float d, float weight)
+    {
+        return Quadric{weight * n.x * n.x, weight * n.x * n.y, weight * n.x * n.z,
+                       weight * n.y * n.y, weight * n.y * n.z, weight * n.z * n.z,
+                       weight * d * n.x, weight * d * n.y, weight * d * n.z,
+                       weight * d * d};
+    }
+
+    Quadric& operator+=(Quadric const& q)
+    {
+        a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+        b0 += q.b0, b1 += q.b1, b2 += q.b2;
+        c += q.c;
+        return *this;
+    }
+
+    float error(glm::vec3 const& p) const
+    {
+        float rx = a00 * p.x + a01 * p.y + a02 * p.z;
+        float ry = a01 * p.x + a11 * p.y + a12 * p.z;
+        float rz = a02 * p.x + a12 * p.y + a22 * p.z;
+        return std::max(0.f, p.x * rx + p.y * ry + p.z * rz + 2.f * (b0 * p.x + b1 * p.y + b2 * p.z) + c);
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    float    error;
+};
+
+// Vertex-to-triangle adjacency in compressed row storage
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    void build(size_t num_vertices, std::span<glm::u32vec3 const> indices)
+    {
+        offsets.assign(num_vertices + 1, 0);
+        for (glm::u32vec3 const& tri : indices)
+            for (int k = 0; k < 3; ++k)
+                ++offsets[tri[k] + 1];
+        for (size_t v = 0; v < num_vertices; ++v)
+            offsets[v + 1] += offsets[v];
+
+        triangles.resize(offsets.back());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < indices.size(); ++t)
+            for (int k = 0; k < 3; ++k)
+                triangles[fill[indices[t][k]]++] = static_cast<uint32_t>(t);
+    }
+
+    std::span<uint32_t const> of(uint32_t vertex) const
+    {
+        return std::span<uint32_t const>(triangles.data() + offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+    }
+};
+
+// Approximate (but linear time) sort of the collapses by increasing error:
+// bucket by the upper 15 bits of the (non-negative) float error, which preserves its ordering
+void sort_collapses(std::vector<Collapse>* collapses)
+{
+    constexpr size_t num_buckets = 1 << 15;
+
+    auto bucket = [](float error)
+    { return std::bit_cast<uint32_t>(error) >> 16; };
+
+    std::vector<uint32_t> offsets(num_buckets + 1, 0);
+    for (Collapse const& collapse : *collapses)
+        ++offsets[bucket(collapse.error) + 1];
+    for (size_t i = 0; i < num_buckets; ++i)
+        offsets[i + 1] += offsets[i];
+
+    std::vector<Collapse> sorted(collapses->size());
+    for (Collapse const& collapse : *collapses)
+        sorted[offsets[bucket(collapse.error)]++] = collapse;
+
+    collapses->swap(sorted);
+}
+
+class Simplifier
+{
+public:
+    Simplifier(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices)
+        : m_positions(positions)
+        , m_indices(indices.begin(), indices.end())
+        , m_quadrics(positions.size())
+        , m_boundary(positions.size(), 0)
+        , m_remap(positions.size())
+        , m_locked(positions.size(), 0)
+    {
+        m_adjacency.build(positions.size(), m_indices);
+
+        // Vertex quadrics: area-weighted sum of the planes of the adjacent triangles
+        parallel_for(positions.size(), min_elements_per_job, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v)
+            {
+                Quadric quadric{};
+                for (uint32_t t : m_adjacency.of(static_cast<uint32_t>(v)))
+                {
+                    glm::u32vec3 const& tri    = m_indices[t];
+                    glm::vec3           normal = glm::cross(m_positions[tri.y] - m_positions[tri.x], m_positions[tri.z] - m_positions[tri.x]);
+                    float               length = glm::length(normal);
+                    if (length > 0.f)
+                    {
+                        normal /= length;
+                        quadric += Quadric::from_plane(normal, -glm::dot(normal, m_positions[tri.x]), 0.5f * length);
+                    }
+                }
+                m_quadrics[v] = quadric;
+            }
+        });
+
+        // Boundary vertices: an edge without its opposite half-edge lies on an open boundary
+        for (glm::u32vec3 const& tri : m_indices)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t a = tri[k];
+                uint32_t b = tri[(k + 1) % 3];
+                if (!has_half_edge(b, a))
+                    m_boundary[a] = m_boundary[b] = 1;
+            }
+        }
+    }
+
+    // Collapse edges until the mesh has at most `target_triangle_count` triangles (or no collapse is possible)
+    void simplify(size_t target_triangle_count)
+    {
+        std::vector<Collapse> collapses;
+        while (m_indices.size() > target_triangle_count)
+        {
+            m_adjacency.build(m_positions.size(), m_indices);
+            collect_collapses(&collapses);
+            sort_collapses(&collapses);
+
+            if (perform_collapses(collapses, m_indices.size() - target_triangle_count) == 0)
+                break;
+
+            compact_indices();
+        }
+    }
+
+    std::vector<glm::u32vec3> const& indices() const
+    {
+        return m_indices;
+    }
+
+    float max_error() const
+    {
+        return m_max_error;
+    }
+
+private:
+    bool has_half_edge(uint32_t a, uint32_t b) const
+    {
+        for (uint32_t t : m_adjacency.of(a))
+        {
+            glm::u32vec3 const& tri = m_indices[t];
+            if ((tri.x == a && tri.y == b) || (tri.y == a && tri.z == b) || (tri.z == a && tri.x == b))
+                return true;
+        }
+        return false;
+    }
+
+    // One candidate per edge, in the cheaper of both directions
+    void collect_collapses(std::vector<Collapse>* collapses) const
+    {
+        collapses->clear();
+        for (glm::u32vec3 const& tri : m_indices)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                // Each interior edge appears in both directions, so only take it once
+                uint32_t a = tri[k];
+                uint32_t b = tri[(k + 1) % 3];
+                if (a < b || m_boundary[a] || m_boundary[b])
+                    collapses->push_back(Collapse{a, b, 0.f});
+            }
+        }
+
+        parallel_for(collapses->size(), min_elements_per_job, 1, [&](size_t begin, size_t end)
+        {
+            constexpr float infinity = std::numeric_limits<float>::infinity();
+            for (size_t i = begin; i < end; ++i)
+            {
+                Collapse& collapse = (*collapses)[i];
+                Quadric   quadric  = m_quadrics[collapse.from];
+                quadric += m_quadrics[collapse.to];
+
+                float error_to   = m_boundary[collapse.from] ? infinity : quadric.error(m_positions[collapse.to]);
+                float error_from = m_boundary[collapse.to] ? infinity : quadric.error(m_positions[collapse.from]);
+                if (error_from < error_to)
+                    std::swap(collapse.from, collapse.to);
+                collapse.error = std::min(error_to, error_from);
+            }
+        });
+
+        std::erase_if(*collapses, [](Collapse const& collapse)
+                      { return collapse.error == std::numeric_limits<float>::infinity(); });
+    }
+
+    // Test if moving vertex `from` onto `to` would flip (or degenerate) any of the remaining adjacent triangles
+    bool flips_triangles(uint32_t from, uint32_t to) const
+    {
+        for (uint32_t t : m_adjacency.of(from))
+        {
+            glm::u32vec3 tri(m_remap[m_indices[t].x], m_remap[m_indices[t].y], m_remap[m_indices[t].z]);
+            if (tri.x == to || tri.y == to || tri.z == to)
+                continue; // Collapses with the edge
+
+            glm::vec3 p[3]     = {m_positions[tri.x], m_positions[tri.y], m_positions[tri.z]};
+            glm::vec3 n_before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int k = 0; k < 3; ++k)
+                p[k] = tri[k] == from ? m_positions[to] : p[k];
+            glm::vec3 n_after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+            if (glm::dot(n_before, n_after) <= 0.2f * glm::length(n_before) * glm::length(n_after))
+                return true;
+        }
+        return false;
+    }
+
+    // Greedily perform the cheapest collapses such that every vertex takes part in at most one collapse
+    size_t perform_collapses(std::vector<Collapse> const& collapses, size_t triangle_budget)
+    {
+        for (size_t v = 0; v < m_remap.size(); ++v)
+            m_remap[v] = static_cast<uint32_t>(v);
+        std::fill(m_locked.begin(), m_locked.end(), 0);
+
+        size_t num_collapses     = 0;
+        size_t removed_triangles = 0;
+        for (Collapse const& collapse : collapses)
+        {
+            if (removed_triangles >= triangle_budget)
+                break;
+
+            if (m_locked[collapse.from] || m_locked[collapse.to] || flips_triangles(collapse.from, collapse.to))
+                continue;
+
+            for (uint32_t t : m_adjacency.of(collapse.from))
+            {
+                glm::u32vec3 const& tri = m_indices[t];
+                if (m_remap[tri.x] == collapse.to || m_remap[tri.y] == collapse.to || m_remap[tri.z] == collapse.to)
+                    ++removed_triangles;
+            }
+
+            m_remap[collapse.from]  = collapse.to;
+            m_locked[collapse.from] = m_locked[collapse.to] = 1;
+            m_quadrics[collapse.to] += m_quadrics[collapse.from];
+            m_max_error             = std::max(m_max_error, collapse.error);
+            ++num_collapses;
+        }
+
+        return num_collapses;
+    }
+
+    // Apply the remapping and remove the triangles that collapsed
+    void compact_indices()
+    {
+        size_t count = 0;
+        for (glm::u32vec3 const& tri : m_indices)
+        {
+            glm::u32vec3 remapped(m_remap[tri.x], m_remap[tri.y], m_remap[tri.z]);
+            if (remapped.x != remapped.y && remapped.y != remapped.z && remapped.z != remapped.x)
+                m_indices[count++] = remapped;
+        }
+        m_indices.resize(count);
+    }
+
+    std::span<glm::vec3 const> m_positions;
+    std::vector<glm::u32vec3>  m_indices;
+    std::vector<Quadric>       m_quadrics;
+    std::vector<uint8_t>       m_boundary;
+    std::vector<uint32_t>      m_remap;
+    std::vector<uint8_t>       m_locked;
+    Adjacency                  m_adjacency;
+    float                      m_max_error{0.f};
+};
+
+} // namespace
+
+float simplify_mesh(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, size_t target_triangle_count, std::vector<glm::u32vec3>* simplified)
+{
+    Simplifier simplifier(positions, indices);
+    simplifier.simplify(target_triangle_count);
+
+    *simplified = simplifier.indices();
+
+    return simplifier.max_error();
+}
+
+void simplify_mesh_chain(std::span<glm::vec3 const> positions, std::span<glm::u32vec3 const> indices, std::span<size_t const> target_triangle_counts, std::vector<std::vector<glm::u32vec3>>* levels)
+{
+    levels->clear();
+    levels->reserve(target_triangle_counts.size());
+
+    Simplifier simplifier(positions, indices);
+    for (size_t target_triangle_count : target_triangle_counts)
+    {
+        simplifier.simplify(target_triangle_count);
+        levels->push_back(simplifier.indices());
+    }
+}
+
+} // namespace cgtub
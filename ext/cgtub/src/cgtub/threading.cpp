@@ -0,0 +1,341 @@
+#include "cgtub/threading.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "cgtub/profiler.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+thread_local bool t_is_serial = false;
+
+} // namespace
+
+SerialScope::SerialScope()
+    : m_was_serial(t_is_serial)
+{
+    t_is_serial = true;
+}
+
+SerialScope::~SerialScope()
+{
+    t_is_serial = m_was_serial;
+}
+
+bool is_serial_scope()
+{
+    return t_is_serial;
+}
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter*           counter;
+};
+
+namespace
+{
+
+/**
+ * \brief A work-stealing deque with a fixed capacity (Chase and Lev, "Dynamic Circular Work-Stealing Deque", 2005).
+ *
+ * The owning thread pushes and pops at the bottom, other threads steal at the top.
+ */
+class JobDeque
+{
+public:
+    static constexpr int64_t capacity = 4096; // A power of two
+
+    // Returns false if the deque is full (only called by the owning thread)
+    bool push(Job* job)
+    {
+        int64_t bottom = m_bottom.load();
+        if (bottom - m_top.load() >= capacity)
+            return false;
+
+        m_jobs[bottom & (capacity - 1)].store(job);
+        m_bottom.store(bottom + 1);
+        return true;
+    }
+
+    // Takes the job pushed last (only called by the owning thread)
+    Job* pop()
+    {
+        int64_t bottom = m_bottom.load() - 1;
+        m_bottom.store(bottom);
+        int64_t top = m_top.load();
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1);
+            return nullptr;
+        }
+
+        Job* job = m_jobs[bottom & (capacity - 1)].load();
+        if (top == bottom)
+        {
+            // The last job, which a thief may take at the same time
+            if (!m_top.compare_exchange_strong(top, top + 1))
+                job = nullptr;
+            m_bottom.store(bottom + 1);
+        }
+        return job;
+    }
+
+    // Takes the job pushed first (called by any thread)
+    Job* steal()
+    {
+        int64_t top    = m_top.load();
+        int64_t bottom = m_bottom.load();
+        if (top >= bottom)
+            return nullptr;
+
+        Job* job = m_jobs[top & (capacity - 1)].load();
+        if (!m_top.compare_exchange_strong(top, top + 1))
+            return nullptr;
+        return job;
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(std::max<int64_t>(m_bottom.load() - m_top.load(), 0));
+    }
+
+private:
+    std::atomic<int64_t>                    m_top{0};
+    std::atomic<int64_t>                    m_bottom{0};
+    std::array<std::atomic<Job*>, capacity> m_jobs{};
+};
+
+thread_local JobDeque* t_deque = nullptr;
+
+} // namespace
+
+class JobSystem
+{
+public:
+    static constexpr size_t max_deques = 256;
+
+    // Never destroyed, the workers wait for jobs until the process exits
+    static JobSystem& instance()
+    {
+        static JobSystem* system = new JobSystem;
+        return *system;
+    }
+
+    bool start(size_t thread_count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_thread_count.load() > 0)
+            return false;
+
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        m_thread_count.store(thread_count);
+
+        size_t worker_count = std::max<size_t>(thread_count - 1, 1);
+        for (size_t i = 0; i < worker_count; ++i)
+            std::thread(&JobSystem::run_worker, this, i).detach();
+        return true;
+    }
+
+    // Starts the workers on first use
+    size_t thread_count()
+    {
+        if (m_thread_count.load() == 0)
+            start(0);
+        return m_thread_count.load();
+    }
+
+    void run(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+    {
+        thread_count();
+
+        Job* job = new Job{std::move(function), counter};
+        if (counter != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(counter->m_mutex);
+            counter->m_count.fetch_add(1);
+        }
+
+        if (dependency != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(dependency->m_mutex);
+            if (dependency->m_count.load() > 0)
+            {
+                dependency->m_dependents.push_back(job);
+                return;
+            }
+        }
+
+        schedule(job);
+    }
+
+    void wait(JobCounter const& counter)
+    {
+        while (!counter.is_done())
+        {
+            Job* job = take();
+            if (job != nullptr)
+                finish(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    static size_t queued_count()
+    {
+        return t_deque != nullptr ? t_deque->size() : 0;
+    }
+
+private:
+    JobSystem() = default;
+
+    // The deque of the calling thread (null if the registry is full)
+    JobDeque* deque()
+    {
+        if (t_deque == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_deque_count.load() < max_deques)
+            {
+                m_owned_deques.push_back(std::make_unique<JobDeque>());
+                t_deque = m_owned_deques.back().get();
+                m_deques[m_deque_count.load()].store(t_deque);
+                m_deque_count.fetch_add(1);
+            }
+        }
+        return t_deque;
+    }
+
+    void schedule(Job* job)
+    {
+        JobDeque* deque = this->deque();
+        if (deque == nullptr || !deque->push(job))
+        {
+            // Runs the job right away rather than waiting for space
+            finish(job);
+            return;
+        }
+
+        // Pairs with the check of the queued count in run_worker, so either a sleeping worker is woken or it sees the job
+        m_queued_count.fetch_add(1);
+        if (m_sleeping_count.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake_condition.notify_one();
+        }
+    }
+
+    // Pops a job of the calling thread, or steals one of another thread
+    Job* take()
+    {
+        JobDeque* own = deque();
+        Job*      job = own != nullptr ? own->pop() : nullptr;
+        if (job == nullptr)
+        {
+            // Starts at a different deque on every thread, so thieves do not all contend for the same one
+            size_t count = m_deque_count.load();
+            size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            for (size_t i = 0; i < count && job == nullptr; ++i)
+            {
+                JobDeque* other = m_deques[(start + i) % count].load();
+                if (other != own)
+                    job = other->steal();
+            }
+        }
+
+        if (job != nullptr)
+            m_queued_count.fetch_sub(1);
+        return job;
+    }
+
+    void finish(Job* job)
+    {
+        job->function();
+
+        JobCounter* counter = job->counter;
+        delete job;
+        if (counter == nullptr)
+            return;
+
+        // The count only drops under the lock, so the counter is not destroyed before it is released (see ~JobCounter)
+        std::vector<Job*> dependents;
+        {
+            std::lock_guard<std::mutex> lock(counter->m_mutex);
+            if (counter->m_count.fetch_sub(1) == 1)
+                std::swap(dependents, counter->m_dependents);
+        }
+
+        for (Job* dependent : dependents)
+            schedule(dependent);
+    }
+
+    void run_worker(size_t index)
+    {
+        set_profiler_thread_name(("worker " + std::to_string(index)).c_str());
+
+        while (true)
+        {
+            Job* job = take();
+            if (job != nullptr)
+            {
+                finish(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping_count.fetch_add(1);
+            m_wake_condition.wait(lock, [this] { return m_queued_count.load() > 0; });
+            m_sleeping_count.fetch_sub(1);
+        }
+    }
+
+    std::mutex                                     m_mutex; // Guards starting the workers, registering deques and waking workers
+    std::atomic<size_t>                            m_thread_count{0};
+    std::vector<std::unique_ptr<JobDeque>>         m_owned_deques;
+    std::array<std::atomic<JobDeque*>, max_deques> m_deques{};
+    std::atomic<size_t>                            m_deque_count{0};
+    std::atomic<size_t>                            m_queued_count{0};   // Jobs in all deques
+    std::atomic<size_t>                            m_sleeping_count{0}; // Workers waiting for jobs
+    std::condition_variable                        m_wake_condition;
+};
+
+JobCounter::~JobCounter()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+}
+
+bool start_job_system(size_t thread_count)
+{
+    return JobSystem::instance().start(thread_count);
+}
+
+size_t job_thread_count()
+{
+    return JobSystem::instance().thread_count();
+}
+
+void run_job(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+{
+    JobSystem::instance().run(std::move(function), counter, dependency);
+}
+
+void wait_for_jobs(JobCounter const& counter)
+{
+    JobSystem::instance().wait(counter);
+}
+
+size_t queued_job_count()
+{
+    return JobSystem::queued_count();
+}
+
+} // namespace cgtub
@@ -0,0 +1,165 @@
+#include "cgtub/vertex_cache.hpp"
+
+namespace cgtub
+{
+
+float compute_acmr(std::span<glm::u32vec3 const> indices, size_t vertex_count, unsigned int cache_size)
+{
+    if (indices.empty())
+        return 0.f;
+
+    // A vertex is in the FIFO cache if fewer than `cache_size` misses happened since it was inserted
+    std::vector<uint32_t> insertion_time(vertex_count, 0);
+    uint32_t              misses = 0;
+    for (glm::u32vec3 const& tri : indices)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t& time = insertion_time[tri[k]];
+            if (time == 0 || misses + 1 - time > cache_size)
+                time = ++misses;
+        }
+    }
+
+    return static_cast<float>(misses) / indices.size();
+}
+
+void optimize_vertex_cache(std::span<glm::u32vec3 const> indices, size_t vertex_count, std::vector<glm::u32vec3>* optimized, unsigned int cache_size)
+{
+    optimized->clear();
+    optimized->reserve(indices.size());
+
+    // Vertex-to-triangle adjacency in compressed row storage
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (glm::u32vec3 const& tri : indices)
+        for (int k = 0; k < 3; ++k)
+            ++offsets[tri[k] + 1];
+    for (size_t v = 0; v < vertex_count; ++v)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<uint32_t> adjacency(offsets.back());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t t = 0; t < indices.size(); ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t][k]]++] = t;
+
+    // Number of not yet emitted triangles of each vertex
+    std::vector<uint32_t> live_triangles(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v)
+        live_triangles[v] = offsets[v + 1] - offsets[v];
+
+    std::vector<uint32_t> cache_time(vertex_count, 0); // Time stamp at which a vertex entered the (simulated) cache
+    std::vector<uint8_t>  emitted(indices.size(), 0);
+    std::vector<uint32_t> dead_end_stack;
+    std::vector<uint32_t> candidates;
+
+    uint32_t time   = cache_size + 1;
+    uint32_t cursor = 0;
+
+    // At dead ends, continue with a recently used vertex or, failing that, the next vertex in input order
+    auto skip_dead_end = [&]() -> int64_t
+    {
+        while (!dead_end_stack.empty())
+        {
+            uint32_t v = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_triangles[v] > 0)
+                return v;
+        }
+        for (; cursor < vertex_count; ++cursor)
+        {
+            if (live_triangles[cursor] > 0)
+                return cursor;
+        }
+        return -1;
+    };
+
+    for (int64_t fan = skip_dead_end(); fan >= 0;)
+    {
+        candidates.clear();
+        for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; ++i)
+        {
+            uint32_t t = adjacency[i];
+            if (emitted[t])
+                continue;
+
+            emitted[t] = 1;
+            optimized->push_back(indices[t]);
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[t][k];
+                dead_end_stack.push_back(v);
+                candidates.push_back(v);
+                --live_triangles[v];
+                if (time - cache_time[v] > cache_size)
+                    cache_time[v] = time++;
+            }
+        }
+
+        // Prefer the candidate that entered the cache earliest but will still be cached once its
+        // remaining triangles (at most two new vertices each) are emitted
+        int64_t  next          = -1;
+        uint32_t best_priority = 0;
+        for (uint32_t v : candidates)
+        {
+            if (live_triangles[v] == 0)
+                continue;
+
+            uint32_t priority = 0;
+            if (time - cache_time[v] + 2 * live_triangles[v] <= cache_size)
+                priority = time - cache_time[v];
+
+            if (next < 0 || priority > best_priority)
+            {
+                next          = v;
+                best_priority = priority;
+            }
+        }
+
+        fan = next >= 0 ? next : skip_dead_end();
+    }
+}
+
+size_t optimize_vertex_fetch(std::span<glm::u32vec3> indices, size_t vertex_count, std::vector<uint32_t>* remap)
+{
+    remap->assign(vertex_count, unused_vertex);
+
+    uint32_t new_vertex_count = 0;
+    for (glm::u32vec3& tri : indices)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t& new_index = (*remap)[tri[k]];
+            if (new_index == unused_vertex)
+                new_index = new_vertex_count++;
+            tri[k] = new_index;
+        }
+    }
+
+    return new_vertex_count;
+}
+
+VertexCacheStats optimize_mesh(std::vector<glm::vec3>* positions, std::vector<glm::u32vec3>* indices, std::vector<glm::vec3>* normals, std::vector<glm::vec2>* uvs)
+{
+    VertexCacheStats stats;
+    stats.acmr_before = compute_acmr(*indices, positions->size());
+
+    std::vector<glm::u32vec3> optimized;
+    optimize_vertex_cache(*indices, positions->size(), &optimized);
+    indices->swap(optimized);
+
+    std::vector<uint32_t> remap;
+    size_t                new_vertex_count = optimize_vertex_fetch(*indices, positions->size(), &remap);
+
+    remap_vertices(remap, new_vertex_count, positions);
+    if (normals)
+        remap_vertices(remap, new_vertex_count, normals);
+    if (uvs)
+        remap_vertices(remap, new_vertex_count, uvs);
+
+    stats.acmr_after = compute_acmr(*indices, positions->size());
+
+    return stats;
+}
+
+} // namespace cgtub
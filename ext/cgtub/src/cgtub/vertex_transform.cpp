@@ -0,0 +1,207 @@
+#include "cgtub/vertex_transform.hpp"
+
+#include <array>
+
+#include "cgtub/threading.hpp"
+#include "simd.hpp"
+
+namespace cgtub
+{
+
+namespace
+{
+
+// Below this number of points per job, scheduling the job costs more than it saves
+constexpr size_t min_points_per_job = 1 << 13;
+
+constexpr size_t batch_size = simd::width;
+
+// Sums the products in the order of `glm::mat4 * glm::vec4` (without fused multiply-adds),
+// so the batched and the scalar path (and code that multiplies with glm) agree to the bit
+inline glm::vec4 transform_point(glm::mat4 const& m, float x, float y, float z)
+{
+    return (m[0] * x + m[1] * y) + (m[2] * z + m[3]);
+}
+
+using simd::Float;
+
+#if defined(__AVX512F__)
+
+// Indices for de-interleaving component `c` of 16 vec3s spread over three registers (48 floats)
+// using two two-source permutes: the first picks elements [0, 32), the second elements [32, 48).
+constexpr std::array<int, 16> deinterleave_indices(int c, bool second)
+{
+    std::array<int, 16> indices{};
+    for (int i = 0; i < 16; ++i)
+    {
+        int flat   = 3 * i + c;
+        indices[i] = second ? (flat < 32 ? i : 16 + flat - 32) : (flat < 32 ? flat : 0);
+    }
+    return indices;
+}
+
+inline Float deinterleave(Float r0, Float r1, Float r2, int c)
+{
+    static constexpr std::array<std::array<int, 16>, 3> first  = {deinterleave_indices(0, false), deinterleave_indices(1, false), deinterleave_indices(2, false)};
+    static constexpr std::array<std::array<int, 16>, 3> second = {deinterleave_indices(0, true), deinterleave_indices(1, true), deinterleave_indices(2, true)};
+
+    __m512i first_indices  = _mm512_loadu_si512(first[c].data());
+    __m512i second_indices = _mm512_loadu_si512(second[c].data());
+    return _mm512_permutex2var_ps(_mm512_permutex2var_ps(r0, first_indices, r1), second_indices, r2);
+}
+
+inline void load_points(glm::vec3 const* points, Float* x, Float* y, Float* z)
+{
+    float const* data = &points->x;
+    Float        r0   = _mm512_loadu_ps(data);
+    Float        r1   = _mm512_loadu_ps(data + 16);
+    Float        r2   = _mm512_loadu_ps(data + 32);
+    *x                = deinterleave(r0, r1, r2, 0);
+    *y                = deinterleave(r0, r1, r2, 1);
+    *z                = deinterleave(r0, r1, r2, 2);
+}
+
+// Transposes 4 registers of 16 components each into 16 consecutive vec4s
+inline void store_points(Float x, Float y, Float z, Float w, glm::vec4* out)
+{
+    Float t0 = _mm512_maskz_unpacklo_ps(simd::all_lanes, x, y);
+    Float t1 = _mm512_maskz_unpackhi_ps(simd::all_lanes, x, y);
+    Float t2 = _mm512_maskz_unpacklo_ps(simd::all_lanes, z, w);
+    Float t3 = _mm512_maskz_unpackhi_ps(simd::all_lanes, z, w);
+
+    // Each 128-bit lane now holds one point: u0 = (p0, p4, p8, p12), u1 = (p1, p5, ...), ...
+    Float u0 = _mm512_shuffle_ps(t0, t2, 0x44);
+    Float u1 = _mm512_shuffle_ps(t0, t2, 0xEE);
+    Float u2 = _mm512_shuffle_ps(t1, t3, 0x44);
+    Float u3 = _mm512_shuffle_ps(t1, t3, 0xEE);
+
+    Float a = _mm512_maskz_shuffle_f32x4(simd::all_lanes, u0, u1, 0x44); // p0, p4, p1, p5
+    Float b = _mm512_maskz_shuffle_f32x4(simd::all_lanes, u2, u3, 0x44); // p2, p6, p3, p7
+    Float c = _mm512_maskz_shuffle_f32x4(simd::all_lanes, u0, u1, 0xEE); // p8, p12, p9, p13
+    Float d = _mm512_maskz_shuffle_f32x4(simd::all_lanes, u2, u3, 0xEE); // p10, p14, p11, p15
+
+    float* data = &out->x;
+    _mm512_storeu_ps(data, _mm512_maskz_shuffle_f32x4(simd::all_lanes, a, b, 0x88));
+    _mm512_storeu_ps(data + 16, _mm512_maskz_shuffle_f32x4(simd::all_lanes, a, b, 0xDD));
+    _mm512_storeu_ps(data + 32, _mm512_maskz_shuffle_f32x4(simd::all_lanes, c, d, 0x88));
+    _mm512_storeu_ps(data + 48, _mm512_maskz_shuffle_f32x4(simd::all_lanes, c, d, 0xDD));
+}
+
+#elif defined(__AVX2__)
+
+inline void load_points(glm::vec3 const* points, Float* x, Float* y, Float* z)
+{
+    // r0 = x0 y0 z0 x1 y1 z1 x2 y2
+    // r1 = z2 x3 y3 z3 x4 y4 z4 x5
+    // r2 = y5 z5 x6 y6 z6 x7 y7 z7
+    float const* data = &points->x;
+    Float        r0   = _mm256_loadu_ps(data);
+    Float        r1   = _mm256_loadu_ps(data + 8);
+    Float        r2   = _mm256_loadu_ps(data + 16);
+
+    // Gather each component with two blends, then restore the point order with a lane permute
+    Float tx = _mm256_blend_ps(_mm256_blend_ps(r0, r1, 0b10010010), r2, 0b00100100);
+    Float ty = _mm256_blend_ps(_mm256_blend_ps(r0, r1, 0b00100100), r2, 0b01001001);
+    Float tz = _mm256_blend_ps(_mm256_blend_ps(r0, r1, 0b01001001), r2, 0b10010010);
+
+    *x = _mm256_permutevar8x32_ps(tx, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+    *y = _mm256_permutevar8x32_ps(ty, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+    *z = _mm256_permutevar8x32_ps(tz, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+}
+
+// Transposes 4 registers of 8 components each into 8 consecutive vec4s
+inline void store_points(Float x, Float y, Float z, Float w, glm::vec4* out)
+{
+    Float t0 = _mm256_unpacklo_ps(x, y);
+    Float t1 = _mm256_unpackhi_ps(x, y);
+    Float t2 = _mm256_unpacklo_ps(z, w);
+    Float t3 = _mm256_unpackhi_ps(z, w);
+
+    // Each 128-bit lane now holds one point: u0 = (p0, p4), u1 = (p1, p5), ...
+    Float u0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    Float u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+    Float u2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    Float u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+
+    float* data = &out->x;
+    _mm256_storeu_ps(data, _mm256_permute2f128_ps(u0, u1, 0x20));
+    _mm256_storeu_ps(data + 8, _mm256_permute2f128_ps(u2, u3, 0x20));
+    _mm256_storeu_ps(data + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+    _mm256_storeu_ps(data + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+}
+
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+
+// The 16 matrix elements, each broadcast to all lanes
+struct WideMatrix
+{
+    explicit WideMatrix(glm::mat4 const& m)
+    {
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+                elements[col][row] = simd::broadcast(m[col][row]);
+    }
+
+    Float elements[4][4];
+};
+
+inline void transform_batch(WideMatrix const& m, Float x, Float y, Float z, glm::vec4* out)
+{
+    Float result[4];
+    for (int row = 0; row < 4; ++row)
+        result[row] = simd::add(simd::add(simd::mul(m.elements[0][row], x), simd::mul(m.elements[1][row], y)),
+                                simd::add(simd::mul(m.elements[2][row], z), m.elements[3][row]));
+
+    store_points(result[0], result[1], result[2], result[3], out);
+}
+
+#endif
+
+} // namespace
+
+void transform_points(glm::mat4 const& matrix, std::span<glm::vec3 const> points, std::span<glm::vec4> transformed)
+{
+    parallel_for(points.size(), min_points_per_job, batch_size, [&](size_t begin, size_t end)
+    {
+        size_t i = begin;
+#if defined(__AVX2__) || defined(__AVX512F__)
+        WideMatrix wide_matrix(matrix);
+        for (; i + batch_size <= end; i += batch_size)
+        {
+            Float x, y, z;
+            load_points(&points[i], &x, &y, &z);
+            transform_batch(wide_matrix, x, y, z, &transformed[i]);
+        }
+#endif
+        // Scalar fallback (and remainder)
+        for (; i < end; ++i)
+            transformed[i] = transform_point(matrix, points[i].x, points[i].y, points[i].z);
+    });
+}
+
+void transform_points(glm::mat4 const& matrix, std::span<float const> xs, std::span<float const> ys, std::span<float const> zs, std::span<glm::vec4> transformed)
+{
+    parallel_for(xs.size(), min_points_per_job, batch_size, [&](size_t begin, size_t end)
+    {
+        size_t i = begin;
+#if defined(__AVX2__) || defined(__AVX512F__)
+        WideMatrix wide_matrix(matrix);
+        for (; i + batch_size <= end; i += batch_size)
+        {
+            transform_batch(wide_matrix, simd::load(&xs[i]), simd::load(&ys[i]), simd::load(&zs[i]), &transformed[i]);
+        }
+#endif
+        // Scalar fallback (and remainder)
+        for (; i < end; ++i)
+            transformed[i] = transform_point(matrix, xs[i], ys[i], zs[i]);
+    });
+}
+
+char const* get_transform_simd_name()
+{
+    return simd::name();
+}
+
+} // namespace cgtub
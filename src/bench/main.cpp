@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "rasterizer.hpp"
+
+// Microbenchmarks of the rasterization kernels (`rasterize_mesh` and `rasterize_lines`) on synthetic geometry
+// with known coverage, across resolutions, triangle sizes, depth complexities and rasterizer flags.
+
+namespace
+{
+
+struct Options
+{
+    int         warmup_runs = 2;
+    int         runs        = 10;
+    std::string filter; // Only cases whose name contains it
+    std::string csv_path;
+};
+
+struct Resolution
+{
+    int width;
+    int height;
+};
+
+// The flags passed to the kernels
+struct Flags
+{
+    char const* name;
+    bool        use_random_triangle_colors;
+    bool        use_zbuffer;
+    bool        show_zbuffer;
+    bool        cull_behind_camera;
+    bool        cull_front_faces;
+    bool        collect_stats = false; // Count the rasterizer statistics (to measure what they cost)
+};
+
+constexpr Flags default_flags{"default", false, true, false, false, false};
+
+// NDC geometry that covers the viewport `layers` times, drawn from back to front (or front to back)
+struct TriangleGrid
+{
+    std::vector<glm::vec4>    positions;
+    std::vector<glm::u32vec3> indices;
+    double                    pixels; // Pixels covered by all triangles
+};
+
+struct LineSet
+{
+    std::vector<glm::vec4> points;
+    std::vector<glm::vec3> colors;
+    double                 pixels; // Pixels stepped along all lines
+};
+
+struct Result
+{
+    std::string name;
+    Resolution  resolution;
+    size_t      primitives;
+    double      pixels;
+    double      min_ms;
+    double      median_ms;
+};
+
+// The pixel x in [0, width - 1] in NDC (the inverse of the kernels' viewport transform)
+float to_ndc(float x, int width)
+{
+    return 2.f * x / (width - 1) - 1.f;
+}
+
+/**
+ * \brief Creates layers of triangles that tile the viewport.
+ *
+ * Every cell of \c cell_size x \c cell_size pixels is split into two triangles. Even layers face
+ * away from the camera, odd layers towards it, so culling front faces rejects every other layer.
+ */
+TriangleGrid create_triangle_grid(Resolution const& resolution, float cell_size, int layers, bool front_to_back)
+{
+    float extent_x = static_cast<float>(resolution.width - 1);
+    float extent_y = static_cast<float>(resolution.height - 1);
+    int   cells_x  = std::max(1, static_cast<int>(std::ceil(extent_x / cell_size)));
+    int   cells_y  = std::max(1, static_cast<int>(std::ceil(extent_y / cell_size)));
+
+    TriangleGrid grid;
+    grid.positions.reserve(size_t(layers) * (cells_x + 1) * (cells_y + 1));
+    grid.indices.reserve(size_t(layers) * cells_x * cells_y * 2);
+    grid.pixels = double(resolution.width) * resolution.height * layers;
+
+    for (int layer = 0; layer < layers; ++layer)
+    {
+        // Depths in (-1, 1), farthest first unless drawn front to back
+        float t = (layer + 0.5f) / layers;
+        float z = front_to_back ? -0.9f + 1.8f * t : 0.9f - 1.8f * t;
+
+        uint32_t first_vertex = static_cast<uint32_t>(grid.positions.size());
+        for (int y = 0; y <= cells_y; ++y)
+        {
+            for (int x = 0; x <= cells_x; ++x)
+            {
+                float px = std::min(x * cell_size, extent_x);
+                float py = std::min(y * cell_size, extent_y);
+                grid.positions.emplace_back(to_ndc(px, resolution.width), to_ndc(py, resolution.height), z, 1.f);
+            }
+        }
+
+        for (int y = 0; y < cells_y; ++y)
+        {
+            for (int x = 0; x < cells_x; ++x)
+            {
+                uint32_t v00 = first_vertex + y * (cells_x + 1) + x;
+                uint32_t v10 = v00 + 1;
+                uint32_t v01 = v00 + cells_x + 1;
+                uint32_t v11 = v01 + 1;
+                if (layer % 2 == 0)
+                {
+                    grid.indices.emplace_back(v00, v11, v10);
+                    grid.indices.emplace_back(v00, v01, v11);
+                }
+                else
+                {
+                    grid.indices.emplace_back(v00, v10, v11);
+                    grid.indices.emplace_back(v00, v11, v01);
+                }
+            }
+        }
+    }
+
+    return grid;
+}
+
+// Creates `count` lines of (about) `length` pixels at random positions inside the viewport
+LineSet create_lines(Resolution const& resolution, size_t count, float length)
+{
+    std::default_random_engine            engine(0);
+    std::uniform_real_distribution<float> unit;
+
+    LineSet lines;
+    lines.pixels = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float     angle = glm::two_pi<float>() * unit(engine);
+        glm::vec2 delta = length * glm::vec2(std::cos(angle), std::sin(angle));
+        glm::vec2 p0(unit(engine) * (resolution.width - 1), unit(engine) * (resolution.height - 1));
+        glm::vec2 p1 = glm::clamp(p0 + delta, glm::vec2(0.f), glm::vec2(resolution.width - 1, resolution.height - 1));
+
+        lines.points.emplace_back(to_ndc(p0.x, resolution.width), to_ndc(p0.y, resolution.height), 0.f, 1.f);
+        lines.points.emplace_back(to_ndc(p1.x, resolution.width), to_ndc(p1.y, resolution.height), 0.f, 1.f);
+        lines.colors.emplace_back(unit(engine), unit(engine), unit(engine));
+
+        glm::vec2 steps = glm::abs(glm::round(p1) - glm::round(p0));
+        lines.pixels += std::max(steps.x, steps.y) + 1.0;
+    }
+
+    return lines;
+}
+
+// Runs `kernel` after `prepare` (untimed) for the warmup and the timed runs and returns the run times in milliseconds
+template<typename Prepare, typename Kernel>
+std::vector<double> time_runs(Options const& options, Prepare const& prepare, Kernel const& kernel)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> run_ms;
+    for (int run = 0; run < options.warmup_runs + options.runs; ++run)
+    {
+        prepare();
+        Clock::time_point start = Clock::now();
+        kernel();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (run >= options.warmup_runs)
+            run_ms.push_back(ms);
+    }
+
+    std::sort(run_ms.begin(), run_ms.end());
+    return run_ms;
+}
+
+class Benchmark
+{
+public:
+    explicit Benchmark(Options const& options)
+        : m_options(options)
+    {
+    }
+
+    void run_triangles(std::string const& name, Resolution const& resolution, TriangleGrid const& grid, Flags const& flags)
+    {
+        if (!is_selected(name))
+            return;
+
+        size_t                 pixel_count = size_t(resolution.width) * resolution.height;
+        std::vector<glm::vec3> image(pixel_count);
+        std::vector<float>     zbuffer(pixel_count);
+        VertexCache            vertex_cache;
+        RasterStats            stats;
+
+        std::vector<double> run_ms = time_runs(
+            m_options,
+            [&]
+            {
+                std::fill(image.begin(), image.end(), glm::vec3(0.f));
+                std::fill(zbuffer.begin(), zbuffer.end(), 1.f);
+            },
+            [&]
+            {
+                rasterize_mesh(grid.positions, grid.indices, glm::vec3(1.f), flags.use_random_triangle_colors, resolution.width, resolution.height, &image, zbuffer,
+                               flags.use_zbuffer, flags.show_zbuffer, flags.cull_behind_camera, flags.cull_front_faces, &vertex_cache, 0,
+                               flags.collect_stats ? &stats : nullptr);
+            });
+
+        report(name, resolution, grid.indices.size(), grid.pixels, run_ms);
+    }
+
+    void run_lines(std::string const& name, Resolution const& resolution, LineSet const& lines)
+    {
+        if (!is_selected(name))
+            return;
+
+        size_t                 pixel_count = size_t(resolution.width) * resolution.height;
+        std::vector<glm::vec3> image(pixel_count);
+        std::vector<float>     zbuffer(pixel_count);
+
+        std::vector<double> run_ms = time_runs(
+            m_options,
+            [&]
+            {
+                std::fill(image.begin(), image.end(), glm::vec3(0.f));
+                std::fill(zbuffer.begin(), zbuffer.end(), 1.f);
+            },
+            [&]
+            {
+                rasterize_lines(lines.points, lines.colors, resolution.width, resolution.height, &image, zbuffer, true, false);
+            });
+
+        report(name, resolution, lines.colors.size(), lines.pixels, run_ms);
+    }
+
+    std::vector<Result> const& results() const
+    {
+        return m_results;
+    }
+
+private:
+    bool is_selected(std::string const& name) const
+    {
+        return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+    }
+
+    void report(std::string const& name, Resolution const& resolution, size_t primitives, double pixels, std::vector<double> const& run_ms)
+    {
+        Result result{name, resolution, primitives, pixels, run_ms.front(), run_ms[run_ms.size() / 2]};
+        m_results.push_back(result);
+
+        double ns = 1e6 * result.median_ms;
+        std::printf("%-36s %5dx%-5d %10zu %12.0f %10.3f %10.3f %10.3f %10.2f %10.2f\n", name.c_str(), resolution.width, resolution.height, primitives, pixels,
+                    result.min_ms, result.median_ms, ns / pixels, ns / primitives, primitives / (1e3 * result.median_ms));
+        std::fflush(stdout);
+    }
+
+    Options const&      m_options;
+    std::vector<Result> m_results;
+};
+
+bool write_csv(std::string const& path, std::vector<Result> const& results)
+{
+    std::ofstream file(path);
+    file << "name,width,height,primitives,pixels,min_ms,median_ms,ns_per_pixel,ns_per_primitive,mprimitives_per_s\n";
+    for (Result const& result : results)
+    {
+        double ns = 1e6 * result.median_ms;
+        file << result.name << ',' << result.resolution.width << ',' << result.resolution.height << ',' << result.primitives << ',' << result.pixels << ','
+             << result.min_ms << ',' << result.median_ms << ',' << ns / result.pixels << ',' << ns / result.primitives << ','
+             << result.primitives / (1e3 * result.median_ms) << '\n';
+    }
+
+    if (!file)
+    {
+        std::fprintf(stderr, "Failed to write '%s'\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void print_usage(char const* executable)
+{
+    std::printf("Usage: %s [options]\n"
+                "  --warmup <count>  Untimed runs before the timed ones (default 2)\n"
+                "  --runs <count>    Timed runs per case, the median is reported (default 10)\n"
+                "  --filter <text>   Only run the cases whose name contains <text>\n"
+                "  --csv <path>      Also write the results as CSV (e.g. as a baseline for later comparisons)\n",
+                executable);
+}
+
+bool parse_options(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        char const* arg = argv[i];
+        if (i + 1 >= argc || std::strncmp(arg, "--", 2) != 0)
+            return false;
+        else if (std::strcmp(arg, "--warmup") == 0)
+            options->warmup_runs = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--runs") == 0)
+            options->runs = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--filter") == 0)
+            options->filter = argv[++i];
+        else if (std::strcmp(arg, "--csv") == 0)
+            options->csv_path = argv[++i];
+        else
+            return false;
+    }
+
+    return options->warmup_runs >= 0 && options->runs > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Benchmark benchmark(options);
+    std::printf("%-36s %11s %10s %12s %10s %10s %10s %10s %10s\n", "case", "resolution", "prims", "pixels", "min ms", "median ms", "ns/pixel", "ns/prim", "Mprim/s");
+
+    Resolution const resolutions[] = {{320, 240}, {640, 480}, {1920, 1080}};
+    Resolution const reference     = resolutions[1];
+
+    // Triangle sizes: about 2 pixels (tiny), 512 pixels (medium) and two triangles covering the viewport (full-screen)
+    struct TriangleSize
+    {
+        char const* name;
+        float       cell_size;
+    };
+    TriangleSize const sizes[] = {{"tiny", 2.f}, {"medium", 32.f}, {"fullscreen", 1e9f}};
+
+    for (TriangleSize const& size : sizes)
+        for (Resolution const& resolution : resolutions)
+            benchmark.run_triangles(std::string("triangles/size/") + size.name, resolution, create_triangle_grid(resolution, size.cell_size, 1, false), default_flags);
+
+    // Depth complexity: back to front every layer passes the depth test, front to back only the first one
+    for (int layers : {1, 4, 16})
+    {
+        for (bool front_to_back : {false, true})
+        {
+            std::string name = "triangles/depth/" + std::to_string(layers) + (front_to_back ? "/front_to_back" : "/back_to_front");
+            benchmark.run_triangles(name, reference, create_triangle_grid(reference, 32.f, layers, front_to_back), default_flags);
+        }
+    }
+
+    // Flags, on four layers of medium triangles
+    Flags const flag_combinations[] = {
+        default_flags,
+        {"no_zbuffer", false, false, false, false, false},
+        {"random_colors", true, true, false, false, false},
+        {"show_zbuffer", false, true, true, false, false},
+        {"cull_behind_camera", false, true, false, true, false},
+        {"cull_front_faces", false, true, false, false, true},
+        {"collect_stats", false, true, false, false, false, true},
+    };
+    TriangleGrid flags_grid = create_triangle_grid(reference, 32.f, 4, false);
+    for (Flags const& flags : flag_combinations)
+        benchmark.run_triangles(std::string("triangles/flags/") + flags.name, reference, flags_grid, flags);
+
+    // Lines: many short ones and fewer that cross the viewport
+    for (Resolution const& resolution : resolutions)
+    {
+        benchmark.run_lines("lines/short", resolution, create_lines(resolution, 20000, 16.f));
+        benchmark.run_lines("lines/long", resolution, create_lines(resolution, 1000, static_cast<float>(std::max(resolution.width, resolution.height))));
+    }
+
+    if (!options.csv_path.empty() && !write_csv(options.csv_path, benchmark.results()))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "async_image_writer.hpp"
+
+#include <algorithm>
+
+#include <cgtub/image.hpp>
+#include <cgtub/profiler.hpp>
+
+AsyncImageWriter::AsyncImageWriter(int num_threads, size_t max_queued_images)
+    : m_max_queued_jobs(std::max<size_t>(max_queued_images, 1))
+{
+    for (int i = 0; i < std::max(num_threads, 1); ++i)
+        m_threads.emplace_back(&AsyncImageWriter::run, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_job_available.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void AsyncImageWriter::write(std::filesystem::path path, std::vector<glm::vec3> pixels, int width, int height)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_job_taken.wait(lock, [&] { return m_jobs.size() < m_max_queued_jobs; });
+        m_jobs.push_back(Job{std::move(path), std::move(pixels), width, height});
+    }
+    m_job_available.notify_one();
+}
+
+bool AsyncImageWriter::finish()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&] { return m_jobs.empty() && m_active_jobs == 0; });
+    return m_success;
+}
+
+void AsyncImageWriter::run()
+{
+    cgtub::set_profiler_thread_name("writer");
+
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_available.wait(lock, [&] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return; // Stopped, with nothing left to write
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_active_jobs;
+        }
+        m_job_taken.notify_one();
+
+        bool success;
+        {
+            CGTUB_PROFILE_ZONE("write");
+            success = cgtub::write_image(job.path, job.pixels, job.width, job.height);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_success = m_success && success;
+            --m_active_jobs;
+        }
+        m_idle.notify_all();
+    }
+}
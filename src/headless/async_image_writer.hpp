@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Writes images on background threads (see `cgtub::write_image`), so rendering does not wait for encoding and disk I/O
+class AsyncImageWriter
+{
+public:
+    /**
+     * \brief Starts the writer threads.
+     *
+     * \param[in] num_threads       The number of writer threads.
+     * \param[in] max_queued_images The number of images that may wait to be written. Once the queue is full,
+     *                              \c write blocks, so the memory use stays bounded if the disk falls behind.
+     */
+    AsyncImageWriter(int num_threads, size_t max_queued_images);
+
+    // Writes the remaining images and stops the writer threads
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(AsyncImageWriter const&)            = delete;
+    AsyncImageWriter& operator=(AsyncImageWriter const&) = delete;
+
+    // Queues an image for writing (rows from bottom to top, as rasterized)
+    void write(std::filesystem::path path, std::vector<glm::vec3> pixels, int width, int height);
+
+    /**
+     * \brief Waits until all queued images are written.
+     *
+     * \return False if any image could not be written.
+     */
+    bool finish();
+
+private:
+    struct Job
+    {
+        std::filesystem::path  path;
+        std::vector<glm::vec3> pixels;
+        int                    width;
+        int                    height;
+    };
+
+    void run();
+
+    std::vector<std::thread> m_threads;
+    std::mutex               m_mutex;
+    std::condition_variable  m_job_available;
+    std::condition_variable  m_job_taken;
+    std::condition_variable  m_idle;
+    std::deque<Job>          m_jobs;
+    size_t                   m_max_queued_jobs;
+    size_t                   m_active_jobs{0};
+    bool                     m_stop{false};
+    bool                     m_success{true};
+};
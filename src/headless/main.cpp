@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cgtub/camera.hpp>
+#include <cgtub/camera_perspective.hpp>
+#include <cgtub/frame_times.hpp>
+#include <cgtub/image.hpp>
+#include <cgtub/profiler.hpp>
+#include <cgtub/threading.hpp>
+
+#include "async_image_writer.hpp"
+#include "scene.hpp"
+
+// Renders the scene of the interactive executable without a window or an OpenGL context
+// and writes the images to files (PNG, PPM or PFM). A batch of camera poses (read from a file
+// or placed on a turntable) is rendered in parallel on the job system, one frame per thread at a time.
+
+namespace
+{
+
+struct Options
+{
+    int                   width                = 640;
+    int                   height               = 480;
+    float                 azimuth              = 0.f; // Camera pose as set by the turntable camera controller
+    float                 elevation            = 0.3f;
+    float                 distance             = 2.f;
+    float                 fov_y                = 45.f;
+    float                 z_near               = 1.f;
+    float                 z_far                = 4.5f;
+    int                   num_sphere_instances = 1;
+    int                   frames               = 1; // Every view is rendered repeatedly for stable timings
+    int                   turntable_views      = 0; // Views at equally spaced azimuths (0 for a single view)
+    std::filesystem::path views_path;               // View matrices, one per line
+    int                   threads              = 0; // Threads of the job system (0 for one per core)
+    int                   writer_threads       = 1;
+    std::filesystem::path output               = "render.png";
+    std::filesystem::path trace;                    // Chrome trace of the profiler zones (empty for none)
+    std::filesystem::path frame_times;              // Frame times, one JSON object per line (empty for none)
+    bool                  counters             = false; // Report hardware counters per frame and stage
+    std::filesystem::path mesh_path;
+    RenderSettings        settings;
+};
+
+void print_usage(char const* executable)
+{
+    std::printf("Usage: %s [options] [mesh file (OBJ, glTF or PLY)]\n"
+                "  --width <pixels>         Image width (default 640)\n"
+                "  --height <pixels>        Image height (default 480)\n"
+                "  --azimuth <radians>      Camera rotation around the y-axis (default 0)\n"
+                "  --elevation <radians>    Camera angle above the xz-plane (default 0.3)\n"
+                "  --distance <units>       Camera distance to the origin (default 2)\n"
+                "  --fov <degrees>          Vertical field of view (default 45)\n"
+                "  --near <units>           Near plane distance (default 1)\n"
+                "  --far <units>            Far plane distance (default 4.5)\n"
+                "  --spheres <count>        Number of sphere instances (default 1)\n"
+                "  --frames <count>         Number of times each view is rendered (default 1)\n"
+                "  --turntable <count>      Render <count> views around the y-axis, starting at the azimuth\n"
+                "  --views <path>           Render the view matrices in a text file, one per line\n"
+                "                           (16 numbers in column-major order, lines starting with # are skipped)\n"
+                "  --threads <count>        Number of threads rendering and loading in parallel (default: one per core)\n"
+                "  --writers <count>        Number of threads writing images (default 1)\n"
+                "  --output <path>          Output image, .png, .ppm or .pfm (default render.png). For several views,\n"
+                "                           a run of # is replaced by the zero-padded view index (e.g. frame_####.png)\n"
+                "  --trace <path>           Write the profiler zones of all frames as a Chrome trace (JSON)\n"
+                "  --frame-times <path>     Stream the time of every frame to a file, one JSON object per line\n"
+                "  --counters               Report hardware counters (IPC, cache misses and branch mispredicts per pixel)\n"
+                "                           of every frame and stage (Linux only)\n"
+                "  --random-colors          Use random triangle colors\n"
+                "  --no-zbuffer             Disable the z-buffer\n"
+                "  --show-zbuffer           Output the z-buffer instead of the colors\n"
+                "  --show-overdraw          Output the number of triangles that covered each pixel instead of the colors\n"
+                "  --stats                  Report the rasterizer statistics of every frame\n"
+                "  --cull-behind-camera     Cull primitives behind the camera\n"
+                "  --cull-front-faces       Cull front faces\n"
+                "  --sort-last              Rasterize parts of the draws in parallel and merge them by depth\n",
+                executable);
+}
+
+bool parse_options(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        char const* arg       = argv[i];
+        auto        has_value = [&]
+        {
+            if (i + 1 < argc)
+                return true;
+            std::fprintf(stderr, "Missing value for '%s'\n", arg);
+            return false;
+        };
+
+        if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+            return false;
+        else if (std::strcmp(arg, "--random-colors") == 0)
+            options->settings.use_random_triangle_colors = true;
+        else if (std::strcmp(arg, "--no-zbuffer") == 0)
+            options->settings.use_zbuffer = false;
+        else if (std::strcmp(arg, "--show-zbuffer") == 0)
+            options->settings.show_zbuffer = true;
+        else if (std::strcmp(arg, "--show-overdraw") == 0)
+            options->settings.show_overdraw = true;
+        else if (std::strcmp(arg, "--stats") == 0)
+            options->settings.collect_stats = true;
+        else if (std::strcmp(arg, "--cull-behind-camera") == 0)
+            options->settings.cull_behind_camera = true;
+        else if (std::strcmp(arg, "--cull-front-faces") == 0)
+            options->settings.cull_front_faces = true;
+        else if (std::strcmp(arg, "--sort-last") == 0)
+            options->settings.sort_last = true;
+        else if (std::strcmp(arg, "--counters") == 0)
+            options->counters = true;
+        else if (std::strncmp(arg, "--", 2) != 0)
+            options->mesh_path = arg;
+        else if (!has_value())
+            return false;
+        else if (std::strcmp(arg, "--width") == 0)
+            options->width = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--height") == 0)
+            options->height = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--azimuth") == 0)
+            options->azimuth = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--elevation") == 0)
+            options->elevation = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--distance") == 0)
+            options->distance = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--fov") == 0)
+            options->fov_y = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--near") == 0)
+            options->z_near = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--far") == 0)
+            options->z_far = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--spheres") == 0)
+            options->num_sphere_instances = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--frames") == 0)
+            options->frames = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--turntable") == 0)
+            options->turntable_views = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--views") == 0)
+            options->views_path = argv[++i];
+        else if (std::strcmp(arg, "--threads") == 0)
+            options->threads = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--writers") == 0)
+            options->writer_threads = std::atoi(argv[++i]);
+        else if (std::strcmp(arg, "--output") == 0)
+            options->output = argv[++i];
+        else if (std::strcmp(arg, "--trace") == 0)
+            options->trace = argv[++i];
+        else if (std::strcmp(arg, "--frame-times") == 0)
+            options->frame_times = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "Unknown option '%s'\n", arg);
+            return false;
+        }
+    }
+
+    if (options->width <= 0 || options->height <= 0 || options->frames <= 0 || options->num_sphere_instances < 0 ||
+        options->turntable_views < 0 || options->threads < 0 || options->writer_threads <= 0)
+    {
+        std::fprintf(stderr, "Image size, frame, view, thread and sphere counts must be positive\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Reads one view matrix (16 numbers in column-major order) per line, skipping empty lines and lines starting with #
+bool load_view_matrices(std::filesystem::path const& path, std::vector<glm::mat4>* view_matrices)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::fprintf(stderr, "Failed to open '%s'\n", path.string().c_str());
+        return false;
+    }
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream stream(line);
+        glm::mat4          view_matrix;
+        for (int i = 0; i < 16; ++i)
+            stream >> view_matrix[i / 4][i % 4];
+
+        if (!stream)
+        {
+            std::fprintf(stderr, "%s:%d: Expected 16 numbers\n", path.string().c_str(), line_number);
+            return false;
+        }
+        view_matrices->push_back(view_matrix);
+    }
+
+    return true;
+}
+
+// Replaces the last run of # in the file name by the zero-padded view index (or appends the index if there is none)
+std::filesystem::path get_output_path(std::filesystem::path const& output, size_t view, size_t num_views)
+{
+    if (num_views == 1)
+        return output;
+
+    std::string name  = output.stem().string();
+    size_t      last  = name.find_last_of('#');
+    std::string index = std::to_string(view);
+    if (last == std::string::npos)
+        name += "_" + index;
+    else
+    {
+        size_t first = name.find_last_not_of('#', last);
+        first        = first == std::string::npos ? 0 : first + 1;
+        size_t width = last - first + 1;
+        if (index.size() < width)
+            index.insert(0, width - index.size(), '0');
+        name.replace(first, width, index);
+    }
+
+    return output.parent_path() / (name + output.extension().string());
+}
+
+std::string format_raster_stats(RasterStats const& stats)
+{
+    char text[320];
+    std::snprintf(text, sizeof(text),
+                  "%llu triangles (culled: %llu behind camera, %llu front faces, %llu degenerate, %llu outside), "
+                  "%llu pixels tested, %llu covered, %llu depth passed, %llu written",
+                  static_cast<unsigned long long>(stats.triangles_submitted), static_cast<unsigned long long>(stats.culled_behind_camera),
+                  static_cast<unsigned long long>(stats.culled_front_faces), static_cast<unsigned long long>(stats.culled_degenerate),
+                  static_cast<unsigned long long>(stats.culled_frustum), static_cast<unsigned long long>(stats.pixels_tested),
+                  static_cast<unsigned long long>(stats.pixels_covered), static_cast<unsigned long long>(stats.pixels_depth_passed),
+                  static_cast<unsigned long long>(stats.pixels_written));
+    return text;
+}
+
+// Instructions per cycle and the misses per pixel, of counters over the given number of pixels
+std::string format_counters(cgtub::PerfCounters const& counters, size_t pixels)
+{
+    char text[160];
+    std::snprintf(text, sizeof(text), "IPC %.2f, per pixel: %.3f L1D misses, %.3f LLC misses, %.3f branch mispredicts",
+                  counters.cycles > 0 ? static_cast<double>(counters.instructions) / counters.cycles : 0.0,
+                  static_cast<double>(counters.l1d_misses) / pixels, static_cast<double>(counters.llc_misses) / pixels,
+                  static_cast<double>(counters.branch_misses) / pixels);
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    if (options.counters && !cgtub::enable_profile_counters(true))
+    {
+        std::fprintf(stderr, "Hardware counters are not available, frames are only timed\n");
+        options.counters = false;
+    }
+
+    // Loading, rendering and post-processing all share these threads
+    cgtub::start_job_system(static_cast<size_t>(options.threads));
+    cgtub::set_profiler_thread_name("main");
+
+    cgtub::FrameTimeStream frame_time_stream;
+    if (!options.frame_times.empty() && !frame_time_stream.open(options.frame_times))
+        return EXIT_FAILURE;
+
+    // Prepare the geometry once, as the interactive executable does
+    Clock::time_point setup_start = Clock::now();
+
+    Scene scene;
+    create_scene(options.num_sphere_instances, &scene);
+    if (!options.mesh_path.empty() && !load_instanced_meshes(options.mesh_path, &scene.loaded_file, &scene.loaded_meshes))
+    {
+        std::fprintf(stderr, "Failed to load '%s'\n", options.mesh_path.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Offline frames wait for all their pages instead of filling in over later frames
+    scene.loaded_file.paged_mesh.set_load_budget(std::numeric_limits<size_t>::max());
+
+    std::vector<glm::mat4> view_matrices;
+    if (!options.views_path.empty())
+    {
+        if (!load_view_matrices(options.views_path, &view_matrices))
+            return EXIT_FAILURE;
+    }
+    else if (options.turntable_views > 0)
+    {
+        for (int view = 0; view < options.turntable_views; ++view)
+        {
+            float azimuth = options.azimuth + glm::two_pi<float>() * view / options.turntable_views;
+            view_matrices.push_back(cgtub::build_turntable_view_matrix(azimuth, options.elevation, options.distance));
+        }
+    }
+    else
+        view_matrices.push_back(cgtub::build_turntable_view_matrix(options.azimuth, options.elevation, options.distance));
+
+    if (view_matrices.empty())
+    {
+        std::fprintf(stderr, "No views to render\n");
+        return EXIT_FAILURE;
+    }
+
+    cgtub::PerspectiveCamera camera(options.fov_y, static_cast<float>(options.width) / options.height, options.z_near, options.z_far);
+    glm::mat4                projection_matrix = camera.projection();
+
+    double setup_ms = std::chrono::duration<double, std::milli>(Clock::now() - setup_start).count();
+    std::printf("setup: %.3f ms\n", setup_ms);
+
+    // Every view is a job, which renders into a framebuffer no other job uses at the time and hands a copy of the image to the writer
+    size_t num_views   = view_matrices.size();
+    int    num_threads = static_cast<int>(std::min(cgtub::job_thread_count(), num_views));
+
+    std::vector<double>                       frame_ms(num_views * options.frames);
+    size_t                                    pixels = static_cast<size_t>(options.width) * options.height;
+    std::vector<std::unique_ptr<Framebuffer>> free_framebuffers;
+    std::mutex                                framebuffer_mutex; // Guards the free framebuffers
+    AsyncImageWriter                          writer(options.writer_threads, 2 * num_threads);
+    auto                                      render_view = [&](size_t view)
+    {
+        std::unique_ptr<Framebuffer> framebuffer;
+        {
+            std::lock_guard<std::mutex> lock(framebuffer_mutex);
+            if (!free_framebuffers.empty())
+            {
+                framebuffer = std::move(free_framebuffers.back());
+                free_framebuffers.pop_back();
+            }
+        }
+        if (!framebuffer)
+        {
+            framebuffer = std::make_unique<Framebuffer>();
+            resize_framebuffer(options.width, options.height, framebuffer.get());
+        }
+
+        // Select the levels of detail without hysteresis, so the image does not depend on the view the framebuffer was used for before
+        framebuffer->lod_levels.clear();
+
+        for (int frame = 0; frame < options.frames; ++frame)
+        {
+            cgtub::PerfCounters frame_counters = cgtub::read_profile_counters();
+            Clock::time_point   frame_start    = Clock::now();
+            {
+                CGTUB_PROFILE_ZONE("frame");
+                render_scene(scene, view_matrices[view], projection_matrix, options.settings, framebuffer.get());
+            }
+            double ms      = std::chrono::duration<double, std::milli>(Clock::now() - frame_start).count();
+            frame_counters = cgtub::read_profile_counters() - frame_counters;
+
+            frame_ms[view * options.frames + frame] = ms;
+            if (frame_time_stream.is_open())
+                frame_time_stream.write(view * options.frames + frame, ms);
+            if (options.counters)
+                std::printf("view %zu, frame %d: %.3f ms, %s\n", view, frame, ms, format_counters(frame_counters, pixels).c_str());
+            else
+                std::printf("view %zu, frame %d: %.3f ms\n", view, frame, ms);
+            if (options.settings.collect_stats)
+                std::printf("view %zu, frame %d: %s\n", view, frame, format_raster_stats(framebuffer->stats).c_str());
+        }
+
+        writer.write(get_output_path(options.output, view, num_views), framebuffer->image, framebuffer->width, framebuffer->height);
+
+        std::lock_guard<std::mutex> lock(framebuffer_mutex);
+        free_framebuffers.push_back(std::move(framebuffer));
+    };
+
+    Clock::time_point render_start   = Clock::now();
+    uint64_t          profiler_start = cgtub::profiler_now();
+    cgtub::parallel_for(num_views, 1, 1, [&](size_t begin, size_t end)
+    {
+        // The views already run in parallel, so a frame does not split its stages into further jobs (which would
+        // let a thread waiting for them start another view in the middle of its frame and distort the frame times)
+        std::optional<cgtub::SerialScope> serial_scope;
+        if (num_threads > 1)
+            serial_scope.emplace();
+
+        for (size_t view = begin; view < end; ++view)
+            render_view(view);
+    });
+    double render_ms = std::chrono::duration<double, std::milli>(Clock::now() - render_start).count();
+
+    bool   success  = writer.finish();
+    double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - render_start).count();
+
+    double min_ms = *std::min_element(frame_ms.begin(), frame_ms.end());
+    double max_ms = *std::max_element(frame_ms.begin(), frame_ms.end());
+    double sum_ms = 0.0;
+    for (double ms : frame_ms)
+        sum_ms += ms;
+    std::printf("frames: %zu, min %.3f ms, avg %.3f ms, max %.3f ms\n", frame_ms.size(), min_ms, sum_ms / frame_ms.size(), max_ms);
+
+    // The frames of all threads, in the order of the views
+    cgtub::FrameTimeHistory history(frame_ms.size());
+    for (double ms : frame_ms)
+        history.add(ms);
+    cgtub::FrameTimeSummary summary = history.summarize(frame_ms.size());
+    std::printf("frames: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n", summary.p50, summary.p95, summary.p99);
+    std::printf("views: %zu on %d threads, rendered in %.3f ms (%.1f views/s), written after %.3f ms\n",
+                num_views, num_threads, render_ms, 1000.0 * num_views / render_ms, total_ms);
+
+#if CGTUB_PROFILER
+    // Time per stage and frame, without the time of the stages nested in it ("frame" is the time outside all stages)
+    std::vector<cgtub::ProfileEvent> profile_events;
+    std::vector<cgtub::ProfileStage> stages;
+    cgtub::collect_profile_events(profiler_start, &profile_events);
+    cgtub::summarize_profile_events(profile_events, &stages);
+    for (cgtub::ProfileStage const& stage : stages)
+    {
+        if (options.counters)
+            std::printf("stage %-12s %.3f ms/frame, %s\n", stage.name, stage.milliseconds / frame_ms.size(),
+                        format_counters(stage.counters, pixels * frame_ms.size()).c_str());
+        else
+            std::printf("stage %-12s %.3f ms/frame\n", stage.name, stage.milliseconds / frame_ms.size());
+    }
+
+    if (!options.trace.empty())
+    {
+        success = cgtub::write_chrome_trace(options.trace, profile_events) && success;
+        std::printf("wrote %s (%zu events)\n", options.trace.string().c_str(), profile_events.size());
+    }
+#else
+    if (!options.trace.empty())
+        std::fprintf(stderr, "Built without CGTUB_PROFILER, no trace is written\n");
+#endif
+
+    if (!success)
+        return EXIT_FAILURE;
+    if (num_views == 1)
+        std::printf("wrote %s (%dx%d)\n", options.output.string().c_str(), options.width, options.height);
+
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,11 @@
 #include "helper.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cfloat>
 #include <complex>
-#include <random>
+#include <cstring>
+#include <vector>
 
 #include <glm/gtc/constants.hpp>
 
@@ -10,7 +14,7 @@
 namespace ex3
 {
 
-GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* use_z_buffer, bool* show_z_buffer, bool* cull_behind_camera, bool* cull_front_faces)
+GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* use_z_buffer, bool* show_z_buffer, bool* show_overdraw, bool* cull_behind_camera, bool* cull_front_faces, bool* sort_last, int* num_sphere_instances, bool* use_lru_vertex_cache, bool* collect_raster_stats, cgtub::VertexCacheCounters const& vertex_cache_counters, RasterStats const& raster_stats)
 {
     GuiChanges changes{0};
 
@@ -25,10 +29,45 @@ GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* us
         changes |= 0b000100;
     if (ImGui::Checkbox("Show z-Buffer", show_z_buffer))
         changes |= 0b001000;
-    if (ImGui::Checkbox("Cull Behind Camera", cull_behind_camera))
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Show Overdraw", show_overdraw))
         changes |= 0b010000;
-    if (ImGui::Checkbox("Cull Front Faces", cull_front_faces))
+    if (ImGui::Checkbox("Cull Behind Camera", cull_behind_camera))
         changes |= 0b100000;
+    if (ImGui::Checkbox("Cull Front Faces", cull_front_faces))
+        changes |= 0b1000000;
+    if (ImGui::SliderInt("Sphere Instances", num_sphere_instances, 1, 4096))
+        changes |= 0b10000000;
+    if (ImGui::Checkbox("LRU Vertex Cache", use_lru_vertex_cache))
+        changes |= 0b100000000;
+    if (ImGui::Checkbox("Sort-Last Raster", sort_last))
+        changes |= 0b10000000000;
+
+    uint64_t vertex_cache_accesses = vertex_cache_counters.hits + vertex_cache_counters.misses;
+    ImGui::Text("Vertex cache: %llu hits, %llu misses (%.1f%% hit rate)",
+                static_cast<unsigned long long>(vertex_cache_counters.hits),
+                static_cast<unsigned long long>(vertex_cache_counters.misses),
+                vertex_cache_accesses > 0 ? 100.0 * vertex_cache_counters.hits / vertex_cache_accesses : 0.0);
+
+    if (ImGui::Checkbox("Rasterizer Statistics", collect_raster_stats))
+        changes |= 0b1000000000;
+    if (*collect_raster_stats)
+    {
+        auto percent = [](uint64_t part, uint64_t whole) { return whole > 0 ? 100.0 * part / whole : 0.0; };
+        ImGui::Text("Triangles: %llu submitted, culled %llu behind camera, %llu front faces, %llu degenerate, %llu outside",
+                    static_cast<unsigned long long>(raster_stats.triangles_submitted),
+                    static_cast<unsigned long long>(raster_stats.culled_behind_camera),
+                    static_cast<unsigned long long>(raster_stats.culled_front_faces),
+                    static_cast<unsigned long long>(raster_stats.culled_degenerate),
+                    static_cast<unsigned long long>(raster_stats.culled_frustum));
+        ImGui::Text("Pixels: %llu tested, %llu covered (%.1f%%), %llu depth passed (%.1f%%), %llu written",
+                    static_cast<unsigned long long>(raster_stats.pixels_tested),
+                    static_cast<unsigned long long>(raster_stats.pixels_covered),
+                    percent(raster_stats.pixels_covered, raster_stats.pixels_tested),
+                    static_cast<unsigned long long>(raster_stats.pixels_depth_passed),
+                    percent(raster_stats.pixels_depth_passed, raster_stats.pixels_covered),
+                    static_cast<unsigned long long>(raster_stats.pixels_written));
+    }
 
     ImGuiIO& io = ImGui::GetIO();
     // TODO: Report FPS with 2 decimal precision
@@ -38,33 +77,158 @@ GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* us
     return changes;
 }
 
-bool has_gui_changed_parameter(GuiChanges gui_changes, uint32_t parameter_index)
+namespace
 {
-    if (parameter_index >= 32)
-        return false;
 
-    return static_cast<bool>(gui_changes & (1 << parameter_index));
-}
-
-glm::vec3 get_random_color(size_t triangle_index)
+// A profiler stage averaged over the last frames
+struct SmoothedStage
+{
+    char const* name;
+    double      milliseconds;
+    double      cycles;
+    double      instructions;
+    double      l1d_misses;
+    double      llc_misses;
+    double      branch_misses;
+};
+
+} // namespace
+
+GuiChanges profiler_gui(std::span<cgtub::ProfileStage const> frame_stages, int pixels, bool* record_trace, bool* use_counters)
 {
-    static std::default_random_engine            engine(0);
-    static std::uniform_real_distribution<float> distribution;
-    static std::vector<glm::vec3>                random_colors;
-    // Well, "unique" if the number of triangles is below 1024 :)
-    constexpr int                                num_random_colors = 1024;
-
-    // Fill the color array on the first call
-    if (random_colors.empty())
+    GuiChanges changes{0};
+
+    // Smoothed over the last frames, so the values can be read
+    constexpr double smoothing = 0.05;
+
+    static std::vector<SmoothedStage> stages;
+    for (cgtub::ProfileStage const& frame_stage : frame_stages)
     {
-        random_colors.resize(num_random_colors);
-        for (size_t i = 0; i < random_colors.size(); ++i)
+        cgtub::PerfCounters const& counters = frame_stage.counters;
+        SmoothedStage              sample   = {frame_stage.name,
+                                               frame_stage.milliseconds,
+                                               static_cast<double>(counters.cycles),
+                                               static_cast<double>(counters.instructions),
+                                               static_cast<double>(counters.l1d_misses),
+                                               static_cast<double>(counters.llc_misses),
+                                               static_cast<double>(counters.branch_misses)};
+
+        auto stage = std::find_if(stages.begin(), stages.end(), [&](SmoothedStage const& stage)
+        {
+            return std::strcmp(stage.name, frame_stage.name) == 0;
+        });
+        if (stage == stages.end())
+        {
+            stages.push_back(sample);
+            continue;
+        }
+
+        stage->milliseconds += smoothing * (sample.milliseconds - stage->milliseconds);
+        stage->cycles += smoothing * (sample.cycles - stage->cycles);
+        stage->instructions += smoothing * (sample.instructions - stage->instructions);
+        stage->l1d_misses += smoothing * (sample.l1d_misses - stage->l1d_misses);
+        stage->llc_misses += smoothing * (sample.llc_misses - stage->llc_misses);
+        stage->branch_misses += smoothing * (sample.branch_misses - stage->branch_misses);
+    }
+
+    ImGui::Begin("Profiler");
+
+#if CGTUB_PROFILER
+    double total = 0.0;
+    for (SmoothedStage const& stage : stages)
+        total += stage.milliseconds;
+
+    // Misses are shown per pixel of the framebuffer, IPC is instructions per cycle
+    int columns = *use_counters ? 7 : 3;
+    if (ImGui::BeginTable("Stages", columns, ImGuiTableFlags_SizingFixedFit))
+    {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("ms");
+        if (*use_counters)
+        {
+            ImGui::TableSetupColumn("IPC");
+            ImGui::TableSetupColumn("L1D/px");
+            ImGui::TableSetupColumn("LLC/px");
+            ImGui::TableSetupColumn("Branch/px");
+        }
+        ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        double pixel_count = std::max(pixels, 1);
+        for (SmoothedStage const& stage : stages)
         {
-            random_colors[i] = glm::vec3(distribution(engine), distribution(engine), distribution(engine));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stage.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stage.milliseconds);
+            if (*use_counters)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", stage.cycles > 0.0 ? stage.instructions / stage.cycles : 0.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stage.l1d_misses / pixel_count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stage.llc_misses / pixel_count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stage.branch_misses / pixel_count);
+            }
+            ImGui::TableNextColumn();
+            ImGui::ProgressBar(total > 0.0 ? static_cast<float>(stage.milliseconds / total) : 0.f, ImVec2(-1.f, 0.f), "");
         }
+        ImGui::EndTable();
     }
+    ImGui::Text("Total %.3f ms", total);
+
+    if (ImGui::Checkbox("Record Trace (trace.json)", record_trace))
+        changes |= 0b01;
+    if (ImGui::Checkbox("Hardware Counters", use_counters))
+        changes |= 0b10;
+#else
+    ImGui::Text("Built without CGTUB_PROFILER");
+#endif
+
+    ImGui::End();
+
+    return changes;
+}
+
+GuiChanges frame_time_gui(char const* title, cgtub::FrameTimeHistory const& history, int* window)
+{
+    GuiChanges changes{0};
+
+    ImGui::Begin(title);
+
+    if (ImGui::SliderInt("Window (frames)", window, 16, 1024))
+        changes |= 0b1;
+
+    cgtub::FrameTimeSummary summary = history.summarize(*window);
+    ImGui::Text("p50 %.2f ms  p95 %.2f ms  p99 %.2f ms  max %.2f ms", summary.p50, summary.p95, summary.p99, summary.max);
+    ImGui::Text("mean %.2f ms over %zu frames", summary.mean, summary.frames);
+
+    // Both plots share a scale that leaves room above the slowest frame
+    float scale = static_cast<float>(std::max(summary.max * 1.1, 1.0));
 
-    return random_colors[triangle_index % num_random_colors];
+    std::vector<float> recent;
+    history.recent(*window, &recent);
+    ImGui::PlotLines("##Recent", recent.data(), static_cast<int>(recent.size()), 0, "Last frames", 0.f, scale, ImVec2(-1.f, 80.f));
+
+    std::array<float, 32> bins;
+    history.histogram(*window, scale, bins);
+    ImGui::PlotHistogram("##Histogram", bins.data(), static_cast<int>(bins.size()), 0, "Distribution", 0.f, FLT_MAX, ImVec2(-1.f, 80.f));
+    ImGui::Text("Histogram from 0 to %.1f ms in %zu bins", scale, bins.size());
+
+    ImGui::End();
+
+    return changes;
+}
+
+bool has_gui_changed_parameter(GuiChanges gui_changes, uint32_t parameter_index)
+{
+    if (parameter_index >= 32)
+        return false;
+
+    return static_cast<bool>(gui_changes & (1 << parameter_index));
 }
 
 glm::vec3 generate_dummy_color(int x, int y, int width, int height)
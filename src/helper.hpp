@@ -1,9 +1,16 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 #include <glm/glm.hpp>
 
+#include <cgtub/frame_times.hpp>
+#include <cgtub/profiler.hpp>
+#include <cgtub/vertex_cache.hpp>
+
+#include "rasterizer.hpp"
+
 namespace ex3
 {
 
@@ -14,10 +21,34 @@ using GuiChanges = uint32_t;
  *
  * All non-const parameters are input/output, meaning their value will be used to display the GUI and
  * they will be set to the new value, as implied by user interaction with the GUI (in the previous frame).
+ * The const parameters are statistics that are only displayed.
  *
  * \return Object that tracks changes to the parameters.
  */
-GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* use_z_buffer, bool* show_z_buffer, bool* cull_negative_w, bool* cull_front_faces);
+GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* use_z_buffer, bool* show_z_buffer, bool* show_overdraw, bool* cull_negative_w, bool* cull_front_faces, bool* sort_last, int* num_sphere_instances, bool* use_lru_vertex_cache, bool* collect_raster_stats, cgtub::VertexCacheCounters const& vertex_cache_counters, RasterStats const& raster_stats);
+
+/**
+ * \brief Show the time and hardware events per pipeline stage of the last frames, with toggles to record a trace and to count hardware events.
+ *
+ * \param[in]     frame_stages The time per stage of the last frame (see \c cgtub::summarize_profile_events).
+ * \param[in]     pixels       The number of pixels of the framebuffer (cache misses are shown per pixel).
+ * \param[in,out] record_trace If a trace is being recorded.
+ * \param[in,out] use_counters If hardware counters are read (see \c cgtub::enable_profile_counters).
+ *
+ * \return Object that tracks changes to the parameters (0 for \c record_trace, 1 for \c use_counters).
+ */
+GuiChanges profiler_gui(std::span<cgtub::ProfileStage const> frame_stages, int pixels, bool* record_trace, bool* use_counters);
+
+/**
+ * \brief Show the percentiles, the recent history and a histogram of the frame times in a sliding window of frames.
+ *
+ * \param[in]     title   The title of the window.
+ * \param[in]     history The times of the last frames.
+ * \param[in,out] window  The number of frames the statistics are computed over.
+ *
+ * \return Object that tracks changes to the parameters (0 for \c window).
+ */
+GuiChanges frame_time_gui(char const* title, cgtub::FrameTimeHistory const& history, int* window);
 
 /**
  * \brief Query if an interaction with the GUI has changed a parameter value.
@@ -45,9 +76,6 @@ GuiChanges gui(int* subsampling_rate, bool* use_random_triangle_colors, bool* us
  */
 bool has_gui_changed_parameter(GuiChanges gui_changes, uint32_t parameter_index);
 
-// Generate a unique, random color for the triangle with index `triangle_index`
-glm::vec3 get_random_color(size_t triangle_index);
-
 glm::vec3 generate_dummy_color(int x, int y, int width, int height);
 
 } // namespace ex3
\ No newline at end of file
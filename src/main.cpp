@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 #include <span>
 #include <vector>
@@ -10,230 +11,19 @@
 
 #include "imgui.h"
 
-#include <algorithm>
 #include <cgtub/camera_controller_turntable.hpp>
 #include <cgtub/camera_perspective.hpp>
 #include <cgtub/canvas.hpp>
 #include <cgtub/event_dispatcher.hpp>
-#include <cgtub/geometry.hpp>
+#include <cgtub/frame_times.hpp>
 #include <cgtub/gl_wrap.hpp>
-#include <cgtub/image.hpp>
 #include <cgtub/image_renderer.hpp>
-#include <cgtub/primitives.hpp>
-#include <cmath>
+#include <cgtub/log.hpp>
+#include <cgtub/profiler.hpp>
 
 #include "helper.hpp"
-
-void rasterize_lines(
-    std::span<glm::vec4 const> points,
-    std::span<glm::vec3 const> colors,
-    int                        width,
-    int                        height,
-    std::vector<glm::vec3>*    image,
-    std::vector<float>&        zbuffer,
-    bool                       use_zbuffer,
-    bool                       cull_behind_camera) // toggle z-buffer
-{
-    auto ndc_to_screen = [&](glm::vec4 const& p)
-    {
-        glm::vec4 ndc = p / p.w; // homogeneous divide
-        float     x   = (ndc.x + 1.0f) * 0.5f * (width - 1);
-        float     y   = (ndc.y + 1.0f) * 0.5f * (height - 1);
-        return glm::vec2(x, y);
-    };
-
-    for (size_t i = 0; i < points.size(); i += 2)
-    {
-        glm::vec4 p0_ndc = points[i];
-        glm::vec4 p1_ndc = points[i + 1];
-        glm::vec3 color  = colors[i / 2];
-
-        // Cull behind camera
-        if (cull_behind_camera && (p0_ndc.w < 0 || p1_ndc.w < 0))
-            continue;
-
-        glm::vec2 p0 = ndc_to_screen(p0_ndc);
-        glm::vec2 p1 = ndc_to_screen(p1_ndc);
-
-        int x0 = (int)std::round(p0.x);
-        int y0 = (int)std::round(p0.y);
-        int x1 = (int)std::round(p1.x);
-        int y1 = (int)std::round(p1.y);
-
-        int dx  = std::abs(x1 - x0);
-        int dy  = std::abs(y1 - y0);
-        int sx  = (x0 < x1) ? 1 : -1;
-        int sy  = (y0 < y1) ? 1 : -1;
-        int err = dx - dy;
-
-        int steps = std::max(dx, dy);
-        int step  = 0;
-
-        while (true)
-        {
-            float t = steps == 0 ? 0.0f : (float)step / (float)steps;
-
-            // Interpolate z in NDC
-            float z0 = p0_ndc.z / p0_ndc.w;
-            float z1 = p1_ndc.z / p1_ndc.w;
-            float z  = (1.0f - t) * z0 + t * z1;
-
-            if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height && z >= -1.0f && z <= 1.0f)
-            {
-                int idx = y0 * width + x0;
-
-                if (!use_zbuffer)
-                {
-                    // Draw without depth test
-                    (*image)[idx] = color;
-                }
-                else
-                {
-                    // Draw only if closer
-                    if (z < zbuffer[idx])
-                    {
-                        zbuffer[idx]  = z;
-                        (*image)[idx] = color;
-                    }
-                }
-            }
-
-            if (x0 == x1 && y0 == y1)
-                break;
-
-            int e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err -= dy;
-                x0 += sx;
-            }
-            if (e2 < dx)
-            {
-                err += dx;
-                y0 += sy;
-            }
-
-            step++;
-        }
-    }
-}
-
-void rasterize_mesh(
-    std::span<glm::vec4 const>    positions,
-    std::span<glm::u32vec3 const> indices,
-    glm::vec3 const&              color,
-    bool                          use_random_triangle_colors,
-    int                           width,
-    int                           height,
-    std::vector<glm::vec3>*       image,
-    std::vector<float>&           zbuffer,
-    bool                          use_zbuffer,
-    bool                          show_zbuffer,
-    bool                          cull_behind_camera,
-    bool                          cull_front_faces)
-{
-    auto ndc_to_screen = [&](glm::vec4 const& p)
-    {
-        glm::vec4 ndc = p / p.w; // homogeneous divide
-        float     x   = (ndc.x + 1.0f) * 0.5f * (width - 1);
-        float     y   = (ndc.y + 1.0f) * 0.5f * (height - 1);
-        return glm::vec2(x, y);
-    };
-
-    for (size_t i = 0; i < indices.size(); ++i)
-    {
-        glm::u32vec3 tri = indices[i];
-
-        glm::vec4 p0_ndc = positions[tri.x];
-        glm::vec4 p1_ndc = positions[tri.y];
-        glm::vec4 p2_ndc = positions[tri.z];
-
-        // Cull behind camera
-        if (cull_behind_camera)
-        {
-            if (p0_ndc.w < 0 || p1_ndc.w < 0 || p2_ndc.w < 0)
-                continue; // skip triangle
-        }
-
-        glm::vec2 p0 = ndc_to_screen(p0_ndc);
-        glm::vec2 p1 = ndc_to_screen(p1_ndc);
-        glm::vec2 p2 = ndc_to_screen(p2_ndc);
-
-        //  Frontface culling
-        if (cull_front_faces)
-        {
-           
-            float winding = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
-            if (winding > 0)
-                continue;
-        }
-
-        glm::vec3 tri_color = use_random_triangle_colors ? ex3::get_random_color(i) : color;
-
-        int xmin = std::max(0, (int)std::floor(std::min({p0.x, p1.x, p2.x})));
-        int xmax = std::min(width - 1, (int)std::ceil(std::max({p0.x, p1.x, p2.x})));
-        int ymin = std::max(0, (int)std::floor(std::min({p0.y, p1.y, p2.y})));
-        int ymax = std::min(height - 1, (int)std::ceil(std::max({p0.y, p1.y, p2.y})));
-
-        glm::vec2 v0    = p1 - p0;
-        glm::vec2 v1    = p2 - p0;
-        float     denom = v0.x * v1.y - v1.x * v0.y;
-        if (std::abs(denom) < 1e-6f)
-            continue; // skip degenerate triangles
-
-        for (int y = ymin; y <= ymax; ++y)
-        {
-            for (int x = xmin; x <= xmax; ++x)
-            {
-                glm::vec2 v2 = glm::vec2(x + 0.5f, y + 0.5f) - p0;
-
-                float w1 = (v2.x * v1.y - v1.x * v2.y) / denom; // weight for p1
-                float w2 = (v0.x * v2.y - v2.x * v0.y) / denom; // weight for p2
-                float w0 = 1.0f - w1 - w2;                      // weight for p0
-
-                if (w0 >= 0 && w1 >= 0 && w2 >= 0)
-                {
-                    float z = w0 * (p0_ndc.z / p0_ndc.w) +
-                              w1 * (p1_ndc.z / p1_ndc.w) +
-                              w2 * (p2_ndc.z / p2_ndc.w);
-
-                    if (z < -1.0f || z > 1.0f)
-                        continue; // outside frustum
-
-                    int idx = y * width + x;
-
-                    if (!use_zbuffer)
-                    {
-                        if (!show_zbuffer)
-                            (*image)[idx] = tri_color;
-                    }
-                    else if (z < zbuffer[idx])
-                    {
-                        zbuffer[idx] = z;
-                        if (!show_zbuffer)
-                            (*image)[idx] = tri_color;
-                    }
-                }
-            }
-        }
-    }
-
-    // Smooth z-buffer visualization
-    if (show_zbuffer)
-    {
-        for (int y = 0; y < height; ++y)
-        {
-            for (int x = 0; x < width; ++x)
-            {
-                int   idx         = y * width + x;
-                float z           = zbuffer[idx];
-                float depth_color = 1.0f - (z + 1.0f) / 2.0f;
-                depth_color       = glm::clamp(depth_color, 0.0f, 1.0f);
-                (*image)[idx]     = glm::vec3(depth_color);
-            }
-        }
-    }
-}
+#include "render_pipeline.hpp"
+#include "scene.hpp"
 
 int main(int argc, char** argv)
 {
@@ -284,48 +74,50 @@ int main(int argc, char** argv)
     width /= subsampling_rate;
     height /= subsampling_rate;
 
+    // Create the scene geometry (a coordinate system, a box and a sphere)
+    int   num_sphere_instances = 1;
+    Scene scene;
+    create_scene(num_sphere_instances, &scene);
+
+    // A mesh file (OBJ, glTF or PLY) can be passed on the command line, it is scaled to fit next to the box.
+    // OBJ files are loaded through a binary cache next to the file, which is memory-mapped on later runs.
+    // With `--frame-times <path>`, the time of every frame is streamed to a file as one JSON object per line.
+    cgtub::FrameTimeStream frame_time_stream;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--frame-times") == 0 && i + 1 < argc)
+            frame_time_stream.open(argv[++i]);
+        else
+            load_instanced_meshes(argv[i], &scene.loaded_file, &scene.loaded_meshes);
+    }
+
     // The image data itself (i.e. color for each pixel) is simply an array of colors.
     // For a pixel (x,y) the color is accessed as image[y*width + x].
-    std::vector<glm::vec3> image(width * height, glm::vec3(0));
-
-    // Create the scene geometry (a coordinate system, a box and a sphere)...
-    glm::vec3 axes_start_end[] = {
-        glm::vec3(0, 0, 0),
-        glm::vec3(1, 0, 0),
-        glm::vec3(0, 0, 0),
-        glm::vec3(0, 1, 0),
-        glm::vec3(0, 0, 0),
-        glm::vec3(0, 0, 1),
-    };
-    glm::vec3 axes_colors[] = {
-        glm::vec3(1, 0, 0),
-        glm::vec3(0, 1, 0),
-        glm::vec3(0, 0, 1),
-    };
-
-    std::vector<glm::vec3>    box_vertices;
-    std::vector<glm::u32vec3> box_indices;
-    cgtub::create_box_geometry(0.5f, &box_vertices, &box_indices);
-    glm::vec3 box_color(1.f);
-
-    std::vector<glm::vec3>    sphere_vertices;
-    std::vector<glm::u32vec3> sphere_indices;
-    cgtub::create_sphere_geometry(0.5f, &sphere_vertices, &sphere_indices);
-    for (glm::vec3& v : sphere_vertices)
-        v = v + glm::vec3(1, 0, 0);
-    glm::vec3 sphere_color(0.f, 1.f, 0.f);
-
-    // ...and reserve arrays for their NDC coordinates
-    std::vector<glm::vec4> axes_start_end_ndc(std::size(axes_start_end));
-    std::vector<glm::vec4> box_vertices_ndc(box_vertices.size());
-    std::vector<glm::vec4> sphere_vertices_ndc(sphere_vertices.size());
+    // The images are rendered by a pipeline of two threads, so the window stays responsive while a frame takes long:
+    // every iteration of the main loop requests a frame of the current camera and displays the latest finished one.
+    // The geometry of the next frame is prepared while one frame is rasterized and the one before is uploaded.
+    RenderPipeline render_pipeline(scene);
 
     // Application state
-    bool use_random_triangle_colors = false;
-    bool use_z_buffer               = true;
-    bool show_z_buffer              = false;
-    bool cull_behind_camera         = false;
-    bool cull_front_faces           = false;
+    RenderSettings settings;
+    bool           use_lru_vertex_cache = false;
+
+    // Profiler state: the stages of the previous frame are shown in the GUI, a trace covers all frames while recording
+    std::vector<cgtub::ProfileEvent> profile_events;
+    std::vector<cgtub::ProfileStage> frame_stages;
+    uint64_t                         frame_begin  = cgtub::profiler_now();
+    uint64_t                         trace_begin  = 0;
+    bool                             record_trace = false;
+    bool                             use_counters = false;
+
+    // Frame time state: percentiles and histograms are computed over a sliding window of the last frames,
+    // both of the main loop (the display rate) and of the render pipeline
+    cgtub::FrameTimeHistory frame_times;
+    cgtub::FrameTimeHistory render_times;
+    int                     frame_time_window  = 240;
+    int                     render_time_window = 240;
+
+    cgtub::set_profiler_thread_name("main");
 
     // Main loop: one iteration is one frame
     float time = static_cast<float>(glfwGetTime());
@@ -338,6 +130,13 @@ int main(int argc, char** argv)
         float dt  = now - time;
         time      = now;
 
+        frame_times.add(1000.0 * dt);
+        if (frame_time_stream.is_open())
+        {
+            cgtub::FrameTimeSummary summary = frame_times.summarize(frame_time_window);
+            frame_time_stream.write(frame_times.frame_count() - 1, 1000.0 * dt, &summary);
+        }
+
         // Poll and record window events (resizing, key inputs, etc.)
         // The dispatcher is implicitly connected to the window and receives these events.
         dispatcher->poll_window_events();
@@ -346,7 +145,47 @@ int main(int argc, char** argv)
         canvas.update(dt, dispatcher);
         camera_controller.update(dt, dispatcher);
 
-        ex3::GuiChanges gui_changes = ex3::gui(&subsampling_rate, &use_random_triangle_colors, &use_z_buffer, &show_z_buffer, &cull_behind_camera, &cull_front_faces);
+        // The previous frame ended with presenting it
+        uint64_t previous_frame_begin = frame_begin;
+        frame_begin                   = cgtub::profiler_now();
+        cgtub::collect_profile_events(previous_frame_begin, &profile_events);
+        cgtub::summarize_profile_events(profile_events, &frame_stages);
+
+        // Display the latest frame the render pipeline finished
+        // (don't need to clear the canvas because image fully fills it)
+        RenderedFrame const& frame = render_pipeline.frame();
+        if (render_pipeline.acquire_frame())
+        {
+            render_times.add(frame.milliseconds);
+
+            CGTUB_PROFILE_ZONE("upload");
+            renderer.upload(frame.image, frame.width, frame.height);
+        }
+        renderer.render();
+
+        ex3::GuiChanges profiler_changes = ex3::profiler_gui(frame_stages, frame.width * frame.height, &record_trace, &use_counters);
+        if (ex3::has_gui_changed_parameter(profiler_changes, 0))
+        {
+            if (record_trace)
+            {
+                trace_begin = frame_begin;
+            }
+            else
+            {
+                cgtub::collect_profile_events(trace_begin, &profile_events);
+                if (cgtub::write_chrome_trace("trace.json", profile_events))
+                    cgtub::log_message(cgtub::LogLevel::Debug, "Wrote %zu profiler events to trace.json", profile_events.size());
+            }
+        }
+
+        ex3::frame_time_gui("Frame Times", frame_times, &frame_time_window);
+        ex3::frame_time_gui("Render Times", render_times, &render_time_window);
+
+        // Without access to the counters (e.g. in a VM), the toggle turns itself off again
+        if (ex3::has_gui_changed_parameter(profiler_changes, 1))
+            use_counters = cgtub::enable_profile_counters(use_counters) && use_counters;
+
+        ex3::GuiChanges gui_changes = ex3::gui(&subsampling_rate, &settings.use_random_triangle_colors, &settings.use_zbuffer, &settings.show_zbuffer, &settings.show_overdraw, &settings.cull_behind_camera, &settings.cull_front_faces, &settings.sort_last, &num_sphere_instances, &use_lru_vertex_cache, &settings.collect_stats, frame.vertex_cache_counters, frame.stats);
 
         if (ex3::has_gui_changed_parameter(gui_changes, 0) || dispatcher->was_framebuffer_resized())
         {
@@ -357,82 +196,23 @@ int main(int argc, char** argv)
             {
                 width  = viewport.width / subsampling_rate;
                 height = viewport.height / subsampling_rate;
-                image.resize(width * height);
             }
         }
 
-        // Transform the coordinate axes, the box and the sphere to NDC
-        glm::mat4 view_projection_matrix = camera.projection() * camera.view();
-        for (size_t i = 0; i < std::size(axes_start_end); ++i)
-            axes_start_end_ndc[i] = view_projection_matrix * glm::vec4(axes_start_end[i], 1.f);
-        for (size_t i = 0; i < box_vertices.size(); ++i)
-            box_vertices_ndc[i] = view_projection_matrix * glm::vec4(box_vertices[i], 1.f);
-        for (size_t i = 0; i < sphere_vertices.size(); ++i)
-            sphere_vertices_ndc[i] = view_projection_matrix * glm::vec4(sphere_vertices[i], 1.f);
-
-        // Fill the image with a dummy color (here, one could clear the image with a constant color)
-        for (int y = 0; y < height; ++y)
+        // Rasterize the coordinate axes, the box, the loaded mesh and the spheres (in the render pipeline);
+        // the frame is displayed in one of the next iterations
+        render_pipeline.request(RenderRequest{.view_matrix              = camera.view(),
+                                            .projection_matrix        = camera.projection(),
+                                            .settings                 = settings,
+                                            .width                    = width,
+                                            .height                   = height,
+                                            .num_sphere_instances     = num_sphere_instances,
+                                            .vertex_cache_replacement = use_lru_vertex_cache ? cgtub::CacheReplacement::Lru : cgtub::CacheReplacement::Fifo});
+
         {
-            for (int x = 0; x < width; ++x)
-            {
-                image[y * width + x] = glm::vec3(0.0f); // ex3::generate_dummy_color(x, y, width, height)
-            }
+            CGTUB_PROFILE_ZONE("present");
+            cgtub::end_frame(window);
         }
-
-        bool use_zbuffer  = use_z_buffer;
-        bool show_zbuffer = show_z_buffer;
-        bool cull_behind  = cull_behind_camera;
-        bool cull_front   = cull_front_faces;
-
-        std::vector<float> zbuffer(width * height, 1.0f);
-        // Clear image and z-buffer
-        std::fill(image.begin(), image.end(), glm::vec3(0.0f));
-        if (use_zbuffer)
-            std::fill(zbuffer.begin(), zbuffer.end(), 1.0f);
-        // Rasterize coordinate axes
-        rasterize_lines(
-            axes_start_end_ndc,
-            axes_colors,
-            width,
-            height,
-            &image,
-            zbuffer,
-            use_zbuffer,
-            cull_behind);
-        // Rasterize box and sphere
-        rasterize_mesh(
-            box_vertices_ndc,
-            box_indices,
-            box_color,
-            use_random_triangle_colors,
-            width,
-            height,
-            &image,
-            zbuffer,
-            use_zbuffer,
-            show_zbuffer,
-            cull_behind,
-            cull_front);
-
-        rasterize_mesh(
-            sphere_vertices_ndc,
-            sphere_indices,
-            sphere_color,
-            use_random_triangle_colors,
-            width,
-            height,
-            &image,
-            zbuffer,
-            use_zbuffer,
-            show_zbuffer,
-            cull_behind,
-            cull_front);
-
-        // Display the generated image on the canvas
-        // (don't need to clear the canvas because image fully fills it)
-        renderer.render(image, width, height);
-
-        cgtub::end_frame(window);
     }
 
     cgtub::uninit(window, dispatcher);
@@ -0,0 +1,653 @@
+#include "rasterizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cgtub/culling.hpp>
+#include <cgtub/meshlet.hpp>
+#include <cgtub/profiler.hpp>
+#include <cgtub/threading.hpp>
+#include <cgtub/vertex_transform.hpp>
+
+namespace ex3
+{
+
+glm::vec3 get_random_color(size_t triangle_index)
+{
+    // Well, "unique" if the number of triangles is below 1024 :)
+    constexpr int num_random_colors = 1024;
+
+    // Fill the color array on the first call (thread-safe, frames may be rendered in parallel)
+    static std::vector<glm::vec3> const random_colors = []
+    {
+        std::default_random_engine            engine(0);
+        std::uniform_real_distribution<float> distribution;
+        std::vector<glm::vec3>                random_colors(num_random_colors);
+        for (size_t i = 0; i < random_colors.size(); ++i)
+        {
+            random_colors[i] = glm::vec3(distribution(engine), distribution(engine), distribution(engine));
+        }
+        return random_colors;
+    }();
+
+    return random_colors[triangle_index % num_random_colors];
+}
+
+} // namespace ex3
+
+namespace
+{
+
+// Triangles are set up in batches of this size before the batch is rasterized, so the two stages can be timed separately
+constexpr size_t triangle_batch_size = 256;
+
+// Post-processing passes split the image into jobs of at least this many pixels
+constexpr size_t min_pixels_per_job = 1 << 14;
+
+// A triangle that passed culling, with everything the raster stage needs
+struct TriangleSetup
+{
+    glm::vec2 p0;
+    glm::vec2 v0; // p1 - p0
+    glm::vec2 v1; // p2 - p0
+    float     denom;
+    glm::vec3 z; // NDC depth of the vertices
+    glm::vec3 color;
+    int       xmin, xmax, ymin, ymax;
+};
+
+} // namespace
+
+void rasterize_lines(
+    std::span<glm::vec4 const> points,
+    std::span<glm::vec3 const> colors,
+    int                        width,
+    int                        height,
+    std::vector<glm::vec3>*    image,
+    std::vector<float>&        zbuffer,
+    bool                       use_zbuffer,
+    bool                       cull_behind_camera) // toggle z-buffer
+{
+    CGTUB_PROFILE_ZONE("raster");
+
+    auto ndc_to_screen = [&](glm::vec4 const& p)
+    {
+        glm::vec4 ndc = p / p.w; // homogeneous divide
+        float     x   = (ndc.x + 1.0f) * 0.5f * (width - 1);
+        float     y   = (ndc.y + 1.0f) * 0.5f * (height - 1);
+        return glm::vec2(x, y);
+    };
+
+    for (size_t i = 0; i < points.size(); i += 2)
+    {
+        glm::vec4 p0_ndc = points[i];
+        glm::vec4 p1_ndc = points[i + 1];
+        glm::vec3 color  = colors[i / 2];
+
+        // Cull behind camera
+        if (cull_behind_camera && (p0_ndc.w < 0 || p1_ndc.w < 0))
+            continue;
+
+        glm::vec2 p0 = ndc_to_screen(p0_ndc);
+        glm::vec2 p1 = ndc_to_screen(p1_ndc);
+
+        int x0 = (int)std::round(p0.x);
+        int y0 = (int)std::round(p0.y);
+        int x1 = (int)std::round(p1.x);
+        int y1 = (int)std::round(p1.y);
+
+        int dx  = std::abs(x1 - x0);
+        int dy  = std::abs(y1 - y0);
+        int sx  = (x0 < x1) ? 1 : -1;
+        int sy  = (y0 < y1) ? 1 : -1;
+        int err = dx - dy;
+
+        int steps = std::max(dx, dy);
+        int step  = 0;
+
+        while (true)
+        {
+            float t = steps == 0 ? 0.0f : (float)step / (float)steps;
+
+            // Interpolate z in NDC
+            float z0 = p0_ndc.z / p0_ndc.w;
+            float z1 = p1_ndc.z / p1_ndc.w;
+            float z  = (1.0f - t) * z0 + t * z1;
+
+            if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height && z >= -1.0f && z <= 1.0f)
+            {
+                int idx = y0 * width + x0;
+
+                if (!use_zbuffer)
+                {
+                    // Draw without depth test
+                    (*image)[idx] = color;
+                }
+                else
+                {
+                    // Draw only if closer
+                    if (z < zbuffer[idx])
+                    {
+                        zbuffer[idx]  = z;
+                        (*image)[idx] = color;
+                    }
+                }
+            }
+
+            if (x0 == x1 && y0 == y1)
+                break;
+
+            int e2 = 2 * err;
+            if (e2 > -dy)
+            {
+                err -= dy;
+                x0 += sx;
+            }
+            if (e2 < dx)
+            {
+                err += dx;
+                y0 += sy;
+            }
+
+            step++;
+        }
+    }
+}
+
+namespace
+{
+
+// Rasterizes triangles as `rasterize_mesh`; the statistics are only counted in the instantiation that collects them
+template <bool collect_stats>
+void rasterize_triangles(
+    std::span<glm::vec4 const>    positions,
+    std::span<glm::u32vec3 const> indices,
+    glm::vec3 const&              color,
+    bool                          use_random_triangle_colors,
+    int                           width,
+    int                           height,
+    std::vector<glm::vec3>*       image,
+    std::vector<float>&           zbuffer,
+    bool                          use_zbuffer,
+    bool                          show_zbuffer,
+    bool                          cull_behind_camera,
+    bool                          cull_front_faces,
+    VertexCache*                  vertex_cache,
+    size_t                        first_triangle,
+    RasterStats*                  stats)
+{
+    auto ndc_to_screen = [&](glm::vec4 const& p)
+    {
+        glm::vec4 ndc = p / p.w; // homogeneous divide
+        float     x   = (ndc.x + 1.0f) * 0.5f * (width - 1);
+        float     y   = (ndc.y + 1.0f) * 0.5f * (height - 1);
+        return glm::vec2(x, y);
+    };
+
+    // Vertex stage: project a vertex to the screen (only on cache misses)
+    auto project_vertex = [&](uint32_t index)
+    {
+        glm::vec4 const& p = positions[index];
+        return ScreenVertex{ndc_to_screen(p), p.z / p.w, p.w};
+    };
+
+    // Cached vertices belong to the previous position buffer
+    vertex_cache->clear();
+
+    // Setup and raster alternate per batch; their times are summed and recorded as one zone each
+#if CGTUB_PROFILER
+    uint64_t                  call_begin = cgtub::profiler_now();
+    cgtub::ProfileAccumulator setup_zone;
+    cgtub::ProfileAccumulator raster_zone;
+#endif
+
+    // Counted locally, so the counters can stay in registers
+    RasterStats counts;
+    if constexpr (collect_stats)
+        counts.overdraw = stats->overdraw;
+
+    std::array<TriangleSetup, triangle_batch_size> batch;
+    for (size_t batch_begin = 0; batch_begin < indices.size(); batch_begin += triangle_batch_size)
+    {
+#if CGTUB_PROFILER
+        setup_zone.begin();
+#endif
+
+        // Setup stage: fetch the vertices, cull, and compute the bounding box and edges
+        size_t batch_end   = std::min(batch_begin + triangle_batch_size, indices.size());
+        size_t batch_count = 0;
+        for (size_t i = batch_begin; i < batch_end; ++i)
+        {
+            glm::u32vec3 tri = indices[i];
+            if constexpr (collect_stats)
+                ++counts.triangles_submitted;
+
+            ScreenVertex v0_screen = vertex_cache->fetch(tri.x, project_vertex);
+            ScreenVertex v1_screen = vertex_cache->fetch(tri.y, project_vertex);
+            ScreenVertex v2_screen = vertex_cache->fetch(tri.z, project_vertex);
+
+            // Cull behind camera
+            if (cull_behind_camera)
+            {
+                if (v0_screen.w < 0 || v1_screen.w < 0 || v2_screen.w < 0)
+                {
+                    if constexpr (collect_stats)
+                        ++counts.culled_behind_camera;
+                    continue; // skip triangle
+                }
+            }
+
+            glm::vec2 p0 = v0_screen.position;
+            glm::vec2 p1 = v1_screen.position;
+            glm::vec2 p2 = v2_screen.position;
+
+            //  Frontface culling
+            if (cull_front_faces)
+            {
+                float winding = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+                if (winding > 0)
+                {
+                    if constexpr (collect_stats)
+                        ++counts.culled_front_faces;
+                    continue;
+                }
+            }
+
+            glm::vec2 v0    = p1 - p0;
+            glm::vec2 v1    = p2 - p0;
+            float     denom = v0.x * v1.y - v1.x * v0.y;
+            if (std::abs(denom) < 1e-6f)
+            {
+                if constexpr (collect_stats)
+                    ++counts.culled_degenerate;
+                continue; // skip degenerate triangles
+            }
+
+            TriangleSetup& setup = batch[batch_count];
+            setup.xmin           = std::max(0, (int)std::floor(std::min({p0.x, p1.x, p2.x})));
+            setup.xmax           = std::min(width - 1, (int)std::ceil(std::max({p0.x, p1.x, p2.x})));
+            setup.ymin           = std::max(0, (int)std::floor(std::min({p0.y, p1.y, p2.y})));
+            setup.ymax           = std::min(height - 1, (int)std::ceil(std::max({p0.y, p1.y, p2.y})));
+            if (setup.xmin > setup.xmax || setup.ymin > setup.ymax)
+            {
+                if constexpr (collect_stats)
+                    ++counts.culled_frustum;
+                continue; // skip triangles outside the image
+            }
+
+            setup.p0    = p0;
+            setup.v0    = v0;
+            setup.v1    = v1;
+            setup.denom = denom;
+            setup.z     = glm::vec3(v0_screen.z, v1_screen.z, v2_screen.z);
+            setup.color = use_random_triangle_colors ? ex3::get_random_color(first_triangle + i) : color;
+            ++batch_count;
+        }
+
+#if CGTUB_PROFILER
+        setup_zone.end();
+        raster_zone.begin();
+#endif
+
+        // Raster stage: test the pixels in the bounding box of every triangle of the batch (in submission order)
+        for (size_t t = 0; t < batch_count; ++t)
+        {
+            TriangleSetup const& setup = batch[t];
+            glm::vec2            p0    = setup.p0;
+            glm::vec2            v0    = setup.v0;
+            glm::vec2            v1    = setup.v1;
+            float                denom = setup.denom;
+
+            if constexpr (collect_stats)
+                counts.pixels_tested += static_cast<uint64_t>(setup.xmax - setup.xmin + 1) * (setup.ymax - setup.ymin + 1);
+
+            for (int y = setup.ymin; y <= setup.ymax; ++y)
+            {
+                for (int x = setup.xmin; x <= setup.xmax; ++x)
+                {
+                    glm::vec2 v2 = glm::vec2(x + 0.5f, y + 0.5f) - p0;
+
+                    float w1 = (v2.x * v1.y - v1.x * v2.y) / denom; // weight for p1
+                    float w2 = (v0.x * v2.y - v2.x * v0.y) / denom; // weight for p2
+                    float w0 = 1.0f - w1 - w2;                      // weight for p0
+
+                    if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+                    {
+                        if constexpr (collect_stats)
+                            ++counts.pixels_covered;
+
+                        float z = w0 * setup.z.x +
+                                  w1 * setup.z.y +
+                                  w2 * setup.z.z;
+
+                        if (z < -1.0f || z > 1.0f)
+                            continue; // outside frustum
+
+                        int idx = y * width + x;
+
+                        if constexpr (collect_stats)
+                        {
+                            if (!counts.overdraw.empty())
+                                ++counts.overdraw[idx];
+                        }
+
+                        if (!use_zbuffer)
+                        {
+                            if constexpr (collect_stats)
+                                ++counts.pixels_depth_passed;
+                            if (!show_zbuffer)
+                            {
+                                (*image)[idx] = setup.color;
+                                if constexpr (collect_stats)
+                                    ++counts.pixels_written;
+                            }
+                        }
+                        else if (z < zbuffer[idx])
+                        {
+                            if constexpr (collect_stats)
+                                ++counts.pixels_depth_passed;
+                            zbuffer[idx] = z;
+                            if (!show_zbuffer)
+                            {
+                                (*image)[idx] = setup.color;
+                                if constexpr (collect_stats)
+                                    ++counts.pixels_written;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+#if CGTUB_PROFILER
+        raster_zone.end();
+#endif
+    }
+
+#if CGTUB_PROFILER
+    raster_zone.record("raster", setup_zone.record("setup", call_begin));
+#endif
+
+    if constexpr (collect_stats)
+        *stats += counts;
+}
+
+} // namespace
+
+RasterStats& operator+=(RasterStats& stats, RasterStats const& other)
+{
+    stats.triangles_submitted += other.triangles_submitted;
+    stats.culled_behind_camera += other.culled_behind_camera;
+    stats.culled_front_faces += other.culled_front_faces;
+    stats.culled_degenerate += other.culled_degenerate;
+    stats.culled_frustum += other.culled_frustum;
+    stats.pixels_tested += other.pixels_tested;
+    stats.pixels_covered += other.pixels_covered;
+    stats.pixels_depth_passed += other.pixels_depth_passed;
+    stats.pixels_written += other.pixels_written;
+    return stats;
+}
+
+void rasterize_mesh(
+    std::span<glm::vec4 const>    positions,
+    std::span<glm::u32vec3 const> indices,
+    glm::vec3 const&              color,
+    bool                          use_random_triangle_colors,
+    int                           width,
+    int                           height,
+    std::vector<glm::vec3>*       image,
+    std::vector<float>&           zbuffer,
+    bool                          use_zbuffer,
+    bool                          show_zbuffer,
+    bool                          cull_behind_camera,
+    bool                          cull_front_faces,
+    VertexCache*                  vertex_cache,
+    size_t                        first_triangle, // index of indices[0] in the full mesh (for random colors)
+    RasterStats*                  stats)
+{
+    if (stats)
+        rasterize_triangles<true>(positions, indices, color, use_random_triangle_colors, width, height, image, zbuffer, use_zbuffer, show_zbuffer,
+                                  cull_behind_camera, cull_front_faces, vertex_cache, first_triangle, stats);
+    else
+        rasterize_triangles<false>(positions, indices, color, use_random_triangle_colors, width, height, image, zbuffer, use_zbuffer, show_zbuffer,
+                                   cull_behind_camera, cull_front_faces, vertex_cache, first_triangle, nullptr);
+}
+
+void build_instance_bvh(cgtub::LodMeshView const& mesh, std::span<glm::mat4 const> model_matrices, cgtub::SceneBvh* bvh)
+{
+    std::vector<cgtub::Aabb> bounds;
+    bounds.reserve(model_matrices.size());
+    for (glm::mat4 const& model_matrix : model_matrices)
+        bounds.push_back(cgtub::compute_aabb(cgtub::transform_bounding_sphere(model_matrix, mesh.bounds)));
+
+    bvh->build(bounds);
+}
+
+namespace
+{
+
+// Runs of consecutive visible triangles (first triangle, triangle count) of an instance
+using TriangleRuns = std::vector<std::pair<size_t, size_t>>;
+
+// Picks the level of detail of an instance from its size on screen and collects the runs of its triangles
+// that are not in meshlets outside the frustum or (if front faces are culled) facing the camera
+cgtub::LodLevelView const& select_instance_triangles(
+    cgtub::LodMeshView const& mesh,
+    glm::mat4 const&          model_matrix,
+    glm::mat4 const&          model_view_projection_matrix,
+    uint32_t*                 lod_level,
+    float                     lod_triangles_per_pixel,
+    glm::mat4 const&          view_matrix,
+    glm::mat4 const&          projection_matrix,
+    int                       height,
+    bool                      cull_front_faces,
+    TriangleRuns*             runs)
+{
+    CGTUB_PROFILE_ZONE("culling");
+
+    // Pick the level of detail from the instance's size on screen
+    cgtub::BoundingSphere bounds         = cgtub::transform_bounding_sphere(model_matrix, mesh.bounds);
+    float                 projected_area = cgtub::compute_projected_area(bounds, view_matrix, projection_matrix, height);
+    *lod_level                           = cgtub::select_lod_level(mesh, projected_area, lod_triangles_per_pixel, *lod_level);
+    cgtub::LodLevelView const& level     = mesh.levels[*lod_level];
+
+    runs->clear();
+    if (mesh.is_level_valid && !mesh.is_level_valid(*lod_level))
+        return level; // E.g. a corrupt level of a mesh cache
+    if (level.meshlets.empty())
+    {
+        runs->emplace_back(0, level.indices.size());
+        return level;
+    }
+
+    // Reject whole meshlets outside the frustum or (if front faces are culled) facing the camera.
+    // Both tests run in object space, so the meshlet bounds do not have to be transformed.
+    cgtub::Frustum     object_frustum = cgtub::extract_frustum(model_view_projection_matrix);
+    glm::vec3          object_camera  = glm::inverse(view_matrix * model_matrix)[3];
+    cgtub::FaceCulling face_culling   = cull_front_faces ? cgtub::FaceCulling::FrontFaces : cgtub::FaceCulling::None;
+    for (cgtub::Meshlet const& meshlet : level.meshlets)
+    {
+        if (!cgtub::is_meshlet_visible(meshlet, object_frustum, object_camera, face_culling))
+            continue;
+
+        // Rasterize runs of consecutive visible meshlets at once
+        if (!runs->empty() && runs->back().first + runs->back().second == meshlet.first_triangle)
+            runs->back().second += meshlet.triangle_count;
+        else
+            runs->emplace_back(meshlet.first_triangle, meshlet.triangle_count);
+    }
+    return level;
+}
+
+} // namespace
+
+void prepare_mesh_instanced(
+    cgtub::LodMeshView const&  mesh,
+    std::span<glm::mat4 const> model_matrices,
+    cgtub::SceneBvh const&     instance_bvh,
+    std::span<uint32_t>        lod_levels,
+    float                      lod_triangles_per_pixel,
+    glm::mat4 const&           view_matrix,
+    glm::mat4 const&           projection_matrix,
+    int                        height,
+    bool                       cull_front_faces,
+    glm::vec3 const&           color,
+    std::vector<uint32_t>*     visible_instances,
+    std::vector<MeshDraw>*     draws)
+{
+    glm::mat4 view_projection_matrix = projection_matrix * view_matrix;
+
+    // Skip all instances whose bounds are outside the view frustum (whole subtrees of the hierarchy at once)
+    cgtub::Frustum frustum = cgtub::extract_frustum(view_projection_matrix);
+    {
+        CGTUB_PROFILE_ZONE("culling");
+        instance_bvh.cull(frustum, visible_instances);
+    }
+
+    TriangleRuns runs;
+    for (uint32_t instance : *visible_instances)
+    {
+        glm::mat4                  model_view_projection_matrix = view_projection_matrix * model_matrices[instance];
+        cgtub::LodLevelView const& level                        = select_instance_triangles(mesh, model_matrices[instance], model_view_projection_matrix, &lod_levels[instance],
+                                                                                            lod_triangles_per_pixel, view_matrix, projection_matrix, height, cull_front_faces, &runs);
+
+        for (auto [first_triangle, triangle_count] : runs)
+            draws->push_back(MeshDraw{{}, &mesh, &level, model_view_projection_matrix, level.indices.subspan(first_triangle, triangle_count), first_triangle, color});
+    }
+}
+
+void prepare_paged_mesh(
+    cgtub::PagedMesh&      mesh,
+    glm::mat4 const&       model_matrix,
+    float                  min_page_area,
+    glm::mat4 const&       view_matrix,
+    glm::mat4 const&       projection_matrix,
+    int                    height,
+    glm::vec3 const&       color,
+    std::vector<uint32_t>* pages,
+    std::vector<MeshDraw>* draws)
+{
+    {
+        CGTUB_PROFILE_ZONE("culling");
+        mesh.select_pages(model_matrix, view_matrix, projection_matrix, height, min_page_area, pages);
+    }
+
+    // The pages stay in the mapped file, a page evicted before the draw is rasterized is read from the file again
+    glm::mat4 model_view_projection_matrix = projection_matrix * view_matrix * model_matrix;
+    for (uint32_t page : *pages)
+        draws->push_back(MeshDraw{mesh.page_positions(page), nullptr, nullptr, model_view_projection_matrix, mesh.page_indices(page), mesh.page_first_triangle(page), color});
+}
+
+void rasterize_draws(
+    std::span<MeshDraw const> draws,
+    std::vector<glm::vec4>*   positions_ndc,
+    bool                      use_random_triangle_colors,
+    int                       width,
+    int                       height,
+    std::vector<glm::vec3>*   image,
+    std::vector<float>&       zbuffer,
+    bool                      use_zbuffer,
+    bool                      show_zbuffer,
+    bool                      cull_behind_camera,
+    bool                      cull_front_faces,
+    VertexCache*              vertex_cache,
+    RasterStats*              stats)
+{
+    // The draw whose vertices are in `positions_ndc`
+    MeshDraw const* transformed = nullptr;
+    for (MeshDraw const& draw : draws)
+    {
+        bool has_same_vertices = transformed && transformed->positions.data() == draw.positions.data() && transformed->positions.size() == draw.positions.size() &&
+                                 transformed->level == draw.level && transformed->model_view_projection_matrix == draw.model_view_projection_matrix;
+        if (!has_same_vertices)
+        {
+            CGTUB_PROFILE_ZONE("transform");
+            if (draw.level)
+                cgtub::transform_lod_level(*draw.mesh, *draw.level, draw.model_view_projection_matrix, positions_ndc);
+            else
+            {
+                positions_ndc->resize(draw.positions.size());
+                cgtub::transform_points(draw.model_view_projection_matrix, draw.positions, *positions_ndc);
+            }
+            transformed = &draw;
+        }
+
+        rasterize_mesh(
+            *positions_ndc,
+            draw.indices,
+            draw.color,
+            use_random_triangle_colors,
+            width,
+            height,
+            image,
+            zbuffer,
+            use_zbuffer,
+            show_zbuffer,
+            cull_behind_camera,
+            cull_front_faces,
+            vertex_cache,
+            draw.first_triangle,
+            stats);
+    }
+}
+
+void visualize_zbuffer(int width, int height, std::vector<float> const& zbuffer, std::vector<glm::vec3>* image)
+{
+    CGTUB_PROFILE_ZONE("post-process");
+
+    cgtub::parallel_for(size_t(width) * height, min_pixels_per_job, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t idx = begin; idx < end; ++idx)
+        {
+            float z           = zbuffer[idx];
+            float depth_color = 1.0f - (z + 1.0f) / 2.0f;
+            depth_color       = glm::clamp(depth_color, 0.0f, 1.0f);
+            (*image)[idx]     = glm::vec3(depth_color);
+        }
+    });
+}
+
+void visualize_overdraw(int width, int height, std::span<uint32_t const> overdraw, std::vector<glm::vec3>* image)
+{
+    CGTUB_PROFILE_ZONE("post-process");
+
+    // One color per count, so the number of layers can be read off the image
+    glm::vec3 const heat[] = {
+        glm::vec3(0.f, 0.f, 0.f),  // 0: not covered
+        glm::vec3(0.f, 0.f, 1.f),  // 1
+        glm::vec3(0.f, 1.f, 1.f),  // 2
+        glm::vec3(0.f, 1.f, 0.f),  // 3
+        glm::vec3(1.f, 1.f, 0.f),  // 4
+        glm::vec3(1.f, 0.5f, 0.f), // 5-7
+        glm::vec3(1.f, 0.f, 0.f),  // 8-15
+        glm::vec3(1.f, 1.f, 1.f),  // 16 and more
+    };
+
+    cgtub::parallel_for(size_t(width) * height, min_pixels_per_job, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t idx = begin; idx < end; ++idx)
+        {
+            uint32_t count = overdraw[idx];
+            size_t   level = count <= 4 ? count : count < 8 ? 5 : count < 16 ? 6 : 7;
+            (*image)[idx]  = heat[level];
+        }
+    });
+}
+
+std::vector<glm::mat4> create_grid_instances(int count, glm::vec3 const& origin, float spacing)
+{
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+
+    std::vector<glm::mat4> model_matrices(count);
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec3 offset(spacing * (i % side), 0.f, -spacing * (i / side));
+        model_matrices[i] = glm::translate(glm::mat4(1.f), origin + offset);
+    }
+
+    return model_matrices;
+}
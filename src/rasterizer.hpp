@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/bvh.hpp>
+#include <cgtub/lod.hpp>
+#include <cgtub/paged_mesh.hpp>
+#include <cgtub/vertex_cache.hpp>
+
+// The rasterization stages shared by the interactive and the headless executable
+
+void rasterize_lines(
+    std::span<glm::vec4 const> points,
+    std::span<glm::vec3 const> colors,
+    int                        width,
+    int                        height,
+    std::vector<glm::vec3>*    image,
+    std::vector<float>&        zbuffer,
+    bool                       use_zbuffer,
+    bool                       cull_behind_camera);
+
+// Output of the vertex stage, as stored in the post-transform vertex cache
+struct ScreenVertex
+{
+    glm::vec2 position; // Pixel coordinates
+    float     z;        // NDC depth
+    float     w;        // Homogeneous w (negative behind the camera)
+};
+
+using VertexCache = cgtub::PostTransformCache<ScreenVertex>;
+
+// Counters of the triangle rasterization, to see where the work goes (e.g. bounding box pixels that thin triangles do not cover)
+struct RasterStats
+{
+    uint64_t            triangles_submitted  = 0;
+    uint64_t            culled_behind_camera = 0;
+    uint64_t            culled_front_faces   = 0;
+    uint64_t            culled_degenerate    = 0;
+    uint64_t            culled_frustum       = 0; // Bounding box outside the image
+    uint64_t            pixels_tested        = 0; // Pixels in the bounding boxes of the triangles
+    uint64_t            pixels_covered       = 0; // Inside a triangle
+    uint64_t            pixels_depth_passed  = 0; // Covered, within the depth range and (with the z-buffer) closer than the z-buffer
+    uint64_t            pixels_written       = 0; // Color written
+    std::span<uint32_t> overdraw;                 // Covered pixels within the depth range, per pixel (not counted if empty)
+};
+
+// Adds the counters (not the overdraw)
+RasterStats& operator+=(RasterStats& stats, RasterStats const& other);
+
+void rasterize_mesh(
+    std::span<glm::vec4 const>    positions,
+    std::span<glm::u32vec3 const> indices,
+    glm::vec3 const&              color,
+    bool                          use_random_triangle_colors,
+    int                           width,
+    int                           height,
+    std::vector<glm::vec3>*       image,
+    std::vector<float>&           zbuffer,
+    bool                          use_zbuffer,
+    bool                          show_zbuffer,
+    bool                          cull_behind_camera,
+    bool                          cull_front_faces,
+    VertexCache*                  vertex_cache,
+    size_t                        first_triangle = 0,        // index of indices[0] in the full mesh (for random colors)
+    RasterStats*                  stats          = nullptr); // counted only if not null (in a separate instantiation)
+
+// A run of triangles of a mesh, prepared ahead of rasterization. The draw keeps the model-view-projection matrix,
+// its vertices are only transformed when it is rasterized (see `rasterize_draws`).
+struct MeshDraw
+{
+    std::span<glm::vec3 const>    positions;             // The vertices (of the box or a page), unless those of a level of detail are drawn
+    cgtub::LodMeshView const*     mesh  = nullptr;       // The mesh and level of detail whose vertices are drawn (if not null)
+    cgtub::LodLevelView const*    level = nullptr;
+    glm::mat4                     model_view_projection_matrix{1.f};
+    std::span<glm::u32vec3 const> indices;
+    size_t                        first_triangle = 0; // index of indices[0] in the full mesh (for random colors)
+    glm::vec3                     color{1.f};
+};
+
+// Builds a hierarchy over the world space bounds of the instances of a mesh
+void build_instance_bvh(cgtub::LodMeshView const& mesh, std::span<glm::mat4 const> model_matrices, cgtub::SceneBvh* bvh);
+
+// The geometry stages of a mesh drawn once per model matrix: culls the instances (through `instance_bvh`) and their meshlets,
+// picks the level of detail that matches the size of each instance on screen, and appends a draw per run of visible triangles
+void prepare_mesh_instanced(
+    cgtub::LodMeshView const&  mesh,
+    std::span<glm::mat4 const> model_matrices,
+    cgtub::SceneBvh const&     instance_bvh,
+    std::span<uint32_t>        lod_levels,
+    float                      lod_triangles_per_pixel,
+    glm::mat4 const&           view_matrix,
+    glm::mat4 const&           projection_matrix,
+    int                        height,
+    bool                       cull_front_faces,
+    glm::vec3 const&           color,
+    std::vector<uint32_t>*     visible_instances,
+    std::vector<MeshDraw>*     draws);
+
+// The geometry stages of an out-of-core mesh: appends a draw per page that passes the frustum and size tests (see `cgtub::PagedMesh::select_pages`)
+void prepare_paged_mesh(
+    cgtub::PagedMesh&      mesh,
+    glm::mat4 const&       model_matrix,
+    float                  min_page_area,
+    glm::mat4 const&       view_matrix,
+    glm::mat4 const&       projection_matrix,
+    int                    height,
+    glm::vec3 const&       color,
+    std::vector<uint32_t>* pages,
+    std::vector<MeshDraw>* draws);
+
+// Transforms the vertices of prepared draws into `positions_ndc` and rasterizes the draws in order (see `rasterize_mesh`).
+// Consecutive draws of the same vertices and matrix (e.g. the runs of one instance) share the transformed vertices,
+// so memory use does not grow with the number of draws.
+void rasterize_draws(
+    std::span<MeshDraw const> draws,
+    std::vector<glm::vec4>*   positions_ndc,
+    bool                      use_random_triangle_colors,
+    int                       width,
+    int                       height,
+    std::vector<glm::vec3>*   image,
+    std::vector<float>&       zbuffer,
+    bool                      use_zbuffer,
+    bool                      show_zbuffer,
+    bool                      cull_behind_camera,
+    bool                      cull_front_faces,
+    VertexCache*              vertex_cache,
+    RasterStats*              stats = nullptr);
+
+// Replace the image by a smooth visualization of the z-buffer
+void visualize_zbuffer(int width, int height, std::vector<float> const& zbuffer, std::vector<glm::vec3>* image);
+
+// Replace the image by the number of triangles that covered each pixel (see `RasterStats::overdraw`)
+void visualize_overdraw(int width, int height, std::span<uint32_t const> overdraw, std::vector<glm::vec3>* image);
+
+// Place `count` instances on a grid in the xz-plane, starting at `origin`
+std::vector<glm::mat4> create_grid_instances(int count, glm::vec3 const& origin, float spacing);
+
+namespace ex3
+{
+
+// Generate a unique, random color for the triangle with index `triangle_index`
+glm::vec3 get_random_color(size_t triangle_index);
+
+} // namespace ex3
@@ -0,0 +1,140 @@
+#include "render_pipeline.hpp"
+
+#include <utility>
+
+#include <cgtub/profiler.hpp>
+
+RenderPipeline::RenderPipeline(Scene& scene)
+    : m_scene(scene)
+{
+    m_free_frames.push(PreparedFrame{});
+    m_free_frames.push(PreparedFrame{});
+
+    m_geometry_thread = std::thread(&RenderPipeline::run_geometry, this);
+    m_raster_thread   = std::thread(&RenderPipeline::run_raster, this);
+}
+
+RenderPipeline::~RenderPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_request_condition.notify_one();
+    m_prepared_frames.close();
+    m_free_frames.close();
+
+    m_geometry_thread.join();
+    m_raster_thread.join();
+}
+
+void RenderPipeline::request(RenderRequest const& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_request      = request;
+        m_request_time = Clock::now();
+        m_has_request  = true;
+    }
+    m_request_condition.notify_one();
+}
+
+bool RenderPipeline::acquire_frame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_has_finished)
+        return false;
+
+    // The previously acquired image becomes the one the next finished frame is swapped into
+    std::swap(m_finished, m_acquired);
+    m_has_finished = false;
+    return true;
+}
+
+RenderedFrame const& RenderPipeline::frame() const
+{
+    return m_acquired;
+}
+
+void RenderPipeline::run_geometry()
+{
+    cgtub::set_profiler_thread_name("geometry");
+
+    int num_sphere_instances = static_cast<int>(m_scene.spheres.model_matrices.size());
+    while (true)
+    {
+        // Waits until the raster thread has taken the frame prepared before (the free frame is the one it rasterized last)
+        PreparedFrame frame;
+        if (!m_free_frames.pop(&frame))
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_request_condition.wait(lock, [this] { return m_stop || m_has_request; });
+            if (m_stop)
+                return;
+
+            frame.request      = m_request;
+            frame.request_time = m_request_time;
+            m_has_request      = false;
+        }
+
+        // The draws of the frame being rasterized only point into the meshes, which stay the same
+        RenderRequest const& request = frame.request;
+        if (request.num_sphere_instances != num_sphere_instances)
+        {
+            num_sphere_instances = request.num_sphere_instances;
+            set_sphere_instances(num_sphere_instances, &m_scene);
+        }
+
+        Clock::time_point start = Clock::now();
+        prepare_frame(m_scene, request.view_matrix, request.projection_matrix, request.settings, request.width, request.height, &m_lod_levels, &frame.geometry);
+        frame.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        if (!m_prepared_frames.push(std::move(frame)))
+            return;
+    }
+}
+
+void RenderPipeline::run_raster()
+{
+    cgtub::set_profiler_thread_name("render");
+
+    uint64_t index = 0;
+    while (true)
+    {
+        PreparedFrame frame;
+        if (!m_prepared_frames.pop(&frame))
+            return;
+
+        RenderRequest const& request = frame.request;
+        if (m_framebuffer.vertex_cache.replacement() != request.vertex_cache_replacement)
+            m_framebuffer.vertex_cache.set_replacement(request.vertex_cache_replacement);
+        m_framebuffer.vertex_cache.reset_counters();
+
+        // The image may have been swapped with one of an earlier size
+        resize_framebuffer(request.width, request.height, &m_framebuffer);
+
+        Clock::time_point start = Clock::now();
+        rasterize_frame(m_scene, frame.geometry, &m_framebuffer);
+        Clock::time_point end = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::swap(m_framebuffer.image, m_finished.image);
+            m_finished.width                 = m_framebuffer.width;
+            m_finished.height                = m_framebuffer.height;
+            m_finished.stats                 = m_framebuffer.stats;
+            m_finished.stats.overdraw        = {};
+            m_finished.vertex_cache_counters = m_framebuffer.vertex_cache.counters();
+            m_finished.index                 = index++;
+            m_finished.milliseconds          = frame.milliseconds + std::chrono::duration<double, std::milli>(end - start).count();
+            m_finished.latency               = std::chrono::duration<double, std::milli>(end - frame.request_time).count();
+            m_has_finished                   = true;
+        }
+
+        // Hands the geometry buffers back for the frame after the next one (never blocks, two frames circulate)
+        if (!m_free_frames.push(std::move(frame)))
+            return;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/bounded_queue.hpp>
+#include <cgtub/vertex_cache.hpp>
+
+#include "rasterizer.hpp"
+#include "scene.hpp"
+
+// What the render pipeline renders next
+struct RenderRequest
+{
+    glm::mat4               view_matrix{1.f};
+    glm::mat4               projection_matrix{1.f};
+    RenderSettings          settings;
+    int                     width                    = 0;
+    int                     height                   = 0;
+    int                     num_sphere_instances     = 1;
+    cgtub::CacheReplacement vertex_cache_replacement = cgtub::CacheReplacement::Fifo;
+};
+
+// A frame the render pipeline finished
+struct RenderedFrame
+{
+    std::vector<glm::vec3>     image;
+    int                        width  = 0;
+    int                        height = 0;
+    RasterStats                stats;                 // If collected (the overdraw counts are not kept)
+    cgtub::VertexCacheCounters vertex_cache_counters; // Of this frame
+    uint64_t                   index        = 0;      // Counts the frames the pipeline rendered
+    double                     milliseconds = 0.0;    // Time spent in the geometry and raster stages
+    double                     latency      = 0.0;    // Milliseconds from the request to the finished frame
+};
+
+/**
+ * \brief Renders frames in a pipeline of two threads, so that slow frames do not hold up the event loop.
+ *
+ * The geometry thread culls and selects the levels of detail of the latest request (see
+ * \c prepare_frame), while the raster thread transforms and rasterizes the frame prepared before (see
+ * \c rasterize_frame) and the event loop uploads the frame finished before that. Between the geometry
+ * and the raster thread, a queue holds at most one prepared frame, so a frame waits at most for
+ * one other frame to be rasterized.
+ *
+ * The finished images are triple-buffered: the raster thread renders into its framebuffer, the frame
+ * it finished last waits to be acquired and the frame acquired before is displayed. Neither thread
+ * waits for the event loop: a finished frame replaces a waiting one that was not acquired, and a
+ * request replaces one that was not started, so the pipeline renders the latest request and the
+ * event loop displays the latest frame.
+ *
+ * The pipeline owns the scene while it runs, changes to it (e.g. the number of spheres) are requested.
+ */
+class RenderPipeline
+{
+public:
+    // Starts the threads, which wait for the first request
+    explicit RenderPipeline(Scene& scene);
+
+    // Drops the frames in flight and joins the threads
+    ~RenderPipeline();
+
+    RenderPipeline(RenderPipeline const&)            = delete;
+    RenderPipeline& operator=(RenderPipeline const&) = delete;
+
+    // Requests a frame (replacing the previous request, if the geometry thread did not start it yet)
+    void request(RenderRequest const& request);
+
+    /**
+     * \brief Acquires the latest finished frame, if a frame was finished since the last call.
+     *
+     * The acquired frame (see \c frame) stays unchanged until the next frame is acquired.
+     *
+     * \return False if no frame was finished since the last call (the acquired frame stays the same).
+     */
+    bool acquire_frame();
+
+    // The frame acquired last
+    RenderedFrame const& frame() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // A frame passed from the geometry to the raster thread
+    struct PreparedFrame
+    {
+        RenderRequest     request;
+        Clock::time_point request_time;
+        FrameGeometry     geometry;
+        double            milliseconds = 0.0; // Time spent in the geometry stage
+    };
+
+    void run_geometry();
+
+    void run_raster();
+
+    Scene& m_scene;
+
+    // Two prepared frames circulate between the stages: one is prepared while the other is rasterized
+    cgtub::BoundedQueue<PreparedFrame> m_prepared_frames{1};
+    cgtub::BoundedQueue<PreparedFrame> m_free_frames{2};
+
+    std::vector<std::vector<uint32_t>> m_lod_levels;  // Only used by the geometry thread
+    Framebuffer                        m_framebuffer; // Only used by the raster thread
+    RenderedFrame                      m_finished;    // Waiting to be acquired
+    RenderedFrame                      m_acquired;    // Only used by the caller
+    bool                               m_has_finished{false};
+    RenderRequest                      m_request;
+    Clock::time_point                  m_request_time;
+    bool                               m_has_request{false};
+    bool                               m_stop{false};
+    std::mutex                         m_mutex; // Guards the finished frame, the request and the flags
+    std::condition_variable            m_request_condition;
+    std::thread                        m_geometry_thread;
+    std::thread                        m_raster_thread;
+};
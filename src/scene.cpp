@@ -0,0 +1,432 @@
+#include "scene.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cgtub/compositing.hpp>
+#include <cgtub/culling.hpp>
+#include <cgtub/geometry.hpp>
+#include <cgtub/ply_loader.hpp>
+#include <cgtub/profiler.hpp>
+#include <cgtub/threading.hpp>
+#include <cgtub/vertex_transform.hpp>
+
+bool load_instanced_meshes(std::filesystem::path const& path, MeshFile* file, std::vector<InstancedMesh>* meshes)
+{
+    std::string extension = path.extension().string();
+    if (extension == ".glb" || extension == ".gltf")
+    {
+        if (!file->gltf_scene.open(path))
+            return false;
+
+        // One instanced draw per primitive, with one instance per node that references its mesh
+        for (uint32_t mesh = 0; mesh < file->gltf_scene.meshes().size(); ++mesh)
+        {
+            for (cgtub::GltfPrimitive const& primitive : file->gltf_scene.meshes()[mesh].primitives)
+            {
+                InstancedMesh instanced_mesh;
+                instanced_mesh.mesh.positions = primitive.positions;
+                instanced_mesh.mesh.bounds    = primitive.bounds;
+                instanced_mesh.mesh.levels.push_back(cgtub::LodLevelView{0, static_cast<uint32_t>(primitive.positions.size()), primitive.indices, {}});
+                for (cgtub::GltfInstance const& instance : file->gltf_scene.instances())
+                    if (instance.mesh == mesh)
+                        instanced_mesh.model_matrices.push_back(instance.model_matrix);
+
+                if (!instanced_mesh.model_matrices.empty())
+                    meshes->push_back(std::move(instanced_mesh));
+            }
+        }
+    }
+    else if (extension == ".ply")
+    {
+        // Large scans are converted once (without loading them) into a paged file next to them, later runs only map that file
+        std::filesystem::path paged_path = path;
+        paged_path += ".cgpages";
+
+        std::error_code                 error;
+        std::filesystem::file_time_type mesh_time    = std::filesystem::last_write_time(path, error);
+        std::filesystem::file_time_type paged_time   = std::filesystem::last_write_time(paged_path, error);
+        bool                            is_converted = !error && paged_time >= mesh_time;
+        if (!is_converted)
+        {
+            uint64_t vertex_count = 0;
+            uint64_t face_count   = 0;
+            if (!cgtub::read_ply_counts(path, &vertex_count, &face_count))
+                return false;
+
+            is_converted = face_count >= out_of_core_triangles && cgtub::convert_ply_to_paged_mesh(path, paged_path);
+        }
+
+        if (is_converted && file->paged_mesh.open(paged_path))
+            file->is_paged = true;
+        else if (!cgtub::load_ply(path, &file->xs, &file->ys, &file->zs, &file->indices))
+            return false;
+    }
+
+    if (extension == ".ply" && !file->is_paged)
+    {
+        // Smaller scans are drawn as loaded, without levels of detail
+        InstancedMesh instanced_mesh;
+        instanced_mesh.mesh.xs     = file->xs;
+        instanced_mesh.mesh.ys     = file->ys;
+        instanced_mesh.mesh.zs     = file->zs;
+        instanced_mesh.mesh.bounds = cgtub::compute_bounding_sphere(file->xs, file->ys, file->zs);
+        instanced_mesh.mesh.levels.push_back(cgtub::LodLevelView{0, static_cast<uint32_t>(file->xs.size()), file->indices, {}});
+        instanced_mesh.model_matrices.push_back(glm::mat4(1.f));
+        meshes->push_back(std::move(instanced_mesh));
+    }
+    else if (extension != ".ply")
+    {
+        if (!cgtub::load_mesh_cached(path, &file->cached_mesh))
+            return false;
+
+        InstancedMesh instanced_mesh;
+        instanced_mesh.mesh = file->cached_mesh.view();
+        instanced_mesh.model_matrices.push_back(glm::mat4(1.f));
+        meshes->push_back(std::move(instanced_mesh));
+    }
+
+    // Fit the bounds of all instances into a sphere of radius 0.5 next to the box
+    cgtub::Aabb scene_bounds{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+    if (file->is_paged)
+        scene_bounds = cgtub::compute_aabb(file->paged_mesh.bounds());
+    for (InstancedMesh const& instanced_mesh : *meshes)
+    {
+        for (glm::mat4 const& model_matrix : instanced_mesh.model_matrices)
+        {
+            cgtub::Aabb bounds = cgtub::compute_aabb(cgtub::transform_bounding_sphere(model_matrix, instanced_mesh.mesh.bounds));
+            scene_bounds.min   = glm::min(scene_bounds.min, bounds.min);
+            scene_bounds.max   = glm::max(scene_bounds.max, bounds.max);
+        }
+    }
+
+    glm::vec3 center     = 0.5f * (scene_bounds.min + scene_bounds.max);
+    float     radius     = 0.5f * glm::length(scene_bounds.max - scene_bounds.min);
+    glm::mat4 fit_matrix = glm::translate(glm::mat4(1.f), glm::vec3(-1.5f, 0.f, 0.f)) *
+                           glm::scale(glm::mat4(1.f), glm::vec3(0.5f / std::max(radius, 1e-6f))) *
+                           glm::translate(glm::mat4(1.f), -center);
+    for (InstancedMesh& instanced_mesh : *meshes)
+    {
+        for (glm::mat4& model_matrix : instanced_mesh.model_matrices)
+            model_matrix = fit_matrix * model_matrix;
+        build_instance_bvh(instanced_mesh.mesh, instanced_mesh.model_matrices, &instanced_mesh.instance_bvh);
+    }
+    file->paged_model_matrix = fit_matrix;
+
+    return true;
+}
+
+void create_scene(int num_sphere_instances, Scene* scene)
+{
+    scene->axes_start_end = {
+        glm::vec3(0, 0, 0),
+        glm::vec3(1, 0, 0),
+        glm::vec3(0, 0, 0),
+        glm::vec3(0, 1, 0),
+        glm::vec3(0, 0, 0),
+        glm::vec3(0, 0, 1),
+    };
+    scene->axes_colors = {
+        glm::vec3(1, 0, 0),
+        glm::vec3(0, 1, 0),
+        glm::vec3(0, 0, 1),
+    };
+
+    cgtub::create_box_geometry(0.5f, &scene->box_vertices, &scene->box_indices);
+
+    // The sphere mesh is shared by all sphere instances, which are placed by their model matrices
+    // Each instance draws the level of detail that matches its size on screen (see `select_lod_level`)
+    cgtub::create_sphere_lod_mesh(16, 16, glm::vec3(0.5f), 3, &scene->sphere_mesh);
+    cgtub::build_lod_meshlets(&scene->sphere_mesh);
+    scene->spheres.mesh = cgtub::make_lod_mesh_view(scene->sphere_mesh);
+    set_sphere_instances(num_sphere_instances, scene);
+}
+
+void set_sphere_instances(int count, Scene* scene)
+{
+    scene->spheres.model_matrices = create_grid_instances(count, glm::vec3(1, 0, 0), 1.25f);
+    build_instance_bvh(scene->spheres.mesh, scene->spheres.model_matrices, &scene->spheres.instance_bvh);
+}
+
+void resize_framebuffer(int width, int height, Framebuffer* framebuffer)
+{
+    framebuffer->width  = width;
+    framebuffer->height = height;
+    framebuffer->image.resize(width * height);
+    framebuffer->zbuffer.resize(width * height);
+}
+
+namespace
+{
+
+// The levels of detail of the instances of a mesh in the previous frame, reset if the instances have changed
+std::span<uint32_t> get_lod_levels(std::vector<std::vector<uint32_t>>* lod_levels, size_t mesh, InstancedMesh const& instanced_mesh)
+{
+    std::vector<uint32_t>& levels = (*lod_levels)[mesh];
+    if (levels.size() != instanced_mesh.model_matrices.size())
+        levels.assign(instanced_mesh.model_matrices.size(), 0);
+    return std::span<uint32_t>(levels);
+}
+
+// Clears image and z-buffer (and the statistics, if they are counted)
+RasterStats* clear_framebuffer(RenderSettings const& settings, Framebuffer* framebuffer)
+{
+    CGTUB_PROFILE_ZONE("clear");
+    std::fill(framebuffer->image.begin(), framebuffer->image.end(), glm::vec3(0.0f));
+    std::fill(framebuffer->zbuffer.begin(), framebuffer->zbuffer.end(), 1.0f);
+
+    if (settings.show_overdraw)
+        framebuffer->overdraw.assign(framebuffer->width * framebuffer->height, 0);
+
+    RasterStats* stats = settings.collect_stats || settings.show_overdraw ? &framebuffer->stats : nullptr;
+    if (stats)
+        *stats = RasterStats{.overdraw = settings.show_overdraw ? std::span<uint32_t>(framebuffer->overdraw) : std::span<uint32_t>()};
+    return stats;
+}
+
+// The sort-last path gives every layer at least this many triangles, so small frames are not split
+constexpr size_t min_triangles_per_layer = size_t(1) << 10;
+
+// Per-pixel passes over the layers split the image into jobs of at least this many pixels
+constexpr size_t min_pixels_per_job = size_t(1) << 14;
+
+// The number of layers the sort-last path splits the draws into (1 if it is not worth it)
+size_t count_layers(RenderSettings const& settings, std::span<MeshDraw const> draws)
+{
+    // Without the z-buffer, the last draw covering a pixel wins, which the depths cannot tell
+    if (!settings.sort_last || !settings.use_zbuffer)
+        return 1;
+
+    size_t triangles = 0;
+    for (MeshDraw const& draw : draws)
+        triangles += draw.indices.size();
+
+    size_t thread_count = cgtub::is_serial_scope() ? 1 : cgtub::job_thread_count();
+    return std::clamp<size_t>(triangles / min_triangles_per_layer, 1, thread_count);
+}
+
+// Splits the draws into consecutive parts of about the same number of triangles, one per layer (splitting draws where needed)
+void split_draws(std::span<MeshDraw const> draws, std::span<DrawLayer> layers)
+{
+    size_t triangles = 0;
+    for (MeshDraw const& draw : draws)
+        triangles += draw.indices.size();
+
+    size_t triangles_per_layer = (triangles + layers.size() - 1) / layers.size();
+    size_t layer               = 0;
+    size_t layer_triangles     = 0;
+    for (DrawLayer& draw_layer : layers)
+        draw_layer.draws.clear();
+
+    for (MeshDraw const& draw : draws)
+    {
+        for (size_t first = 0; first < draw.indices.size();)
+        {
+            if (layer_triangles == triangles_per_layer && layer + 1 < layers.size())
+            {
+                ++layer;
+                layer_triangles = 0;
+            }
+
+            // The triangle index keeps the random colors of the split draw
+            size_t    count = std::min(draw.indices.size() - first, triangles_per_layer - layer_triangles);
+            MeshDraw& part  = layers[layer].draws.emplace_back(draw);
+            part.indices    = draw.indices.subspan(first, count);
+            part.first_triangle += first;
+            first += count;
+            layer_triangles += count;
+        }
+    }
+}
+
+// Rasterizes every part of the draws on its own thread into its own layer, then merges the layers into the framebuffer by depth
+void rasterize_sort_last(FrameGeometry const& geometry, size_t layer_count, RasterStats* stats, Framebuffer* framebuffer)
+{
+    RenderSettings const& settings = geometry.settings;
+    size_t                pixels   = static_cast<size_t>(framebuffer->width) * framebuffer->height;
+
+    framebuffer->layers.resize(layer_count);
+    split_draws(geometry.draws, framebuffer->layers);
+
+    cgtub::parallel_for(layer_count, 1, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            DrawLayer& layer = framebuffer->layers[i];
+
+            // Pixels no draw of the layer covers keep the cleared depth, which never wins the composite, so their color is never read
+            layer.image.resize(pixels);
+            layer.zbuffer.assign(pixels, 1.0f);
+            if (settings.show_overdraw)
+                layer.overdraw.assign(pixels, 0);
+            layer.stats = RasterStats{.overdraw = settings.show_overdraw ? std::span<uint32_t>(layer.overdraw) : std::span<uint32_t>()};
+
+            if (layer.vertex_cache.replacement() != framebuffer->vertex_cache.replacement())
+                layer.vertex_cache.set_replacement(framebuffer->vertex_cache.replacement());
+            layer.vertex_cache.reset_counters();
+
+            rasterize_draws(
+                layer.draws,
+                &layer.positions_ndc,
+                settings.use_random_triangle_colors,
+                framebuffer->width,
+                framebuffer->height,
+                &layer.image,
+                layer.zbuffer,
+                true,
+                settings.show_zbuffer,
+                settings.cull_behind_camera,
+                settings.cull_front_faces,
+                &layer.vertex_cache,
+                stats ? &layer.stats : nullptr);
+        }
+    });
+
+    CGTUB_PROFILE_ZONE("composite");
+
+    // The layers are merged in the order of the draws, so equal depths resolve as if the draws were rasterized in order
+    std::vector<cgtub::DepthLayer> depth_layers;
+    for (DrawLayer const& layer : framebuffer->layers)
+    {
+        depth_layers.push_back(cgtub::DepthLayer{layer.zbuffer, layer.image});
+        framebuffer->vertex_cache.add_counters(layer.vertex_cache.counters());
+        if (stats)
+            *stats += layer.stats;
+    }
+    cgtub::composite_depth(depth_layers, framebuffer->zbuffer, framebuffer->image);
+
+    if (settings.show_overdraw)
+    {
+        cgtub::parallel_for(pixels, min_pixels_per_job, 1, [&](size_t begin, size_t end)
+        {
+            for (DrawLayer const& layer : framebuffer->layers)
+            {
+                for (size_t i = begin; i < end; ++i)
+                    framebuffer->overdraw[i] += layer.overdraw[i];
+            }
+        });
+    }
+}
+
+} // namespace
+
+void render_scene(Scene& scene, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix, RenderSettings const& settings, Framebuffer* framebuffer)
+{
+    // The same stages as in the render pipeline, one after the other
+    prepare_frame(scene, view_matrix, projection_matrix, settings, framebuffer->width, framebuffer->height, &framebuffer->lod_levels, &framebuffer->geometry);
+    rasterize_frame(scene, framebuffer->geometry, framebuffer);
+}
+
+void prepare_frame(Scene& scene, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix, RenderSettings const& settings, int width, int height,
+                   std::vector<std::vector<uint32_t>>* lod_levels, FrameGeometry* geometry)
+{
+    geometry->width    = width;
+    geometry->height   = height;
+    geometry->settings = settings;
+    geometry->draws.clear();
+
+    // The levels of detail of the previous frame (for the hysteresis)
+    lod_levels->resize(scene.loaded_meshes.size() + 1);
+
+    // The coordinate axes are rasterized first, then the box, the loaded mesh and the spheres
+    glm::mat4 view_projection_matrix = projection_matrix * view_matrix;
+    {
+        CGTUB_PROFILE_ZONE("transform");
+        geometry->axes_start_end_ndc.resize(scene.axes_start_end.size());
+        cgtub::transform_points(view_projection_matrix, scene.axes_start_end, geometry->axes_start_end_ndc);
+    }
+    geometry->draws.push_back(MeshDraw{scene.box_vertices, nullptr, nullptr, view_projection_matrix, scene.box_indices, 0, scene.box_color});
+
+    if (scene.loaded_file.is_paged)
+    {
+        prepare_paged_mesh(
+            scene.loaded_file.paged_mesh,
+            scene.loaded_file.paged_model_matrix,
+            scene.min_page_area,
+            view_matrix,
+            projection_matrix,
+            height,
+            scene.loaded_color,
+            &geometry->visible_pages,
+            &geometry->draws);
+    }
+
+    for (size_t mesh = 0; mesh < scene.loaded_meshes.size(); ++mesh)
+    {
+        InstancedMesh const& loaded = scene.loaded_meshes[mesh];
+        prepare_mesh_instanced(
+            loaded.mesh,
+            loaded.model_matrices,
+            loaded.instance_bvh,
+            get_lod_levels(lod_levels, mesh, loaded),
+            scene.lod_triangles_per_pixel,
+            view_matrix,
+            projection_matrix,
+            height,
+            settings.cull_front_faces,
+            scene.loaded_color,
+            &geometry->visible_instances,
+            &geometry->draws);
+    }
+
+    prepare_mesh_instanced(
+        scene.spheres.mesh,
+        scene.spheres.model_matrices,
+        scene.spheres.instance_bvh,
+        get_lod_levels(lod_levels, scene.loaded_meshes.size(), scene.spheres),
+        scene.lod_triangles_per_pixel,
+        view_matrix,
+        projection_matrix,
+        height,
+        settings.cull_front_faces,
+        scene.sphere_color,
+        &geometry->visible_instances,
+        &geometry->draws);
+}
+
+void rasterize_frame(Scene const& scene, FrameGeometry const& geometry, Framebuffer* framebuffer)
+{
+    RenderSettings const& settings = geometry.settings;
+    int                   width    = framebuffer->width;
+    int                   height   = framebuffer->height;
+
+    RasterStats* stats = clear_framebuffer(settings, framebuffer);
+
+    rasterize_lines(
+        geometry.axes_start_end_ndc,
+        scene.axes_colors,
+        width,
+        height,
+        &framebuffer->image,
+        framebuffer->zbuffer,
+        settings.use_zbuffer,
+        settings.cull_behind_camera);
+
+    size_t layer_count = count_layers(settings, geometry.draws);
+    if (layer_count > 1)
+        rasterize_sort_last(geometry, layer_count, stats, framebuffer);
+    else
+    {
+        rasterize_draws(
+            geometry.draws,
+            &framebuffer->positions_ndc,
+            settings.use_random_triangle_colors,
+            width,
+            height,
+            &framebuffer->image,
+            framebuffer->zbuffer,
+            settings.use_zbuffer,
+            settings.show_zbuffer,
+            settings.cull_behind_camera,
+            settings.cull_front_faces,
+            &framebuffer->vertex_cache,
+            stats);
+    }
+
+    if (settings.show_overdraw)
+        visualize_overdraw(width, height, framebuffer->overdraw, &framebuffer->image);
+    else if (settings.show_zbuffer)
+        visualize_zbuffer(width, height, framebuffer->zbuffer, &framebuffer->image);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cgtub/bvh.hpp>
+#include <cgtub/gltf_loader.hpp>
+#include <cgtub/lod.hpp>
+#include <cgtub/mesh_cache.hpp>
+#include <cgtub/paged_mesh.hpp>
+
+#include "rasterizer.hpp"
+
+// A mesh drawn once per model matrix (see `prepare_mesh_instanced`)
+struct InstancedMesh
+{
+    cgtub::LodMeshView     mesh;
+    std::vector<glm::mat4> model_matrices;
+    cgtub::SceneBvh        instance_bvh;
+};
+
+// The data of a mesh file, depending on its format (the instanced meshes point into it)
+struct MeshFile
+{
+    cgtub::CachedMesh         cached_mesh; // OBJ
+    cgtub::GltfScene          gltf_scene;  // glTF
+    std::vector<float>        xs;          // PLY
+    std::vector<float>        ys;
+    std::vector<float>        zs;
+    std::vector<glm::u32vec3> indices;
+    cgtub::PagedMesh          paged_mesh; // Large PLY (rendered out of core)
+    bool                      is_paged = false;
+    glm::mat4                 paged_model_matrix{1.f};
+};
+
+// PLY meshes with at least this many faces are converted to paged meshes and rendered out of core
+constexpr size_t out_of_core_triangles = size_t(1) << 22;
+
+// Loads the mesh file passed on the command line: OBJ files through their binary cache, glTF files with their node hierarchy
+// and PLY files straight into coordinate arrays (or, if they are large, through a paged file for out-of-core rendering).
+// Everything is scaled to fit next to the box.
+bool load_instanced_meshes(std::filesystem::path const& path, MeshFile* file, std::vector<InstancedMesh>* meshes);
+
+// The scene geometry: a coordinate system, a box, instanced spheres and an optional mesh file.
+// The views point into the scene, so it must not be moved once it is created.
+struct Scene
+{
+    std::vector<glm::vec3>     axes_start_end;
+    std::vector<glm::vec3>     axes_colors;
+    std::vector<glm::vec3>     box_vertices;
+    std::vector<glm::u32vec3>  box_indices;
+    glm::vec3                  box_color{1.f};
+    cgtub::LodMesh             sphere_mesh;
+    InstancedMesh              spheres;
+    glm::vec3                  sphere_color{0.f, 1.f, 0.f};
+    MeshFile                   loaded_file;
+    std::vector<InstancedMesh> loaded_meshes;
+    glm::vec3                  loaded_color{0.8f, 0.6f, 0.2f};
+    float                      lod_triangles_per_pixel = 0.25f; // Triangles per (image) pixel the level of detail selection aims for
+    float                      min_page_area           = 4.f;   // Pages of out-of-core meshes covering fewer pixels are not drawn (and not paged in)
+};
+
+// Creates the coordinate system, the box and `num_sphere_instances` spheres
+void create_scene(int num_sphere_instances, Scene* scene);
+
+// Places `count` sphere instances on a grid next to the box
+void set_sphere_instances(int count, Scene* scene);
+
+struct RenderSettings
+{
+    bool use_random_triangle_colors = false;
+    bool use_zbuffer                = true;
+    bool show_zbuffer               = false;
+    bool show_overdraw              = false; // Show how many triangles covered each pixel instead of the colors
+    bool collect_stats              = false; // Count the work of the rasterizer (see `RasterStats`)
+    bool cull_behind_camera         = false;
+    bool cull_front_faces           = false;
+    bool sort_last                  = false; // Rasterize parts of the draws in parallel into private layers and merge them by depth (needs the z-buffer)
+};
+
+// A frame after the geometry stages (culling and level of detail selection), ready to be rasterized.
+// Keeping it separate from the framebuffer lets the geometry of the next frame be prepared while the previous one is rasterized.
+// The draws keep their matrices instead of transformed vertices, so its size does not grow with the vertices drawn.
+struct FrameGeometry
+{
+    int                    width  = 0; // Of the framebuffer the frame is prepared for (levels of detail depend on it)
+    int                    height = 0;
+    RenderSettings         settings;
+    std::vector<glm::vec4> axes_start_end_ndc;
+    std::vector<MeshDraw>  draws; // In the order they are rasterized
+    std::vector<uint32_t>  visible_instances;
+    std::vector<uint32_t>  visible_pages;
+};
+
+// The private image and z-buffer a part of the draws is rasterized into by the sort-last path (see `rasterize_frame`)
+struct DrawLayer
+{
+    std::vector<glm::vec3> image;
+    std::vector<float>     zbuffer;
+    VertexCache            vertex_cache;
+    std::vector<glm::vec4> positions_ndc; // Transformed vertices of the current draw
+    std::vector<MeshDraw>  draws;         // The part of the draws of the last frame
+    RasterStats            stats;         // Of the last frame (if collected)
+    std::vector<uint32_t>  overdraw;      // Of the last frame (if shown)
+};
+
+// The image and z-buffer of a frame, together with the scratch buffers of the rasterization stages
+// Each thread that renders frames needs its own framebuffer.
+struct Framebuffer
+{
+    int                                width  = 0;
+    int                                height = 0;
+    std::vector<glm::vec3>             image;
+    std::vector<float>                 zbuffer;
+    std::vector<glm::vec4>             positions_ndc; // Transformed vertices of the current draw (see `rasterize_draws`)
+    std::vector<std::vector<uint32_t>> lod_levels;    // Per instance of the loaded meshes, then the spheres (kept for the hysteresis)
+    VertexCache                        vertex_cache;  // Post-transform cache of the projected mesh vertices
+    RasterStats                        stats;         // Of the last frame (if collected)
+    std::vector<uint32_t>              overdraw;      // Of the last frame (if shown)
+    FrameGeometry                      geometry;      // Of `render_scene`
+    std::vector<DrawLayer>             layers;        // Of the sort-last path, one per thread
+};
+
+void resize_framebuffer(int width, int height, Framebuffer* framebuffer);
+
+/**
+ * \brief Renders the scene into a framebuffer (\c prepare_frame followed by \c rasterize_frame).
+ *
+ * Frames may be rendered in parallel into different framebuffers.
+ *
+ * \param[in]     scene             The scene (the resident pages of an out-of-core mesh are updated).
+ * \param[in]     view_matrix       The view matrix.
+ * \param[in]     projection_matrix The projection matrix.
+ * \param[in]     settings          The rasterization settings.
+ * \param[in,out] framebuffer       The framebuffer (image and z-buffer are cleared first).
+ */
+void render_scene(Scene& scene, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix, RenderSettings const& settings, Framebuffer* framebuffer);
+
+/**
+ * \brief Runs the geometry stages of a frame: culling and level of detail selection.
+ *
+ * The draws point into the scene, so only the instances (e.g. \c set_sphere_instances) may change until they are rasterized.
+ *
+ * \param[in]     scene             The scene (the resident pages of an out-of-core mesh are updated).
+ * \param[in]     view_matrix       The view matrix.
+ * \param[in]     projection_matrix The projection matrix.
+ * \param[in]     settings          The rasterization settings (kept for \c rasterize_frame).
+ * \param[in]     width             The width of the framebuffer.
+ * \param[in]     height            The height of the framebuffer.
+ * \param[in,out] lod_levels        The levels of detail of the previous frame (for the hysteresis, see \c Framebuffer).
+ * \param[out]    geometry          The prepared frame.
+ */
+void prepare_frame(Scene& scene, glm::mat4 const& view_matrix, glm::mat4 const& projection_matrix, RenderSettings const& settings, int width, int height,
+                   std::vector<std::vector<uint32_t>>* lod_levels, FrameGeometry* geometry);
+
+/**
+ * \brief Runs the raster stages of a prepared frame: vertex transform, rasterization and post-processing.
+ *
+ * With \c RenderSettings::sort_last, the triangles of the draws are split into consecutive parts, one per thread of the job
+ * system, and every part is rasterized in parallel into a layer of its own (see \c DrawLayer). The layers are then merged
+ * by depth in draw order (see \c cgtub::composite_depth), so the image stays the same. The statistics count the depth
+ * tests of each layer on its own, so more pixels pass them than in order.
+ *
+ * \param[in]     scene       The scene the frame was prepared from.
+ * \param[in]     geometry    The prepared frame.
+ * \param[in,out] framebuffer The framebuffer, of the size the frame was prepared for (image and z-buffer are cleared first).
+ */
+void rasterize_frame(Scene const& scene, FrameGeometry const& geometry, Framebuffer* framebuffer);
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cgtub/camera.hpp>
+#include <cgtub/camera_perspective.hpp>
+#include <cgtub/image.hpp>
+#include <cgtub/lod.hpp>
+#include <cgtub/threading.hpp>
+
+#include "scene.hpp"
+
+// Regression test of the rasterizer: renders fixed camera poses of the box, sphere and torus scenes,
+// compares the images with stored references and the frame times with a baseline recorded on this machine.
+
+namespace
+{
+
+struct Options
+{
+    std::filesystem::path references;                // Reference images
+    std::filesystem::path output_directory = ".";    // Rendered and difference images of failed cases
+    std::filesystem::path baseline;                  // Frame time baseline of this machine (required to check the times)
+    bool                  check_images     = false;
+    bool                  check_times      = false;
+    bool                  update           = false;  // Replace the references instead of comparing
+    float                 pixel_tolerance  = 0.02f;  // Largest color difference of a pixel that still matches
+    float                 max_mismatches   = 0.001f; // Largest fraction of pixels that may not match
+    float                 time_threshold   = 1.5f;   // Largest ratio of frame time to baseline
+    int                   runs             = 31;
+};
+
+enum class SceneKind
+{
+    Box,
+    Sphere, // The scene of the original exercise: box and one sphere
+    Spheres,
+    Torus
+};
+
+struct TestCase
+{
+    char const*    name;
+    SceneKind      scene;
+    float          azimuth;
+    float          elevation;
+    float          distance;
+    RenderSettings settings;
+};
+
+// Image size of the reference images and of the timed frames
+constexpr int image_width  = 160;
+constexpr int image_height = 120;
+constexpr int time_width   = 640;
+constexpr int time_height  = 480;
+
+RenderSettings make_settings(bool use_random_triangle_colors, bool show_zbuffer, bool cull_front_faces, bool show_overdraw = false)
+{
+    RenderSettings settings;
+    settings.use_random_triangle_colors = use_random_triangle_colors;
+    settings.show_zbuffer               = show_zbuffer;
+    settings.cull_front_faces           = cull_front_faces;
+    settings.show_overdraw              = show_overdraw;
+    return settings;
+}
+
+// The references of the box and sphere cases were rendered by the rasterizer of the original exercise, which
+// drew that scene (so they also catch changes made since). That rasterizer had no instancing, levels of detail,
+// meshes or overdraw view, and random colors of the sphere follow its triangle order, which the vertex cache
+// optimization changed: the other references were rendered by this renderer when their cases were added.
+TestCase const test_cases[] = {
+    {"box_front", SceneKind::Box, 0.f, 0.3f, 2.f, make_settings(false, false, false)},
+    {"box_above_cull_front_faces", SceneKind::Box, 2.2f, 0.9f, 3.f, make_settings(false, false, true)},
+    {"box_random_colors", SceneKind::Box, 0.6f, 0.3f, 2.5f, make_settings(true, false, false)},
+    {"sphere_front", SceneKind::Sphere, 0.6f, 0.3f, 2.5f, make_settings(false, false, false)},
+    {"sphere_zbuffer", SceneKind::Sphere, -0.4f, 0.5f, 3.f, make_settings(false, true, false)},
+    {"spheres_front", SceneKind::Spheres, 0.f, 0.3f, 2.5f, make_settings(false, false, false)},
+    {"spheres_far", SceneKind::Spheres, 0.8f, 0.5f, 4.f, make_settings(false, false, false)},
+    {"torus_front", SceneKind::Torus, -1.1f, 0.3f, 3.2f, make_settings(false, false, false)},
+    {"torus_random_colors", SceneKind::Torus, -1.1f, 0.3f, 3.2f, make_settings(true, false, false)},
+    {"torus_zbuffer", SceneKind::Torus, -1.4f, 0.6f, 3.f, make_settings(false, true, false)},
+    {"spheres_overdraw", SceneKind::Spheres, 0.8f, 0.5f, 4.f, make_settings(false, false, false, true)},
+};
+
+// Renders test cases of one scene, which is created on construction
+class SceneRenderer
+{
+public:
+    explicit SceneRenderer(SceneKind kind)
+    {
+        create_scene(kind == SceneKind::Spheres ? 9 : kind == SceneKind::Sphere ? 1 : 0, &m_scene);
+
+        // The torus is placed next to the box, where a mesh passed to the executables would be
+        if (kind == SceneKind::Torus)
+        {
+            cgtub::create_torus_lod_mesh(48, 24, glm::vec3(0.15f), glm::vec3(0.35f), 3, &m_torus_mesh);
+            cgtub::build_lod_meshlets(&m_torus_mesh);
+
+            InstancedMesh torus;
+            torus.mesh           = cgtub::make_lod_mesh_view(m_torus_mesh);
+            torus.model_matrices = {glm::translate(glm::mat4(1.f), glm::vec3(-1.5f, 0.f, 0.f))};
+            build_instance_bvh(torus.mesh, torus.model_matrices, &torus.instance_bvh);
+            m_scene.loaded_meshes.push_back(std::move(torus));
+        }
+    }
+
+    void render(TestCase const& test_case, int width, int height, Framebuffer* framebuffer)
+    {
+        cgtub::PerspectiveCamera camera(45.f, static_cast<float>(width) / height, 1.f, 4.5f);
+        glm::mat4                view_matrix = cgtub::build_turntable_view_matrix(test_case.azimuth, test_case.elevation, test_case.distance);
+
+        // Every frame starts from the same state, so the levels of detail do not depend on earlier frames
+        framebuffer->lod_levels.clear();
+        if (framebuffer->width != width || framebuffer->height != height)
+            resize_framebuffer(width, height, framebuffer);
+        render_scene(m_scene, view_matrix, camera.projection(), test_case.settings, framebuffer);
+    }
+
+    // Renders through the separate geometry and raster stages of the render pipeline, which must give the same image
+    void render_prepared(TestCase const& test_case, int width, int height, FrameGeometry* geometry, Framebuffer* framebuffer)
+    {
+        cgtub::PerspectiveCamera camera(45.f, static_cast<float>(width) / height, 1.f, 4.5f);
+        glm::mat4                view_matrix = cgtub::build_turntable_view_matrix(test_case.azimuth, test_case.elevation, test_case.distance);
+
+        std::vector<std::vector<uint32_t>> lod_levels;
+        if (framebuffer->width != width || framebuffer->height != height)
+            resize_framebuffer(width, height, framebuffer);
+        prepare_frame(m_scene, view_matrix, camera.projection(), test_case.settings, width, height, &lod_levels, geometry);
+        rasterize_frame(m_scene, *geometry, framebuffer);
+    }
+
+private:
+    cgtub::LodMesh m_torus_mesh;
+    Scene          m_scene;
+};
+
+// Compares the rendered image with the reference image and writes both difference and rendered image on failure
+// (the variant names the way the image was rendered, if there are several)
+bool check_image(Options const& options, TestCase const& test_case, Framebuffer const& framebuffer, std::string const& variant = "")
+{
+    std::string name = variant.empty() ? std::string(test_case.name) : std::string(test_case.name) + "." + variant;
+
+    std::filesystem::path reference_path = options.references / (std::string(test_case.name) + ".png");
+    if (options.update)
+    {
+        std::printf("[update] %s\n", reference_path.string().c_str());
+        return cgtub::write_image(reference_path, framebuffer.image, framebuffer.width, framebuffer.height);
+    }
+
+    std::vector<glm::vec3> reference;
+    int                    width, height;
+    if (!cgtub::read_image(reference_path, &reference, &width, &height))
+    {
+        std::printf("[FAIL] %s: missing reference image (run with --update to create it)\n", name.c_str());
+        return false;
+    }
+    if (width != framebuffer.width || height != framebuffer.height)
+    {
+        std::printf("[FAIL] %s: reference image is %dx%d, rendered %dx%d\n", name.c_str(), width, height, framebuffer.width, framebuffer.height);
+        return false;
+    }
+
+    // The reference is quantized to 8 bits, so is the rendered image before comparing
+    std::vector<glm::vec3> difference(reference.size());
+    size_t                 mismatches     = 0;
+    float                  max_difference = 0.f;
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        glm::vec3 color = glm::round(glm::clamp(framebuffer.image[i], 0.f, 1.f) * 255.f) / 255.f;
+        difference[i]   = glm::abs(color - reference[i]);
+
+        float pixel_difference = std::max({difference[i].r, difference[i].g, difference[i].b});
+        max_difference         = std::max(max_difference, pixel_difference);
+        if (pixel_difference > options.pixel_tolerance)
+            ++mismatches;
+    }
+
+    float mismatch_fraction = static_cast<float>(mismatches) / reference.size();
+    bool  success           = mismatch_fraction <= options.max_mismatches;
+    std::printf("[%s] %s: %zu of %zu pixels differ (%.3f%%, max difference %.3f)\n", success ? " OK " : "FAIL", name.c_str(), mismatches,
+                reference.size(), 100.f * mismatch_fraction, max_difference);
+
+    if (!success)
+    {
+        std::filesystem::create_directories(options.output_directory);
+        cgtub::write_image(options.output_directory / (name + ".png"), framebuffer.image, width, height);
+        cgtub::write_image(options.output_directory / (name + ".diff.png"), difference, width, height);
+    }
+
+    return success;
+}
+
+// Reads the baseline of the frame times, one "<name> <median milliseconds>" per line
+std::map<std::string, double> read_baseline(std::filesystem::path const& path)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream                 file(path);
+    std::string                   name;
+    double                        ms;
+    while (file >> name >> ms)
+        baseline[name] = ms;
+    return baseline;
+}
+
+bool write_baseline(std::filesystem::path const& path, std::map<std::string, double> const& baseline)
+{
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path());
+
+    std::ofstream file(path);
+    for (auto const& [name, ms] : baseline)
+        file << name << ' ' << ms << '\n';
+
+    std::printf("[update] %s\n", path.string().c_str());
+    return static_cast<bool>(file);
+}
+
+// Returns the median frame time (after warmup frames) in milliseconds
+double time_frames(Options const& options, TestCase const& test_case, SceneRenderer* renderer, Framebuffer* framebuffer)
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int       warmup_runs = 3;
+    std::vector<double> run_ms;
+    for (int run = 0; run < warmup_runs + options.runs; ++run)
+    {
+        Clock::time_point start = Clock::now();
+        renderer->render(test_case, time_width, time_height, framebuffer);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (run >= warmup_runs)
+            run_ms.push_back(ms);
+    }
+
+    std::sort(run_ms.begin(), run_ms.end());
+    return run_ms[run_ms.size() / 2];
+}
+
+bool check_time(Options const& options, TestCase const& test_case, double ms, std::map<std::string, double> const& baseline)
+{
+    auto entry = baseline.find(test_case.name);
+    if (entry == baseline.end())
+    {
+        std::printf("[FAIL] %s: %.3f ms, no baseline (run with --update to create it)\n", test_case.name, ms);
+        return false;
+    }
+
+    double ratio   = ms / entry->second;
+    bool   success = ratio <= options.time_threshold;
+    std::printf("[%s] %s: %.3f ms, baseline %.3f ms (%.2fx, threshold %.2fx)\n", success ? " OK " : "FAIL", test_case.name, ms, entry->second, ratio,
+                options.time_threshold);
+    return success;
+}
+
+void print_usage(char const* executable)
+{
+    std::printf("Usage: %s --references <directory> [options]\n"
+                "  --images                  Compare the rendered images with the reference images\n"
+                "  --times                   Compare the frame times with the baseline (default: images, and times with --baseline)\n"
+                "  --update                  Replace the reference images or the baseline instead of comparing\n"
+                "  --output-directory <path> Where rendered and difference images of failed cases are written (default .)\n"
+                "  --baseline <path>         Frame time baseline of this machine (required by --times)\n"
+                "  --pixel-tolerance <value> Largest color difference of a matching pixel (default 0.02)\n"
+                "  --max-mismatches <value>  Largest fraction of pixels that may not match (default 0.001)\n"
+                "  --time-threshold <value>  Largest ratio of a frame time to its baseline (default 1.5)\n"
+                "  --runs <count>            Timed frames per case, the median is compared (default 31)\n",
+                executable);
+}
+
+bool parse_options(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        char const* arg = argv[i];
+        if (std::strcmp(arg, "--images") == 0)
+            options->check_images = true;
+        else if (std::strcmp(arg, "--times") == 0)
+            options->check_times = true;
+        else if (std::strcmp(arg, "--update") == 0)
+            options->update = true;
+        else if (i + 1 >= argc)
+            return false;
+        else if (std::strcmp(arg, "--references") == 0)
+            options->references = argv[++i];
+        else if (std::strcmp(arg, "--output-directory") == 0)
+            options->output_directory = argv[++i];
+        else if (std::strcmp(arg, "--baseline") == 0)
+            options->baseline = argv[++i];
+        else if (std::strcmp(arg, "--pixel-tolerance") == 0)
+            options->pixel_tolerance = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--max-mismatches") == 0)
+            options->max_mismatches = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--time-threshold") == 0)
+            options->time_threshold = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(arg, "--runs") == 0)
+            options->runs = std::atoi(argv[++i]);
+        else
+            return false;
+    }
+
+    // Frame times only compare on the machine that recorded them, so there is no default baseline
+    if (!options->check_images && !options->check_times)
+    {
+        options->check_images = true;
+        options->check_times  = !options->baseline.empty();
+    }
+    if (options->check_times && options->baseline.empty())
+    {
+        std::fprintf(stderr, "--times requires --baseline\n");
+        return false;
+    }
+
+    return !options->references.empty() && options->runs > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, &options))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, double> baseline = options.check_times ? read_baseline(options.baseline) : std::map<std::string, double>{};
+
+    // The sort-last path splits the draws into one layer per thread, so there are several layers on any machine
+    if (options.check_images)
+        cgtub::start_job_system(4);
+
+    bool          success = true;
+    Framebuffer   framebuffer;
+    FrameGeometry geometry;
+    for (TestCase const& test_case : test_cases)
+    {
+        SceneRenderer renderer(test_case.scene);
+
+        if (options.check_images)
+        {
+            renderer.render(test_case, image_width, image_height, &framebuffer);
+            success = check_image(options, test_case, framebuffer) && success;
+
+            if (!options.update)
+            {
+                renderer.render_prepared(test_case, image_width, image_height, &geometry, &framebuffer);
+                success = check_image(options, test_case, framebuffer, "prepared") && success;
+
+                // Rasterizes parts of the draws in parallel and merges them by depth, which must give the same image
+                TestCase sort_last_case           = test_case;
+                sort_last_case.settings.sort_last = true;
+                renderer.render(sort_last_case, image_width, image_height, &framebuffer);
+                success = check_image(options, test_case, framebuffer, "sort_last") && success;
+            }
+        }
+
+        if (options.check_times)
+        {
+            double ms = time_frames(options, test_case, &renderer, &framebuffer);
+            if (options.update)
+                baseline[test_case.name] = ms;
+            else
+                success = check_time(options, test_case, ms, baseline) && success;
+        }
+    }
+
+    if (options.update && options.check_times)
+        success = write_baseline(options.baseline, baseline) && success;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}